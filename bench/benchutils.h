@@ -0,0 +1,74 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_BENCHUTILS_H
+#define UCAPA_BENCHUTILS_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench{
+    typedef std::vector<std::pair<std::string, double> > Metrics;
+
+    /**
+     * @brief Print one result as a JSON object on a single line.
+     *
+     * Every benchmark writes its results this way, so outputs of two builds
+     * can be compared with a script.
+     */
+    inline void report(const std::string& name, const Metrics& metrics)
+    {
+        std::cout << "{\"name\": \"" << name << "\"";
+        for (std::size_t i=0; i<metrics.size(); ++i)
+            std::cout << ", \"" << metrics[i].first << "\": " << metrics[i].second;
+        std::cout << "}" << std::endl;
+    }
+
+    /**
+     * @brief Measure the wall time of a function.
+     * @return The elapsed time, in seconds.
+     */
+    template <typename F>
+    double measure(F f)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Prevent the compiler from removing a computation whose result is unused.
+     */
+    template <typename T>
+    inline void doNotOptimize(const T& value)
+    {
+        volatile const char* p = reinterpret_cast<volatile const char*>(&value);
+        (void)*p;
+    }
+}
+
+#endif // UCAPA_BENCHUTILS_H
@@ -0,0 +1,126 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cmath>
+#include <vector>
+
+#include <fastmath.h>
+
+#include "benchutils.h"
+
+namespace{
+    const std::size_t NB_ANGLES = 4096;
+    const int NB_REPEATS = 500;
+
+    double maxError(const std::vector<float>& values, const std::vector<double>& references)
+    {
+        double error = 0;
+        for (std::size_t i=0; i<values.size(); ++i)
+            error = std::max(error, std::fabs(values[i] - references[i]));
+        return error;
+    }
+}
+
+// Throughput and error of the vectorized sine, cosine and Euler angles to quaternion conversion
+int main()
+{
+    std::vector<float> angles(NB_ANGLES), x(NB_ANGLES), y(NB_ANGLES), z(NB_ANGLES);
+    std::vector<double> sineReferences(NB_ANGLES), cosineReferences(NB_ANGLES);
+    for (std::size_t i=0; i<NB_ANGLES; ++i)
+    {
+        // Navdata angles are in [-pi, pi], a wider range checks the reduction
+        angles[i] = -100.0f + 200.0f * i / NB_ANGLES;
+        sineReferences[i] = std::sin((double)angles[i]);
+        cosineReferences[i] = std::cos((double)angles[i]);
+        x[i] = 3.1f * std::sin(0.1f * i);
+        y[i] = 1.5f * std::cos(0.37f * i);
+        z[i] = 3.1f * std::sin(0.013f * i);
+    }
+    std::vector<float> sines(NB_ANGLES), cosines(NB_ANGLES);
+    std::vector<ucapa::Quaternion> quaternions(NB_ANGLES), references(NB_ANGLES);
+    const double n = (double)NB_ANGLES * NB_REPEATS;
+
+    const ucapa::FastMath::ACCURACY accuracies[] = {ucapa::FastMath::EXACT, ucapa::FastMath::APPROXIMATE};
+    const char* names[] = {"exact", "approximate"};
+    for (int a=0; a<2; ++a)
+    {
+        const double time = bench::measure([&]() {
+            for (int r=0; r<NB_REPEATS; ++r)
+                ucapa::FastMath::sinCos(angles.data(), NB_ANGLES, sines.data(), cosines.data(), accuracies[a]);
+        });
+        bench::report(std::string("sincos_") + names[a], {{"ns_per_angle", time * 1e9 / n},
+                                                          {"max_error_sin", maxError(sines, sineReferences)},
+                                                          {"max_error_cos", maxError(cosines, cosineReferences)}});
+    }
+
+    // Float functions of the standard library, for comparison
+    const double libraryTime = bench::measure([&]() {
+        for (int r=0; r<NB_REPEATS; ++r)
+            for (std::size_t i=0; i<NB_ANGLES; ++i)
+            {
+                sines[i] = std::sin(angles[i]);
+                cosines[i] = std::cos(angles[i]);
+            }
+    });
+    bench::report("sincos_std_float", {{"ns_per_angle", libraryTime * 1e9 / n},
+                                       {"max_error_sin", maxError(sines, sineReferences)},
+                                       {"max_error_cos", maxError(cosines, cosineReferences)}});
+
+    const double constructorTime = bench::measure([&]() {
+        for (int r=0; r<NB_REPEATS; ++r)
+            for (std::size_t i=0; i<NB_ANGLES; ++i)
+                references[i] = ucapa::Quaternion(x[i], y[i], z[i]);
+    });
+    bench::report("euler_quaternion_constructor", {{"ns_per_conversion", constructorTime * 1e9 / n}});
+
+    for (int a=0; a<2; ++a)
+    {
+        const double time = bench::measure([&]() {
+            for (int r=0; r<NB_REPEATS; ++r)
+                ucapa::FastMath::eulerToQuaternions(x.data(), y.data(), z.data(), NB_ANGLES, quaternions.data(), accuracies[a]);
+        });
+        double error = 0;
+        for (std::size_t i=0; i<NB_ANGLES; ++i)
+        {
+            const ucapa::Quaternion d = quaternions[i] + references[i] * -1.0f;
+            error = std::max(error, (double)std::sqrt(d.dot(d)));
+        }
+        bench::report(std::string("euler_quaternion_batch_") + names[a], {{"ns_per_conversion", time * 1e9 / n},
+                                                                          {"max_error", error}});
+    }
+
+    // One conversion at a time, as in Navdata
+    ucapa::Quaternion sum;
+    const double singleTime = bench::measure([&]() {
+        for (int r=0; r<NB_REPEATS; ++r)
+            for (std::size_t i=0; i<NB_ANGLES; ++i)
+                sum = sum + ucapa::FastMath::eulerToQuaternion(x[i], y[i], z[i], ucapa::FastMath::APPROXIMATE);
+    });
+    bench::report("euler_quaternion_single_approximate", {{"ns_per_conversion", singleTime * 1e9 / n}});
+    bench::doNotOptimize(sum);
+    bench::doNotOptimize(sines[0]);
+    bench::doNotOptimize(cosines[0]);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fastmath.h>
+#include <matrix.h>
+#include <quaternion.h>
+#include <vector3.h>
+
+#include "alloccounter.h"
+#include "benchutils.h"
+
+namespace{
+    // Inputs are read from arrays indexed by the iteration, so the compiler cannot fold the operations
+    const int NB_INPUTS = 1024;
+    const int NB_OPERATIONS = 1000000;
+
+    /**
+     * @brief Run f(i) NB_OPERATIONS times and report the time and the allocations per operation
+     */
+    template <typename F>
+    void run(const std::string& name, F f, int nbOperations = NB_OPERATIONS)
+    {
+        // Warm up the caches and the branch predictors
+        for (int i=0; i<nbOperations/10; ++i)
+            f(i);
+
+        const unsigned long long allocationsBefore = bench::getNbAllocations();
+        const double time = bench::measure([&]() {
+            for (int i=0; i<nbOperations; ++i)
+                f(i);
+        });
+        const unsigned long long allocations = bench::getNbAllocations() - allocationsBefore;
+
+        bench::report(name, {{"ops", (double)nbOperations},
+                             {"ns_per_op", time * 1e9 / nbOperations},
+                             {"allocs_per_op", (double)allocations / nbOperations}});
+    }
+
+    float random(float min, float max)
+    {
+        return min + (max - min) * std::rand() / (float)RAND_MAX;
+    }
+}
+
+int main()
+{
+    std::srand(42);
+    std::vector<ucapa::Vector3> vectors, angles;
+    std::vector<float> scalars;
+    for (int i=0; i<NB_INPUTS; ++i)
+    {
+        vectors.push_back(ucapa::Vector3(random(-2, 2), random(-2, 2), random(-2, 2)));
+        angles.push_back(ucapa::Vector3(random(-0.5f, 0.5f), random(-0.5f, 0.5f), random(-3.1f, 3.1f)));
+        scalars.push_back(random(0.5f, 2));
+    }
+    std::vector<ucapa::Quaternion> quaternions;
+    for (int i=0; i<NB_INPUTS; ++i)
+        quaternions.push_back(ucapa::Quaternion(angles[i]));
+    const int MASK = NB_INPUTS - 1;
+
+    // Vector3
+    ucapa::Vector3 v;
+    float f = 0;
+    run("vector3_construct", [&](int i) { v += ucapa::Vector3(scalars[i & MASK], scalars[(i+1) & MASK], scalars[(i+2) & MASK]); });
+    run("vector3_add", [&](int i) { v = vectors[i & MASK] + vectors[(i+1) & MASK]; bench::doNotOptimize(v); });
+    run("vector3_scale", [&](int i) { v = vectors[i & MASK] * scalars[i & MASK]; bench::doNotOptimize(v); });
+    run("vector3_dot", [&](int i) { f += vectors[i & MASK].dot(vectors[(i+1) & MASK]); });
+    run("vector3_cross", [&](int i) { v = vectors[i & MASK].cross(vectors[(i+1) & MASK]); bench::doNotOptimize(v); });
+    run("vector3_normalized", [&](int i) { v = vectors[i & MASK].normalized(); bench::doNotOptimize(v); });
+
+    // Quaternion
+    ucapa::Quaternion q;
+    run("quaternion_from_euler", [&](int i) { q = ucapa::Quaternion(angles[i & MASK]); bench::doNotOptimize(q); });
+    run("quaternion_from_euler_approximate", [&](int i) {
+        const ucapa::Vector3& a = angles[i & MASK];
+        q = ucapa::FastMath::eulerToQuaternion(a.x, a.y, a.z, ucapa::FastMath::APPROXIMATE);
+        bench::doNotOptimize(q);
+    });
+    run("quaternion_multiply", [&](int i) { q = quaternions[i & MASK] * quaternions[(i+1) & MASK]; bench::doNotOptimize(q); });
+    run("quaternion_rotate", [&](int i) { v = quaternions[i & MASK].rotate(vectors[i & MASK]); bench::doNotOptimize(v); });
+    run("quaternion_slerp", [&](int i) { q = quaternions[i & MASK].slerp(quaternions[(i+1) & MASK], 0.3f); bench::doNotOptimize(q); });
+    run("quaternion_rotation_matrix", [&](int i) { ucapa::Matrix3f m = quaternions[i & MASK].getRotationMatrix(); bench::doNotOptimize(m); });
+    run("quaternion_matrix_dynamic", [&](int i) { ucapa::Matrix<float> m = quaternions[i & MASK].getMatrix(); bench::doNotOptimize(m(0, 0)); });
+
+    // Matrix
+    std::vector<ucapa::Matrix4f> fixed4;
+    std::vector<ucapa::Matrix<float> > dynamic4;
+    std::vector<ucapa::Matrix<double, 9, 9> > fixed9;
+    std::vector<ucapa::Matrix<double> > dynamic9;
+    for (int i=0; i<NB_INPUTS; ++i)
+    {
+        ucapa::Matrix4f m4;
+        ucapa::Matrix<double, 9, 9> m9;
+        for (int r=0; r<4; ++r)
+            for (int c=0; c<4; ++c)
+                m4(r, c) = random(-1, 1);
+        for (int r=0; r<9; ++r)
+            for (int c=0; c<9; ++c)
+                m9(r, c) = random(-1, 1);
+        fixed4.push_back(m4);
+        dynamic4.push_back(m4.toDynamic());
+        fixed9.push_back(m9);
+        dynamic9.push_back(m9.toDynamic());
+    }
+
+    run("matrix4f_fixed_multiply", [&](int i) { ucapa::Matrix4f m = fixed4[i & MASK] * fixed4[(i+1) & MASK]; bench::doNotOptimize(m); });
+    run("matrix4f_dynamic_multiply", [&](int i) { ucapa::Matrix<float> m = dynamic4[i & MASK] * dynamic4[(i+1) & MASK]; bench::doNotOptimize(m(0, 0)); });
+    run("matrix4f_fixed_transpose", [&](int i) { ucapa::Matrix4f m = fixed4[i & MASK].transponate(); bench::doNotOptimize(m); });
+    run("matrix4f_dynamic_transpose", [&](int i) { ucapa::Matrix<float> m = dynamic4[i & MASK].transponate(); bench::doNotOptimize(m(0, 0)); });
+    run("matrix4f_fixed_add_scale", [&](int i) { ucapa::Matrix4f m = fixed4[i & MASK] + fixed4[(i+1) & MASK] * 0.5f; bench::doNotOptimize(m); });
+    run("matrix9d_fixed_multiply", [&](int i) { ucapa::Matrix<double, 9, 9> m = fixed9[i & MASK] * fixed9[(i+1) & MASK]; bench::doNotOptimize(m); },
+        NB_OPERATIONS / 10);
+    run("matrix9d_dynamic_multiply", [&](int i) { ucapa::Matrix<double> m = dynamic9[i & MASK] * dynamic9[(i+1) & MASK]; bench::doNotOptimize(m(0, 0)); },
+        NB_OPERATIONS / 10);
+
+    // World velocity, as computed by Navdata::navdataDemo, and with the former matrix based code
+    run("world_velocity_quaternion", [&](int i) {
+        const ucapa::Vector3& a = angles[i & MASK];
+        const ucapa::Quaternion rotation(ucapa::FastMath::eulerToQuaternion(a.z, a.x, a.y, ucapa::FastMath::APPROXIMATE));
+        v = rotation.conjugate().rotate(vectors[i & MASK]);
+        bench::doNotOptimize(v);
+    });
+    run("world_velocity_matrix", [&](int i) {
+        const ucapa::Vector3& a = angles[i & MASK];
+        const ucapa::Quaternion rotation(a.z, a.x, a.y);
+        ucapa::Matrix<float> T(rotation.getMatrix());
+        ucapa::Matrix<float> tT(T.transponate());
+        v = tT * vectors[i & MASK];
+        bench::doNotOptimize(v);
+    });
+
+    bench::doNotOptimize(v);
+    bench::doNotOptimize(f);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <vector>
+
+#include <navdata.h>
+
+#include "alloccounter.h"
+#include "benchutils.h"
+#include "navdatagenerator.h"
+
+// Measure the cost of Navdata::update with the world data computation enabled,
+// and check that the hot path does not allocate.
+int main()
+{
+    const int nbPackets = 200 * 60;
+    bench::NavdataGenerator generator;
+    std::vector<std::string> packets;
+    std::vector<std::chrono::steady_clock::time_point> receptionTimes;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<nbPackets; ++i)
+    {
+        receptionTimes.push_back(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(generator.getTime())));
+        packets.push_back(generator.next());
+    }
+
+    ucapa::Navdata navdata;
+    navdata.setComputeWorldData(true);
+    // Warm up, so that the clock synchronization has its first blocks
+    for (int i=0; i<nbPackets/10; ++i)
+        navdata.update(packets[i], receptionTimes[i]);
+
+    const unsigned long long allocationsBefore = bench::getNbAllocations();
+    const double updateTime = bench::measure([&]() {
+        for (int i=0; i<nbPackets; ++i)
+            navdata.update(packets[i], receptionTimes[i]);
+    });
+    const unsigned long long allocations = bench::getNbAllocations() - allocationsBefore;
+    bench::doNotOptimize(navdata.getPosition());
+
+    bench::report("navdata_update", {{"packets", (double)nbPackets},
+                                     {"ns_per_packet", updateTime * 1e9 / nbPackets},
+                                     {"allocs_per_packet", (double)allocations / nbPackets}});
+
+    // Same with the pose estimator
+    ucapa::Navdata estimatingNavdata;
+    estimatingNavdata.setComputeWorldData(true);
+    estimatingNavdata.setEstimatePose(true);
+    for (int i=0; i<nbPackets/10; ++i)
+        estimatingNavdata.update(packets[i], receptionTimes[i]);
+
+    const unsigned long long estimatorAllocationsBefore = bench::getNbAllocations();
+    const double estimatorTime = bench::measure([&]() {
+        for (int i=0; i<nbPackets; ++i)
+            estimatingNavdata.update(packets[i], receptionTimes[i]);
+    });
+    const unsigned long long estimatorAllocations = bench::getNbAllocations() - estimatorAllocationsBefore;
+    bench::doNotOptimize(estimatingNavdata.getEstimatedPosition());
+
+    bench::report("navdata_update_pose_estimator", {{"packets", (double)nbPackets},
+                                                    {"ns_per_packet", estimatorTime * 1e9 / nbPackets},
+                                                    {"allocs_per_packet", (double)estimatorAllocations / nbPackets}});
+
+    return (allocations == 0 && estimatorAllocations == 0) ? 0 : 1;
+}
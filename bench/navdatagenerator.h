@@ -0,0 +1,200 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_NAVDATAGENERATOR_H
+#define UCAPA_NAVDATAGENERATOR_H
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdint.h>
+#include <string>
+
+namespace bench{
+    /**
+     * @brief Generate full navdata packets of a simulated flight.
+     *
+     * The packets have the layout of an AR.Drone 2.0 in full navdata mode
+     * (around 600 bytes). Raw sensor values are noisy, values estimated by the
+     * drone filters (angles, velocities) are smooth with little noise, and the
+     * other options are constant.
+     * By default, the floats are rounded to the fixed-point resolution of the
+     * sensors and filters that produce them (1 mdeg, 1 mm/s, 1/16 degree...), as
+     * the drone does. Without quantization, they carry full-precision noise, which
+     * is the worst case for the compression.
+     */
+    class NavdataGenerator
+    {
+    protected:
+        std::mt19937 m_random;
+        std::normal_distribution<float> m_noise;
+        bool m_quantized;
+        unsigned int m_sequence;
+        double m_time;
+        std::string m_packet;
+
+        template <typename T>
+        void put(T value) { m_packet.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+        void beginOption(uint16_t tag, uint16_t size) { put(tag); put(size); }
+
+        float noisy(float value, float sigma) { return value + sigma * m_noise(m_random); }
+
+        // Noisy value, rounded to the resolution of the sensor when the generator is quantized
+        float measure(float value, float sigma, float resolution)
+        {
+            float v = noisy(value, sigma);
+            return m_quantized ? resolution * std::round(v / resolution) : v;
+        }
+
+    public:
+        NavdataGenerator(unsigned int seed = 42, bool quantized = true)
+            : m_random(seed)
+            , m_noise(0.0f, 1.0f)
+            , m_quantized(quantized)
+            , m_sequence(0)
+            , m_time(1000.0)
+        {
+        }
+
+        /**
+         * @brief Time of the next packet, in seconds of drone time.
+         */
+        double getTime() const { return m_time; }
+
+        /**
+         * @brief Velocity sent in the demo option of the last packet, in mm/s, in drone coordinates (x, y, z).
+         */
+        float velocity[3];
+
+        /**
+         * @brief Generate the next packet, 5 ms after the previous one.
+         */
+        const std::string& next()
+        {
+            const double t = m_time;
+            m_packet.clear();
+
+            put<uint32_t>(0x55667788);
+            put<uint32_t>(0x0F8004D5);     // State
+            put<uint32_t>(m_sequence++);
+            put<uint32_t>(1);              // Vision flag
+
+            // Demo option
+            velocity[0] = (float)(800 * std::sin(0.3 * t));
+            velocity[1] = (float)(500 * std::cos(0.2 * t));
+            velocity[2] = (float)(100 * std::sin(0.5 * t));
+            beginOption(0, 148);
+            put<uint32_t>(0x40000);        // Control state
+            put<uint32_t>(80 - (uint32_t)(t / 600)); // Battery
+            put<float>(measure((float)(3000 * std::sin(0.3 * t)), 1, 1));   // Theta (mdeg)
+            put<float>(measure((float)(2000 * std::cos(0.2 * t)), 1, 1));   // Phi (mdeg)
+            put<float>(measure((float)(-90000 + 100 * t), 1, 1));           // Psi (mdeg)
+            put<int32_t>((int32_t)(1200 + 50 * std::sin(0.1 * t)));    // Altitude (mm)
+            put<float>(measure(velocity[0], 0.5f, 1));
+            put<float>(measure(velocity[1], 0.5f, 1));
+            put<float>(measure(velocity[2], 0.5f, 1));
+            put<uint32_t>(0);              // Frame index
+            m_packet.append(148 - 44, '\0'); // Detection camera data, unused in flight
+
+            // Time option
+            beginOption(1, 8);
+            uint32_t seconds = (uint32_t)t;
+            put<uint32_t>(((seconds % 2048) << 21) | (uint32_t)((t - seconds) * 1000000));
+
+            // Raw measures
+            beginOption(2, 52);
+            for (int i=0; i<3; ++i) put<uint16_t>((uint16_t)noisy(2048, 8));
+            for (int i=0; i<3; ++i) put<int16_t>((int16_t)noisy(0, 6));
+            for (int i=0; i<2; ++i) put<int16_t>(0);
+            put<uint32_t>(12000 - (uint32_t)(t / 10)); // Battery voltage
+            put<uint32_t>(0); put<uint32_t>(0); put<uint32_t>(0);
+            put<int32_t>(1200 + (int32_t)noisy(0, 3)); // Ultrasound echo
+            m_packet.append(52 - 4 - 36, '\0');
+
+            // Phys measures
+            beginOption(3, 46);
+            put<float>(measure(45, 0.01f, 1.0f / 16));
+            put<uint16_t>(40);
+            for (int i=0; i<3; ++i) put<float>(measure(i == 2 ? -1000.0f : 0.0f, 10, 1));
+            for (int i=0; i<3; ++i) put<float>(measure(0, 0.5f, 1.0f / 16));
+            put<uint32_t>(3300); put<uint32_t>(1200); put<uint32_t>(1200);
+
+            // Euler angles
+            beginOption(5, 12);
+            put<float>(measure((float)(3000 * std::sin(0.3 * t)), 1, 1));
+            put<float>(measure((float)(2000 * std::cos(0.2 * t)), 1, 1));
+
+            // References, constant in hovering
+            beginOption(6, 88);
+            m_packet.append(84, '\0');
+
+            // Altitude
+            beginOption(10, 56);
+            put<int32_t>((int32_t)(1200 + 50 * std::sin(0.1 * t)));
+            put<float>(measure(0, 0.5f, 1));
+            put<int32_t>(1200);
+            put<int32_t>(1200 + (int32_t)noisy(0, 3));
+            m_packet.append(56 - 20, '\0');
+
+            // Pressure raw
+            beginOption(21, 18);
+            put<int32_t>(40000 + (int32_t)noisy(0, 4)); // Uncompensated pressure
+            put<int16_t>(25000);                         // Uncompensated temperature
+            put<int32_t>(250);                           // Temperature (0.1 degree)
+            put<int32_t>(101325 + (int32_t)noisy(0, 4)); // Pressure (Pa)
+
+            // Magnetometer
+            beginOption(22, 83);
+            for (int i=0; i<3; ++i) put<int16_t>((int16_t)noisy(100, 3));
+            for (int i=0; i<9; ++i) put<float>(measure(100, 1, 1.0f / 16));
+            for (int i=0; i<3; ++i) put<float>(measure((float)(-90 + 0.1 * t), 0.01f, 1.0f / 256));
+            m_packet.append(83 - 4 - 6 - 48, '\0');
+
+            // Wind, slowly varying
+            beginOption(23, 56);
+            put<float>(measure((float)(2 + 0.001 * t), 0, 1.0f / 1024));
+            put<float>(measure((float)(0.5 * std::sin(0.01 * t)), 0, 1.0f / 1024));
+            m_packet.append(56 - 12, '\0');
+
+            // Watchdog and wifi, constant
+            beginOption(17, 8);
+            put<uint32_t>(0);
+            beginOption(26, 8);
+            put<uint32_t>(255);
+
+            // Checksum
+            uint32_t checksum = 0;
+            for (std::size_t i=0; i<m_packet.size(); ++i)
+                checksum += (unsigned char)m_packet[i];
+            beginOption(0xFFFF, 8);
+            put<uint32_t>(checksum);
+
+            m_time += 0.005;
+            return m_packet;
+        }
+    };
+}
+
+#endif // UCAPA_NAVDATAGENERATOR_H
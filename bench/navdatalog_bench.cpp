@@ -0,0 +1,139 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <navdatalog.h>
+
+#include "benchutils.h"
+#include "navdatagenerator.h"
+
+namespace {
+    // Encode ten minutes of simulated full navdata at 200 Hz, return the size of the raw records
+    std::size_t encodeFlight(bench::NavdataGenerator& generator, std::string& encoded, double& encodeTime)
+    {
+        const int nbPackets = 200 * 600;
+        std::size_t rawSize = 0;
+        std::ostringstream oss(std::ios::binary);
+        ucapa::NavdataLogWriter writer(oss);
+
+        encodeTime = 0;
+        for (int i=0; i<nbPackets; ++i)
+        {
+            int64_t timestamp = (int64_t)(generator.getTime() * 1e9);
+            const std::string& packet = generator.next();
+            rawSize += packet.size() + sizeof(int64_t);
+            encodeTime += bench::measure([&]() { writer.write(timestamp, packet); });
+        }
+        encoded = oss.str();
+        return rawSize;
+    }
+}
+
+// Measure the storage reduction and the decoding speed of the navdata log codec.
+// Usage: navdatalog_bench [recorded log]
+// Without argument, ten minutes of simulated full navdata at 200 Hz are used, with the values quantized as the drone
+// sends them. The ratio with full-precision noise on every float is also reported, as a lower bound.
+int main(int argc, char *argv[])
+{
+    std::string encoded;
+    std::size_t rawSize = 0;
+    double duration = 0;
+
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        std::ostringstream oss;
+        oss << file.rdbuf();
+        encoded = oss.str();
+    }
+    else
+    {
+        bench::NavdataGenerator generator;
+        double encodeTime;
+        rawSize = encodeFlight(generator, encoded, encodeTime);
+
+        const double nbRecords = 200 * 600;
+        bench::report("navdatalog_encode", {{"records", nbRecords},
+                                            {"ns_per_record", encodeTime * 1e9 / nbRecords}});
+
+        bench::NavdataGenerator noisyGenerator(42, false);
+        std::string noisyEncoded;
+        std::size_t noisyRawSize = encodeFlight(noisyGenerator, noisyEncoded, encodeTime);
+        bench::report("navdatalog_full_precision", {{"raw_bytes", (double)noisyRawSize},
+                                                    {"encoded_bytes", (double)noisyEncoded.size()},
+                                                    {"compression_ratio", (double)noisyRawSize / noisyEncoded.size()}});
+    }
+
+    ucapa::NavdataLogReader reader;
+    if (!reader.open(encoded))
+    {
+        std::cerr << "Invalid navdata log" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Sequential decoding
+    ucapa::NavdataLogRecord record;
+    std::size_t decodedSize = 0;
+    int64_t firstTimestamp = 0, lastTimestamp = 0;
+    double decodeTime = bench::measure([&]() {
+        reader.seek(0);
+        while (reader.next(record))
+        {
+            if (decodedSize == 0)
+                firstTimestamp = record.timestamp;
+            lastTimestamp = record.timestamp;
+            decodedSize += record.packet.size() + sizeof(int64_t);
+        }
+    });
+    if (rawSize == 0)
+        rawSize = decodedSize;
+    duration = (lastTimestamp - firstTimestamp) * 1e-9;
+
+    const double nbRecords = (double)reader.getNbRecords();
+    bench::report("navdatalog_decode", {{"records", nbRecords},
+                                        {"raw_bytes", (double)rawSize},
+                                        {"encoded_bytes", (double)encoded.size()},
+                                        {"compression_ratio", (double)rawSize / encoded.size()},
+                                        {"ns_per_record", decodeTime * 1e9 / nbRecords},
+                                        {"mb_per_s", decodedSize / decodeTime / 1e6},
+                                        {"realtime_factor", duration / decodeTime}});
+
+    // Random access
+    const int nbSeeks = 1000;
+    std::mt19937 random(1);
+    std::uniform_int_distribution<std::size_t> index(0, reader.getNbRecords() - 1);
+    double seekTime = bench::measure([&]() {
+        for (int i=0; i<nbSeeks; ++i)
+        {
+            reader.seek(index(random));
+            reader.next(record);
+        }
+    });
+    bench::report("navdatalog_seek", {{"ns_per_seek", seekTime * 1e9 / nbSeeks}});
+
+    return EXIT_SUCCESS;
+}
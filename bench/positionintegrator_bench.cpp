@@ -0,0 +1,224 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <navdata.h>
+#include <navdatalog.h>
+#include <positionintegrator.h>
+
+#include "benchutils.h"
+
+namespace{
+    const char* methodNames[] = {"euler", "trapezoidal", "rk2"};
+
+    /**
+     * @brief Drop packets by bursts (two-state Gilbert-Elliott model).
+     */
+    class BurstLoss
+    {
+        std::mt19937 m_random;
+        std::uniform_real_distribution<double> m_uniform;
+        bool m_losing;
+
+    public:
+        BurstLoss() : m_random(7), m_uniform(0, 1), m_losing(false) {}
+
+        bool drop()
+        {
+            // Bursts of 20 packets on average, 4% of the packets lost
+            m_losing = m_losing ? (m_uniform(m_random) > 0.05) : (m_uniform(m_random) < 0.002);
+            return m_losing;
+        }
+    };
+
+    // Simulated flight: the velocity is a sum of sines, so the position is known exactly
+    ucapa::Vector3 velocityAt(double t)
+    {
+        return ucapa::Vector3((float)(0.8*std::sin(0.3*t) + 0.3*std::sin(3.1*t)),
+                              (float)(0.1*std::sin(0.5*t) + 0.2*std::sin(2.3*t)),
+                              (float)(0.5*std::cos(0.2*t) + 0.4*std::cos(4.0*t)));
+    }
+
+    ucapa::Vector3d precisePositionAt(double t)
+    {
+        return ucapa::Vector3d(0.8/0.3*(1 - std::cos(0.3*t)) + 0.3/3.1*(1 - std::cos(3.1*t)),
+                               0.1/0.5*(1 - std::cos(0.5*t)) + 0.2/2.3*(1 - std::cos(2.3*t)),
+                               0.5/0.2*std::sin(0.2*t) + 0.4/4.0*std::sin(4.0*t));
+    }
+
+    ucapa::Vector3 positionAt(double t)
+    {
+        return ucapa::Vector3(precisePositionAt(t));
+    }
+
+    void benchSimulated(bool withLoss)
+    {
+        const int nbPackets = 200 * 600;
+        std::mt19937 random(3);
+        std::normal_distribution<double> jitter(0, 0.0005);
+
+        std::vector<double> times;
+        std::vector<ucapa::Vector3> velocities;
+        BurstLoss loss;
+        for (int i=0; i<nbPackets; ++i)
+        {
+            double t = i * 0.005 + jitter(random);
+            if (i == 0 || !withLoss || !loss.drop())
+            {
+                times.push_back(t);
+                velocities.push_back(velocityAt(t));
+            }
+        }
+
+        for (int m=ucapa::PositionIntegrator::EULER; m<=ucapa::PositionIntegrator::RK2; ++m)
+        {
+            ucapa::PositionIntegrator integrator((ucapa::PositionIntegrator::METHOD)m);
+            const double integrationTime = bench::measure([&]() {
+                for (std::size_t i=0; i<times.size(); ++i)
+                    integrator.addSample(times[i], velocities[i]);
+            });
+            bench::doNotOptimize(integrator.getPosition());
+
+            integrator.reset(positionAt(times[0]));
+            double squaredErrors = 0;
+            for (std::size_t i=0; i<times.size(); ++i)
+            {
+                integrator.addSample(times[i], velocities[i]);
+                ucapa::Vector3 error = integrator.getPosition() - positionAt(times[i]);
+                squaredErrors += error.dot(error);
+            }
+            ucapa::Vector3 finalError = integrator.getPosition() - positionAt(times.back());
+
+            bench::report(std::string("position_integration_") + methodNames[m] + (withLoss ? "_burst_loss" : ""),
+                          {{"samples", (double)times.size()},
+                           {"rms_error_m", std::sqrt(squaredErrors / times.size())},
+                           {"final_error_m", std::sqrt(finalError.dot(finalError))},
+                           {"ns_per_sample", integrationTime * 1e9 / times.size()}});
+        }
+    }
+
+    // One hour of flight at 200 Hz, far from the origin: the float accumulator rounds the small steps
+    void benchPrecision()
+    {
+        const int nbPackets = 200 * 3600;
+        const ucapa::Vector3d origin(1000, 0, -500);
+
+        std::vector<ucapa::Vector3> velocities;
+        for (int i=0; i<nbPackets; ++i)
+            velocities.push_back(velocityAt(i * 0.005));
+
+        for (int precise=0; precise<2; ++precise)
+        {
+            ucapa::PositionIntegrator integrator;
+            integrator.setDoublePrecision(precise != 0);
+            integrator.reset(origin);
+
+            const double integrationTime = bench::measure([&]() {
+                for (int i=0; i<nbPackets; ++i)
+                    integrator.addSample(i * 0.005, velocities[i]);
+            });
+            const ucapa::Vector3d finalError = integrator.getPrecisePosition() - origin - precisePositionAt((nbPackets - 1) * 0.005);
+
+            bench::report(std::string("position_integration_long_flight_") + (precise ? "double" : "float"),
+                          {{"samples", (double)nbPackets},
+                           {"final_error_m", std::sqrt(finalError.dot(finalError))},
+                           {"ns_per_sample", integrationTime * 1e9 / nbPackets}});
+        }
+    }
+
+    ucapa::Vector3 replay(const std::string& encoded, ucapa::PositionIntegrator::METHOD method, bool withLoss, double& duration)
+    {
+        ucapa::NavdataLogReader reader;
+        reader.open(encoded);
+
+        ucapa::Navdata navdata;
+        navdata.setComputeWorldData(true);
+        navdata.setPositionIntegration(method);
+
+        ucapa::NavdataLogRecord record;
+        BurstLoss loss;
+        duration = 0;
+        while (reader.next(record))
+        {
+            if (withLoss && loss.drop())
+                continue;
+
+            std::chrono::steady_clock::time_point receptionTime(
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.timestamp)));
+            duration += bench::measure([&]() { navdata.update(record.packet, receptionTime); });
+        }
+        return navdata.getPosition();
+    }
+
+    void benchRecorded(const std::string& encoded)
+    {
+        ucapa::NavdataLogReader reader;
+        if (!reader.open(encoded))
+        {
+            std::cerr << "Invalid navdata log" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        const double nbRecords = (double)reader.getNbRecords();
+
+        // There is no ground truth: measure how much the losses move the final position
+        for (int m=ucapa::PositionIntegrator::EULER; m<=ucapa::PositionIntegrator::RK2; ++m)
+        {
+            double fullDuration, lossyDuration;
+            ucapa::Vector3 full = replay(encoded, (ucapa::PositionIntegrator::METHOD)m, false, fullDuration);
+            ucapa::Vector3 lossy = replay(encoded, (ucapa::PositionIntegrator::METHOD)m, true, lossyDuration);
+            ucapa::Vector3 drift = lossy - full;
+
+            bench::report(std::string("recorded_flight_") + methodNames[m],
+                          {{"records", nbRecords},
+                           {"burst_loss_drift_m", std::sqrt(drift.dot(drift))},
+                           {"ns_per_packet", fullDuration * 1e9 / nbRecords}});
+        }
+    }
+}
+
+// Compare the accuracy of the position integration methods.
+// Usage: positionintegrator_bench [recorded log...]
+// A simulated flight with a known trajectory is always used, recorded flights are optional.
+int main(int argc, char *argv[])
+{
+    benchSimulated(false);
+    benchSimulated(true);
+    benchPrecision();
+
+    for (int i=1; i<argc; ++i)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::ostringstream oss;
+        oss << file.rdbuf();
+        benchRecorded(oss.str());
+    }
+
+    return 0;
+}
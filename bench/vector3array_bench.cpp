@@ -0,0 +1,99 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cstdlib>
+#include <vector>
+
+#include <vector3array.h>
+
+#include "benchutils.h"
+
+namespace{
+    const std::size_t NB_VECTORS = 4096;
+    const int NB_REPEATS = 500;
+
+    // Report the time per vector of an operation on the array and on std::vector<Vector3>
+    template <typename A, typename B>
+    void compare(const std::string& name, A arrayOperation, B scalarOperation)
+    {
+        const double arrayTime = bench::measure([&]() {
+            for (int r=0; r<NB_REPEATS; ++r)
+                arrayOperation();
+        });
+        const double scalarTime = bench::measure([&]() {
+            for (int r=0; r<NB_REPEATS; ++r)
+                scalarOperation();
+        });
+        const double n = (double)NB_VECTORS * NB_REPEATS;
+        bench::report(name, {{"vectors", (double)NB_VECTORS},
+                             {"ns_per_vector_array", arrayTime * 1e9 / n},
+                             {"ns_per_vector_vector3", scalarTime * 1e9 / n},
+                             {"speedup", scalarTime / arrayTime}});
+    }
+}
+
+// Compare the Vector3Array kernels to the same operations done vector by vector with Vector3
+int main()
+{
+    std::srand(42);
+    ucapa::Vector3Array a, b, c;
+    std::vector<ucapa::Vector3> va, vb, vc(NB_VECTORS);
+    for (std::size_t i=0; i<NB_VECTORS; ++i)
+    {
+        const ucapa::Vector3 u(std::rand() / (float)RAND_MAX, std::rand() / (float)RAND_MAX, 1 + std::rand() / (float)RAND_MAX);
+        const ucapa::Vector3 v(std::rand() / (float)RAND_MAX, 1 + std::rand() / (float)RAND_MAX, std::rand() / (float)RAND_MAX);
+        a.push_back(u);
+        va.push_back(u);
+        b.push_back(v);
+        vb.push_back(v);
+    }
+    std::vector<float> dots(NB_VECTORS);
+
+    std::cout << "{\"instruction_set\": \"" << ucapa::Vector3Array::getInstructionSet() << "\"}" << std::endl;
+
+    compare("vector3array_add", [&]() {a.add(b);},
+                                [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) va[i] += vb[i];});
+    compare("vector3array_scale", [&]() {a.scale(0.999f);},
+                                  [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) va[i] = va[i] * 0.999f;});
+    compare("vector3array_dot", [&]() {a.dot(b, dots.data());},
+                                [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) dots[i] = va[i].dot(vb[i]);});
+    compare("vector3array_cross", [&]() {a.cross(b, c);},
+                                  [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) vc[i] = va[i].cross(vb[i]);});
+    compare("vector3array_normalize", [&]() {a.normalize();},
+                                      [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) va[i] = va[i].normalized();});
+
+    const ucapa::Quaternion q(0.1f, 0.2f, -0.3f);
+    const ucapa::Matrix3f m(q.getRotationMatrix());
+    compare("vector3array_rotate_matrix", [&]() {a.rotate(m);},
+                                          [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) va[i] = m * va[i];});
+    compare("vector3array_rotate_quaternion", [&]() {a.rotate(q);},
+                                              [&]() {for (std::size_t i=0; i<NB_VECTORS; ++i) va[i] = q.rotate(va[i]);});
+
+    bench::doNotOptimize(a.get(0));
+    bench::doNotOptimize(va[0]);
+    bench::doNotOptimize(vc[0]);
+    bench::doNotOptimize(dots[0]);
+
+    return 0;
+}
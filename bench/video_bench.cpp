@@ -0,0 +1,206 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <pave.h>
+#include <video.h>
+
+#include "benchutils.h"
+
+namespace {
+    struct Frame
+    {
+        ucapa::PaVEHeader header;
+        std::string payload;
+    };
+
+    struct Setting
+    {
+        const char* name;
+        ucapa::Video::DECODER_THREADING threading;
+        int nbThreads;
+        bool lowDelay;
+    };
+
+    // Split a recorded stream into frames, like the video thread does
+    std::vector<Frame> readFrames(const std::string& stream)
+    {
+        std::vector<Frame> frames;
+        std::size_t position = 0;
+        while (position + ucapa::PaVEHeader::MIN_SIZE <= stream.size())
+        {
+            Frame frame;
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(stream.data()) + position;
+            if (!frame.header.parse(data))
+            {
+                position += ucapa::PaVEHeader::findSignature(data + 1, stream.size() - position - 1) + 1;
+                continue;
+            }
+            position += frame.header.headerSize;
+            if (position + frame.header.payloadSize > stream.size())
+                break;
+
+            frame.payload = stream.substr(position, frame.header.payloadSize);
+            position += frame.header.payloadSize;
+
+            // The decoding starts at the first key frame
+            if (frame.header.codec == ucapa::PaVEHeader::CODEC_MPEG4_AVC && (!frames.empty() || frame.header.isKeyFrame()))
+                frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    // Decode the frames with a setting, as fast as possible or at the rate of the capture.
+    // The latency of a frame is the time between the decoding call of its packet and its output.
+    bool decode(const std::vector<Frame>& frames, const Setting& setting, bool paced)
+    {
+        AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+        AVCodecContext* codecCtx = avcodec_alloc_context3(codec);
+        ucapa::Video::configureDecoder(codecCtx, setting.threading, setting.nbThreads, setting.lowDelay);
+        if (avcodec_open2(codecCtx, codec, nullptr) < 0)
+        {
+            std::cerr << "Opening Codec failed" << std::endl;
+            avcodec_free_context(&codecCtx);
+            return false;
+        }
+        AVFrame* picture = av_frame_alloc();
+
+        std::deque<std::chrono::steady_clock::time_point> pending;
+        std::vector<double> latencies;
+        std::size_t maxDelay = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // The empty packets at the end flush the delayed frames
+        for (std::size_t i=0; i<frames.size() || !pending.empty(); ++i)
+        {
+            AVPacket packet;
+            av_init_packet(&packet);
+            packet.data = nullptr;
+            packet.size = 0;
+            if (i < frames.size())
+            {
+                if (paced)
+                    std::this_thread::sleep_until(start + std::chrono::milliseconds(frames[i].header.timestamp - frames[0].header.timestamp));
+                packet.data = (uint8_t*)frames[i].payload.data();
+                packet.size = (int)frames[i].payload.size();
+                if (frames[i].header.isKeyFrame())
+                    packet.flags |= AV_PKT_FLAG_KEY;
+                pending.push_back(std::chrono::steady_clock::now());
+            }
+
+            int frameDecoded = 0;
+            if (avcodec_decode_video2(codecCtx, picture, &frameDecoded, &packet) < 0)
+            {
+                if (i >= frames.size())
+                    break;
+                // The frame of this packet is lost
+                pending.pop_back();
+            }
+            maxDelay = std::max(maxDelay, pending.size() - (frameDecoded ? 1 : 0));
+            if (frameDecoded)
+            {
+                latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.front()).count());
+                pending.pop_front();
+            }
+            else if (i >= frames.size())
+                break;
+        }
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::sort(latencies.begin(), latencies.end());
+        double mean = 0;
+        for (std::size_t i=0; i<latencies.size(); ++i)
+            mean += latencies[i];
+        mean /= std::max<std::size_t>(latencies.size(), 1);
+
+        bench::report(std::string("video_decode_") + setting.name + (paced ? "_paced" : ""),
+                      {{"frames", (double)latencies.size()},
+                       {"threads", (double)codecCtx->thread_count},
+                       {"frame_threading", (codecCtx->active_thread_type & FF_THREAD_FRAME) ? 1.0 : 0.0},
+                       {"slice_threading", (codecCtx->active_thread_type & FF_THREAD_SLICE) ? 1.0 : 0.0},
+                       {"fps", latencies.size() / duration},
+                       {"delayed_frames", (double)maxDelay},
+                       {"latency_ms_mean", mean},
+                       {"latency_ms_p95", latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100]},
+                       {"latency_ms_max", latencies.empty() ? 0 : latencies.back()}});
+
+        av_frame_free(&picture);
+        avcodec_free_context(&codecCtx);
+        return true;
+    }
+}
+
+// Compare the decoding speed and latency of the threading options of the video decoder.
+// Usage: video_bench <recorded stream> [paced frames]
+// The stream is the raw content of the video port, e.g. recorded with "nc 192.168.1.1 5555 > stream.pave"
+// with the H264_720P_CODEC. Each setting first decodes the whole stream as fast as possible, then
+// its first frames (300 by default) at the rate of the capture, as the video thread does.
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: video_bench <recorded stream> [paced frames]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::ostringstream oss;
+    oss << file.rdbuf();
+    std::vector<Frame> frames = readFrames(oss.str());
+    if (frames.empty())
+    {
+        std::cerr << "No H.264 frame in the stream" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<Frame> pacedFrames(frames.begin(), frames.begin() + std::min<std::size_t>(frames.size(), argc > 2 ? std::atoi(argv[2]) : 300));
+
+    avcodec_register_all();
+    bench::report("video_stream", {{"frames", (double)frames.size()},
+                                   {"width", (double)frames[0].header.displayWidth},
+                                   {"height", (double)frames[0].header.displayHeight},
+                                   {"duration_s", (frames.back().header.timestamp - frames[0].header.timestamp) / 1000.0}});
+
+    const Setting settings[] = {
+        {"none", ucapa::Video::NO_THREADING, 1, true},
+        {"slice", ucapa::Video::SLICE_THREADING, 0, true},
+        {"frame_2", ucapa::Video::FRAME_THREADING, 2, false},
+        {"frame_4", ucapa::Video::FRAME_THREADING, 4, false},
+        {"frame", ucapa::Video::FRAME_THREADING, 0, false},
+        {"frame_slice", ucapa::Video::FRAME_AND_SLICE_THREADING, 0, false},
+        {"frame_slice_low_delay", ucapa::Video::FRAME_AND_SLICE_THREADING, 0, true}
+    };
+    for (std::size_t i=0; i<sizeof(settings) / sizeof(settings[0]); ++i)
+    {
+        if (!decode(frames, settings[i], false) || !decode(pacedFrames, settings[i], true))
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+    #include <libswscale/swscale.h>
+}
+
+#include <yuvconverter.h>
+
+#include "benchutils.h"
+
+namespace {
+    const int WIDTH = 1280;
+    const int HEIGHT = 720;
+    const int NB_FRAMES = 200;
+
+    struct Format
+    {
+        const char* name;
+        ucapa::FrameHandle::FORMAT format;
+        AVPixelFormat swsFormat;
+    };
+
+    // Time of the conversion of a frame, in milliseconds
+    template <typename F>
+    double measureFrame(F convert)
+    {
+        convert();
+        return bench::measure([&]() {
+            for (int i=0; i<NB_FRAMES; ++i)
+                convert();
+        }) * 1e3 / NB_FRAMES;
+    }
+}
+
+// Compare the conversion of a 720p YUV420P frame by YuvConverter with the previous sws_scale path
+// of Video::decode (SWS_SPLINE), for each instruction set and with one thread or the default workers.
+int main()
+{
+    // Smooth gradients with noise, as a camera image
+    const int chromaWidth = WIDTH / 2;
+    std::vector<uint8_t> y(WIDTH * HEIGHT), u(chromaWidth * HEIGHT / 2), v(chromaWidth * HEIGHT / 2);
+    std::srand(42);
+    for (int row=0; row<HEIGHT; ++row)
+    {
+        for (int x=0; x<WIDTH; ++x)
+            y[row * WIDTH + x] = (uint8_t)(16 + (x + row) * 219 / (WIDTH + HEIGHT) + std::rand() % 8);
+    }
+    for (std::size_t i=0; i<u.size(); ++i)
+    {
+        u[i] = (uint8_t)(64 + (i % chromaWidth) * 128 / chromaWidth);
+        v[i] = (uint8_t)(192 - (i / chromaWidth) * 128 / (HEIGHT / 2));
+    }
+    const uint8_t* planes[4] = {y.data(), u.data(), v.data(), nullptr};
+    const int strides[4] = {WIDTH, chromaWidth, chromaWidth, 0};
+
+    const Format formats[] = {
+        {"rgb24", ucapa::FrameHandle::FORMAT_RGB24, AV_PIX_FMT_RGB24},
+        {"bgra", ucapa::FrameHandle::FORMAT_BGRA, AV_PIX_FMT_BGRA},
+        {"rgba", ucapa::FrameHandle::FORMAT_RGBA, AV_PIX_FMT_RGBA}
+    };
+    const int flags[] = {SWS_SPLINE, SWS_BILINEAR};
+    const char* flagNames[] = {"spline", "bilinear"};
+
+    for (std::size_t f=0; f<sizeof(formats) / sizeof(formats[0]); ++f)
+    {
+        const int stride = (WIDTH * ucapa::FrameHandle::getBytesPerPixel(formats[f].format) + 31) & ~31;
+        std::vector<uint8_t> reference(stride * HEIGHT), converted(stride * HEIGHT);
+
+        for (int i=0; i<2; ++i)
+        {
+            SwsContext* context = sws_getContext(WIDTH, HEIGHT, AV_PIX_FMT_YUV420P, WIDTH, HEIGHT, formats[f].swsFormat, flags[i], nullptr, nullptr, nullptr);
+            uint8_t* dest[4] = {reference.data(), nullptr, nullptr, nullptr};
+            int destStrides[4] = {stride, 0, 0, 0};
+            double time = measureFrame([&]() { sws_scale(context, planes, strides, 0, HEIGHT, dest, destStrides); });
+            bench::report(std::string("yuv_sws_") + flagNames[i] + "_" + formats[f].name, {{"ms_per_frame", time}});
+            sws_freeContext(context);
+        }
+
+        const int nbThreads[] = {1, 0};
+        for (int set=ucapa::YuvConverter::SCALAR; set<=ucapa::YuvConverter::AVX2; ++set)
+        {
+            for (int t=0; t<2; ++t)
+            {
+                ucapa::YuvConverter converter(nbThreads[t]);
+                if (!converter.setInstructionSet((ucapa::YuvConverter::INSTRUCTION_SET)set) || (t > 0 && converter.getNbThreads() == 1))
+                    continue;
+
+                double time = measureFrame([&]() {
+                    converter.convert(planes, strides, WIDTH, HEIGHT, false, formats[f].format, converted.data(), stride);
+                });
+
+                // Difference with the bilinear swscale, the last one converted
+                int maxDifference = 0;
+                for (int row=0; row<HEIGHT; ++row)
+                {
+                    for (int x=0; x<WIDTH * ucapa::FrameHandle::getBytesPerPixel(formats[f].format); ++x)
+                        maxDifference = std::max(maxDifference, std::abs(converted[row * stride + x] - reference[row * stride + x]));
+                }
+
+                bench::report(std::string("yuv_") + ucapa::YuvConverter::getInstructionSetName(converter.getInstructionSet()) + "_" + formats[f].name,
+                              {{"threads", (double)converter.getNbThreads()},
+                               {"ms_per_frame", time},
+                               {"max_difference_with_sws", (double)maxDifference}});
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
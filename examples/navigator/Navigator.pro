@@ -29,7 +29,7 @@ win32 {
     LIBS += -L"$$_PRO_FILE_PWD_/../../external/ffmpeg/lib/" -lavformat -lavcodec -lswscale -lavutil
 }
 unix {
-    LIBS += -L/usr/local/lib -lavformat -lavcodec -lva -lz -lswscale -lavutil
+    LIBS += -L/usr/local/lib -lavformat -lavcodec -lva -lz -lswscale -lavutil -lrt
 #    LIBS += -I/usr/local/include  -pthread -L/usr/local/lib -lavformat -lavcodec -ldl -lvdpau -lva -lX11 -lasound -lSDL -lz -lswscale -lavutil -lm
 }
 
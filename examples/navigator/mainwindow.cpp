@@ -143,20 +143,13 @@ void MainWindow::timerEvent( QTimerEvent * evt )
         // Show the video stream in a QLabel
         if (m_drone.video().isActive())
         {
-            int width = m_drone.video().getWidth();
-            int height = m_drone.video().getHeight();
-            // Incorrect size
-            if (width == -1 || height == -1)
-            {
-                width = 640;
-                height = 360;
-            }
-            uint8_t* frame = m_drone.video().getFrame();
-            if (frame == nullptr)
+            // The frame is read in place, and released at the end of the block
+            ucapa::FrameHandle frame = m_drone.video().getLatestFrame();
+            if (!frame)
                 *m_videoPixmap = m_noSignalImage;
             else
             {
-                *m_videoPixmap = convertFrameToPixmap(frame, width, height);
+                *m_videoPixmap = convertFrameToPixmap(frame);
                 if(m_warning)
                     repaint();
             }
@@ -360,15 +353,14 @@ void MainWindow::calibration()
         m_drone.trim();
 }
 
-QPixmap MainWindow::convertFrameToPixmap(uint8_t *frameBuffer, int width, int height)
+QPixmap MainWindow::convertFrameToPixmap(const ucapa::FrameHandle& frame)
 {
-    QImage imgQt(width, height, QImage::Format_RGB32);
-    unsigned char *src = (unsigned char *)frameBuffer;
-
-    QRgb* dest = (QRgb *)imgQt.bits();
-    for (int i = 0 ; i < width*height; i++)
-        dest[i] = qRgb(src[3*i], src[3*i+1], src[3*i+2]);
+    // BGRA is the memory layout of Format_RGB32, the image wraps the frame without copy
+    const uint8_t* data = frame.getData(ucapa::FrameHandle::FORMAT_BGRA);
+    if (!data)
+        return m_noSignalImage;
 
+    QImage imgQt(data, frame.getWidth(), frame.getHeight(), frame.getStride(ucapa::FrameHandle::FORMAT_BGRA), QImage::Format_RGB32);
     return QPixmap::fromImage(imgQt);
 }
 
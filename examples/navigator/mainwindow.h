@@ -85,13 +85,11 @@ private:
     ucapa::ARDrone::VIDEO_CAMERA m_activeCamera;
 
     /**
-     * @brief Convert to pixmap an image represented by a buffer of uint8_t
-     * @param frameBuffer buffer representing the image (organised in R, G, B)
-     * @param width width of the image
-     * @param height height of the image
-     * @return pixmap corresponding to the buffer
+     * @brief Convert to pixmap a decoded frame
+     * @param frame frame of the video stream, read in the BGRA format of the pool and wrapped without copy
+     * @return pixmap corresponding to the frame
      */
-    QPixmap convertFrameToPixmap(uint8_t *frameBuffer, int width, int height);
+    QPixmap convertFrameToPixmap(const ucapa::FrameHandle& frame);
 
     /**
      * @brief convert the state of the drone mask to character chain
@@ -369,6 +369,18 @@ namespace ucapa{
          */
         virtual std::chrono::duration<double> getLastNavdataReception() const {return m_connectionsHandler->getLastNavdataReception();}
 
+        /**
+         * @brief Use the kernel reception time of navdata packets (Linux only).
+         * @param enable true to use kernel timestamps
+         * @return false if kernel timestamps are not available.
+         */
+        virtual bool setNavdataKernelTimestamps(bool enable) {return m_connectionsHandler->setKernelTimestamps(enable);}
+
+        /**
+         * @brief Return the smoothed delay between the kernel reception of navdata and their handling.
+         */
+        virtual std::chrono::duration<double> getNavdataReceptionLatency() const {return m_connectionsHandler->getNavdataReceptionLatency();}
+
         /**
          * @brief Permit to set the maximum altitude.
          * @param altitudeMax The maximum altitude.
@@ -412,6 +424,24 @@ namespace ucapa{
          */
         virtual void setComputeWorldData(bool b);
 
+        /**
+         * @brief Enable or disable the pose estimation in Navdata.
+         * @see Navdata::setEstimatePose
+         */
+        virtual void setEstimatePose(bool b);
+
+        /**
+         * @brief Publish every decoded navdata packet in shared memory.
+         * @param publisher An opened publisher, or nullptr to stop publishing.
+         */
+        virtual void setNavdataPublisher(std::shared_ptr<NavdataShmPublisher> publisher);
+
+        /**
+         * @brief Record every received navdata packet.
+         * @param recorder A log writer, or nullptr to stop recording.
+         */
+        virtual void setNavdataRecorder(std::shared_ptr<NavdataLogWriter> recorder);
+
         /**
          * @brief Accessor on navdata.
          * @return navdata content.
@@ -25,6 +25,7 @@
 #ifndef UCAPA_ARDRONECONNECTIONS_H
 #define UCAPA_ARDRONECONNECTIONS_H
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -82,8 +83,23 @@ namespace ucapa{
         // Navdata
         const static int m_max_length = 1024;
         char navdataBuffer[m_max_length]; // Used by asio to write received bytes
+        udp::endpoint m_navdataSenderEndpoint; // Used by asio to write the sender of received bytes
         std::chrono::steady_clock::time_point m_navdataLastReceptionTime;
         std::weak_ptr<Navdata> m_navdata;
+        std::atomic<bool> m_kernelTimestamps; ///< Use the kernel reception time of navdata packets
+        bool m_navdataPendingWithTimestamp; ///< Permit to know how the pending reception must be handled
+        std::atomic<long long> m_navdataLatency; ///< Smoothed delay between kernel reception and handling, in nanoseconds
+
+        /**
+         * @brief Wait asynchronously for the next navdata packet.
+         */
+        virtual void startNavdataReception();
+        /**
+         * @brief Read a pending navdata packet with its kernel reception time.
+         * @param receptionTime Set to the kernel reception time, converted to the steady clock.
+         * @return Number of bytes read, or -1 if nothing could be read.
+         */
+        virtual int receiveNavdataWithTimestamp(std::chrono::steady_clock::time_point& receptionTime);
 
 
     public:
@@ -125,6 +141,26 @@ namespace ucapa{
          */
         virtual void handleNavdata(std::error_code ec, std::size_t bytes_recvd);
 
+        /**
+         * @brief Use the time at which the kernel received navdata packets.
+         *
+         * The time taken in the reception handler includes the scheduling delay of the
+         * network thread. Kernel timestamps do not, but are only available on Linux.
+         * @param enable true to use kernel timestamps
+         * @return false if kernel timestamps are not available.
+         */
+        virtual bool setKernelTimestamps(bool enable);
+        /**
+         * @brief Check if kernel timestamps are used.
+         */
+        virtual bool isUsingKernelTimestamps() const {return m_kernelTimestamps;}
+        /**
+         * @brief Return the smoothed delay between the kernel reception of navdata packets and their handling.
+         *
+         * Only measured when kernel timestamps are used.
+         */
+        virtual std::chrono::duration<double> getNavdataReceptionLatency() const;
+
 
         /**
          * @brief Send initialisation packet to the drone video port.
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_CLOCKSYNC_H
+#define UCAPA_CLOCKSYNC_H
+
+#include <chrono>
+
+#include <config.h>
+
+namespace ucapa{
+    /**
+     * @brief Estimate the mapping between the drone clock and the host steady clock.
+     *
+     * Each sample pairs a drone timestamp with the host reception time. The
+     * reception time is the send time plus a positive network delay, so only
+     * the smallest host-minus-drone difference of each block of samples is kept.
+     * A line is then fitted through these minima to get both the offset and the
+     * drift of the drone clock. Everything is stored in fixed-size arrays.
+     */
+    class UCAPA_API ClockSync
+    {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+    protected:
+        static const int MAX_BLOCKS = 64;
+
+        double m_blockDuration;  ///< Duration covered by a block, in drone seconds.
+        int m_nbBlocks;          ///< Number of blocks used for the fit.
+
+        bool m_hasReference;     ///< True when m_hostReference is set.
+        TimePoint m_hostReference; ///< Host time used as origin to keep double precision.
+
+        double m_blockStart;     ///< Drone time of the first sample of the current block.
+        double m_blockMinDrone;  ///< Drone time of the current block minimum.
+        double m_blockMinDiff;   ///< Smallest host - drone difference in the current block.
+        bool m_blockEmpty;       ///< True if the current block has no sample.
+
+        double m_blockDrone[MAX_BLOCKS]; ///< Drone time of each finished block minimum.
+        double m_blockDiff[MAX_BLOCKS];  ///< Host - drone difference of each finished block minimum.
+        int m_nbFinishedBlocks;  ///< Number of valid entries in the block arrays.
+        int m_nextBlock;         ///< Next entry to overwrite in the block arrays.
+
+        double m_offset;         ///< Estimated host - drone difference at drone time 0, in seconds.
+        double m_drift;          ///< Estimated drift of the drone clock (host seconds per drone second - 1).
+
+        /**
+         * @brief Store the current block and update the fit.
+         */
+        void finishBlock();
+        /**
+         * @brief Fit the offset and drift through the block minima.
+         */
+        void fit();
+
+    public:
+        /**
+         * @brief Construct a clock estimator.
+         * @param blockDuration Duration of the blocks in which the minimum delay is searched, in seconds.
+         * @param nbBlocks Number of blocks used for the drift estimation (at most 64).
+         */
+        ClockSync(double blockDuration = 1.0, int nbBlocks = 32);
+
+        /**
+         * @brief Forget all the samples.
+         */
+        void reset();
+
+        /**
+         * @brief Add a pair of timestamps.
+         * @param droneTime Drone timestamp, in seconds, monotonic.
+         * @param receptionTime Host reception time of the packet carrying droneTime.
+         */
+        void addSample(double droneTime, TimePoint receptionTime);
+
+        /**
+         * @brief Check if at least one sample has been added.
+         */
+        bool isSynchronized() const {return m_hasReference;}
+
+        /**
+         * @brief Convert a drone timestamp into host time.
+         * @param droneTime Drone timestamp, in seconds.
+         * @return The estimated host time at which the drone took its timestamp.
+         */
+        TimePoint toHostTime(double droneTime) const;
+
+        /**
+         * @brief Return the estimated drift, in host seconds gained per drone second.
+         */
+        double getDrift() const {return m_drift;}
+    };
+}
+
+#endif // UCAPA_CLOCKSYNC_H
@@ -51,4 +51,34 @@
     #define UCAPA_API
 #endif
 
+// Explicit template instantiations take the export keyword only on Windows, GCC and Clang warn once the type is
+// defined, and export the instantiations with the default visibility
+#if defined(SHARED_BUILD) && (defined(_WIN32) || defined(WIN32)) && defined(ucapa_EXPORTS)
+    #define UCAPA_TEMPLATE_API UCAPA_API
+#else
+    #define UCAPA_TEMPLATE_API
+#endif
+
+// Instruction sets used by the vectorized code, define UCAPA_NO_SIMD to use plain C++ only
+#if !defined(UCAPA_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define UCAPA_HAS_SSE2
+    #endif
+    #if defined(__AVX__)
+        #define UCAPA_HAS_AVX
+    #endif
+    // Kernels compiled for AVX2 on their own, and only called if the CPU supports it
+    #if defined(UCAPA_HAS_SSE2) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+        ((defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1700))
+        #define UCAPA_HAS_AVX2_DISPATCH
+    #endif
+#endif
+
+// std::is_trivially_copyable is missing from libstdc++ before GCC 5
+#if defined(__GLIBCXX__) && defined(__GNUC__) && __GNUC__ < 5
+    #define UCAPA_HAS_IS_TRIVIALLY_COPYABLE 0
+#else
+    #define UCAPA_HAS_IS_TRIVIALLY_COPYABLE 1
+#endif
+
 #endif // CONFIG_H
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_FASTMATH_H
+#define UCAPA_FASTMATH_H
+
+#include <cstddef>
+
+#include <config.h>
+#include <quaternion.h>
+
+namespace ucapa{
+    /**
+     * @brief Vectorized trigonometry for the conversions done on every packet.
+     *
+     * The approximate functions reduce the angle to [-pi/4, pi/4] and evaluate a polynomial,
+     * 4 (SSE2) or 8 (AVX) angles at a time. Their absolute error is below 1e-6 for angles
+     * up to a few thousand radians. The exact functions use the standard library in double
+     * precision, and give the same results as Quaternion::setFromEulerAngles().
+     */
+    class UCAPA_API FastMath
+    {
+    public:
+        /**
+         * @brief Accuracy of the trigonometric functions
+         */
+        enum ACCURACY {
+            EXACT = 0,  ///< Standard library, in double precision
+            APPROXIMATE ///< Polynomial approximation, absolute error below 1e-6
+        };
+
+        /**
+         * @brief Compute the sine and the cosine of an angle.
+         * @param angle Angle, in radian
+         * @param sine,cosine Receive the results
+         * @param accuracy Accuracy of the computation
+         */
+        static void sinCos(float angle, float& sine, float& cosine, ACCURACY accuracy = APPROXIMATE);
+        /**
+         * @brief Compute the sines and the cosines of an array of angles.
+         * @param angles Angles, in radian
+         * @param n Number of angles
+         * @param sines,cosines Arrays of n floats receiving the results
+         * @param accuracy Accuracy of the computation
+         */
+        static void sinCos(const float* angles, std::size_t n, float* sines, float* cosines, ACCURACY accuracy = APPROXIMATE);
+
+        /**
+         * @brief Create a quaternion from Euler angles, as the Quaternion(x, y, z) constructor.
+         * @param x,y,z Euler angles, in radian
+         * @param accuracy Accuracy of the computation
+         * @return A normalized quaternion
+         */
+        static Quaternion eulerToQuaternion(float x, float y, float z, ACCURACY accuracy = APPROXIMATE);
+        /**
+         * @brief Convert an array of Euler angles to quaternions.
+         *
+         * The angles can come from a Vector3Array (x(), y() and z()).
+         * @param x,y,z Arrays of n Euler angles, in radian
+         * @param n Number of conversions
+         * @param quaternions Array of n quaternions receiving the results
+         * @param accuracy Accuracy of the computation
+         */
+        static void eulerToQuaternions(const float* x, const float* y, const float* z, std::size_t n,
+                                       Quaternion* quaternions, ACCURACY accuracy = APPROXIMATE);
+    };
+}
+
+#endif // UCAPA_FASTMATH_H
@@ -0,0 +1,259 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_FRAMEPOOL_H
+#define UCAPA_FRAMEPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include <config.h>
+
+namespace ucapa{
+    class FramePool;
+
+    /**
+     * @brief Read-only access to a decoded frame of a FramePool.
+     *
+     * The frame can't be overwritten while a handle on it exists, so it can be read
+     * without copy and without locking. Handles are cheap to copy, and keep the pool alive:
+     * a frame stays valid even after the video stream is released.
+     * Release the handles quickly, the decoder skips the frames while all the buffers are held.
+     *
+     * The native YUV420P planes are read without any conversion with getPlane(). The other
+     * formats are converted at the first request with getData(), once per frame and per format,
+     * then they are cached with the frame. The images produced by the writer for registered
+     * outputs (see Video::registerOutput()) are read with getOutput().
+     */
+    class UCAPA_API FrameHandle
+    {
+    public:
+        /**
+         * @brief Pixel formats of the frames
+         */
+        enum FORMAT {
+            FORMAT_YUV420P = 0, ///< Native format: Y plane, then U and V planes subsampled by 2, without conversion
+            FORMAT_RGB24,       ///< R, G, B
+            FORMAT_BGRA,        ///< B, G, R, 255, the layout of QImage::Format_RGB32 on little-endian hosts
+            FORMAT_RGBA,        ///< R, G, B, 255
+            FORMAT_GRAY8,       ///< Luma, the Y plane without conversion
+            NB_FORMATS
+        };
+
+        /**
+         * @brief Image derived from the frame by the writer, before the publication.
+         */
+        struct Image
+        {
+            int id;                 ///< Identifier of the output given by the writer, -1 if it is not produced for the frame
+            FORMAT format;
+            int width;
+            int height;
+            int stride;             ///< Number of bytes between two rows, a multiple of 32
+            uint8_t* data;          ///< First pixel, aligned on 32 bytes in memory
+            std::vector<uint8_t> memory; ///< Reused by the next frames written in the same buffer
+        };
+
+        /**
+         * @brief Storage of a frame, owned by the pool.
+         */
+        struct Buffer
+        {
+            const uint8_t* planes[3];   ///< Y, U and V planes, set by the writer
+            int strides[3];             ///< Number of bytes between two rows of each plane
+            std::shared_ptr<void> owner;    ///< Owner of the memory of the planes, released when the buffer is reused
+            std::chrono::steady_clock::time_point timestamp; ///< Time of the frame, given by the writer when it is published
+            uint64_t sequenceNumber;    ///< Number of the frame since the creation of the pool (starts at 1)
+            std::atomic<int> nbReaders; ///< Number of handles on the buffer
+            std::mutex conversionMutex; ///< Protect the converted images
+            bool converted[NB_FORMATS]; ///< Indicate if the image of a format is up to date
+            std::vector<uint8_t> memory[NB_FORMATS]; ///< Memory of the converted images, allocated at the first conversion
+            uint8_t* images[NB_FORMATS]; ///< Converted images, aligned on 32 bytes in memory
+            std::vector<Image> outputs; ///< Images produced by the writer, kept with the buffer
+        };
+
+    protected:
+        std::shared_ptr<const FramePool> m_pool;
+        Buffer* m_buffer;
+
+    public:
+        /**
+         * @brief Construct an invalid handle.
+         */
+        FrameHandle() : m_buffer(nullptr) {}
+        /**
+         * @brief Construct a handle on a buffer, the reader counter of the buffer must be already incremented.
+         */
+        FrameHandle(std::shared_ptr<const FramePool> pool, Buffer* buffer) : m_pool(pool), m_buffer(buffer) {}
+        FrameHandle(const FrameHandle& other);
+        FrameHandle(FrameHandle&& other);
+        ~FrameHandle();
+
+        FrameHandle& operator=(FrameHandle other);
+
+        /**
+         * @brief Check if the handle refers to a frame.
+         */
+        bool isValid() const {return m_buffer != nullptr;}
+        explicit operator bool() const {return isValid();}
+
+        /**
+         * @brief Release the frame, the handle becomes invalid.
+         */
+        void reset();
+
+        /**
+         * @brief Return a plane of the native YUV420P frame, without conversion.
+         * @param plane 0 for Y, 1 for U, 2 for V. U and V have half the width and the height of the frame
+         */
+        const uint8_t* getPlane(int plane) const {return m_buffer ? m_buffer->planes[plane] : nullptr;}
+        int getPlaneStride(int plane) const {return m_buffer ? m_buffer->strides[plane] : 0;}
+
+        /**
+         * @brief Return the first pixel of the frame in a format, rows are separated by getStride() bytes.
+         *
+         * The frame is converted at the first call for a format, by the calling thread.
+         * FORMAT_YUV420P and FORMAT_GRAY8 return the Y plane.
+         * @return The image, nullptr if the handle is invalid or the conversion failed.
+         */
+        const uint8_t* getData(FORMAT format = FORMAT_RGB24) const;
+        int getStride(FORMAT format = FORMAT_RGB24) const;
+        int getWidth() const;
+        int getHeight() const;
+        /**
+         * @brief Return an image produced with the frame for a registered output.
+         * @param id Identifier of the output
+         * @return The image, nullptr if it was not produced for this frame
+         */
+        const Image* getOutput(int id) const;
+        std::chrono::steady_clock::time_point getTimestamp() const {return m_buffer ? m_buffer->timestamp : std::chrono::steady_clock::time_point();}
+        uint64_t getSequenceNumber() const {return m_buffer ? m_buffer->sequenceNumber : 0;}
+
+        /**
+         * @brief Return the size of a pixel in a packed format, 0 for FORMAT_YUV420P.
+         */
+        static int getBytesPerPixel(FORMAT format);
+    };
+
+    /**
+     * @brief Buffers of decoded frames, shared between one writer and many readers.
+     *
+     * The writer takes a buffer read by nobody with acquire(), gives it the planes of a frame,
+     * and publishes it as the latest frame. Readers get the latest frame with getLatest(), as a FrameHandle.
+     * With three buffers, one can be written, one is the latest, and one is still read,
+     * so the writer never waits for a reader. When the readers hold all the buffers,
+     * acquire() fails and the frame is dropped instead.
+     * The pool must be created with std::make_shared, the handles share its ownership.
+     */
+    class UCAPA_API FramePool : public std::enable_shared_from_this<FramePool>
+    {
+    public:
+        /**
+         * @brief Function converting the planes of a buffer into a packed format.
+         *
+         * Called by the readers, possibly concurrently for different buffers or formats.
+         * Arguments: buffer, format, destination, destination stride. Return false if the conversion failed.
+         */
+        typedef std::function<bool(const FrameHandle::Buffer&, FrameHandle::FORMAT, uint8_t*, int)> Converter;
+
+    protected:
+        const int m_width;
+        const int m_height;
+        const Converter m_converter;
+        std::vector<FrameHandle::Buffer> m_buffers;
+        mutable std::mutex m_mutex;    ///< Protect m_latest and the increments of the reader counters, never held during a conversion
+        FrameHandle::Buffer* m_latest; ///< Last published buffer, nullptr before the first one
+        uint64_t m_nbPublished;
+        std::atomic<uint64_t> m_nbDropped;
+        mutable std::atomic<uint64_t> m_nbConversions;
+
+    public:
+        /**
+         * @brief Create the buffers, the converted images are only allocated at the first conversion.
+         * @param width,height Size of the frames, in pixels
+         * @param converter Function converting the frames into the packed formats
+         * @param nbBuffers Number of buffers, at least 3 so that the writer never waits
+         */
+        FramePool(int width, int height, Converter converter, int nbBuffers = 3);
+        virtual ~FramePool();
+
+        FramePool(const FramePool&) = delete;
+        FramePool& operator=(const FramePool&) = delete;
+
+        int getWidth() const {return m_width;}
+        int getHeight() const {return m_height;}
+        int getNbBuffers() const {return (int)m_buffers.size();}
+        /**
+         * @brief Return the stride of the converted images of a format, rows are padded to 32 bytes for the SIMD conversions.
+         */
+        int getStride(FrameHandle::FORMAT format) const {return (m_width * FrameHandle::getBytesPerPixel(format) + 31) & ~31;}
+
+        /**
+         * @brief Take a buffer to write the next frame, for the writer only.
+         *
+         * The buffer is neither the latest frame nor read, so it can be written without locking.
+         * Its converted images and its outputs are invalidated, and the owner of its previous planes is released.
+         * @return The buffer, nullptr if the readers hold all of them. In this case, the frame is counted as dropped.
+         */
+        FrameHandle::Buffer* acquire();
+        /**
+         * @brief Make a buffer returned by acquire() the latest frame.
+         * @param buffer Buffer filled by the writer
+         * @param timestamp Time of the frame
+         */
+        void publish(FrameHandle::Buffer* buffer, std::chrono::steady_clock::time_point timestamp);
+
+        /**
+         * @brief Return the latest published frame, without copy.
+         * @return The frame, an invalid handle if nothing is published yet
+         */
+        FrameHandle getLatest() const;
+
+        /**
+         * @brief Return the image of a buffer in a packed format, converted at the first call.
+         * @return The image, nullptr if the conversion failed
+         */
+        const uint8_t* convert(FrameHandle::Buffer* buffer, FrameHandle::FORMAT format) const;
+
+        /**
+         * @brief Return the number of frames published since the creation of the pool.
+         */
+        uint64_t getNbPublished() const;
+        /**
+         * @brief Return the number of frames dropped because all the buffers were held by readers.
+         */
+        uint64_t getNbDropped() const {return m_nbDropped;}
+        /**
+         * @brief Return the number of conversions done, at most one per frame and per format.
+         */
+        uint64_t getNbConversions() const {return m_nbConversions;}
+    };
+}
+
+#endif // UCAPA_FRAMEPOOL_H
@@ -25,22 +25,105 @@
 #ifndef UCAPA_MATRIX_H
 #define UCAPA_MATRIX_H
 
+#include <algorithm>
 #include <assert.h>
 #include <stdexcept>
+#include <type_traits>
 
 #include <vector3.h>
 
 namespace ucapa{
+    /**
+     * @brief Size of a Matrix dimension only known at run time
+     */
+    const int Dynamic = -1;
+
+    /**
+     * @brief Matrix of R rows and C columns.
+     *
+     * By default, the dimensions are set at run time, and the values are on the heap.
+     * With fixed dimensions, the values are stored inside the object, and the size of
+     * the operands is checked at compile time.
+     */
+    template<typename T, int R = Dynamic, int C = Dynamic>
+    class Matrix;
+
+    /**
+     * @brief Non-owning access to a rectangular part of a dynamic Matrix.
+     *
+     * A view is returned by Matrix::row(), Matrix::col(), Matrix::block() and Matrix::operator[].
+     * It borrows the values of the matrix, so it must not outlive it. T is const for a
+     * read-only view. A view is converted into a Matrix when a copy is needed.
+     */
+    template<typename T>
+    class MatrixView // Don't use UCAPA_API for a template class
+    {
+    public:
+        typedef typename std::remove_const<T>::type Scalar;
+
+    protected:
+        T* m_data;      ///< First value of the view
+        int m_nRow;     ///< Number of lines
+        int m_nCol;     ///< Number of columns
+        int m_stride;   ///< Distance between two lines in m_data
+
+    public:
+        MatrixView(T* data, int nbRow, int nbCol, int stride)
+            : m_data(data), m_nRow(nbRow), m_nCol(nbCol), m_stride(stride) {}
+
+        int getNbRows() const { return m_nRow; }
+        int getNbCols() const { return m_nCol; }
+
+        T& operator() (int i, int j) const
+        {
+            if(i>=0 && i<m_nRow && j>=0 && j<m_nCol)
+                return m_data[i*m_stride + j];
+            else
+                throw std::out_of_range("Access to an invalid value of the matrix view");
+        }
+
+        /**
+         * @brief Copy the values of a matrix of the same size in the viewed part.
+         */
+        template<typename M>
+        const MatrixView& operator= (const M& mat) const
+        {
+            static_assert(!std::is_const<T>::value, "Can't assign a read-only matrix view");
+            if (mat.getNbRows() != m_nRow || mat.getNbCols() != m_nCol)
+                throw std::length_error("Matrix view assignment error. (The two operands haven't a compatible size.)");
+            for (int i=0; i<m_nRow; ++i)
+                for (int j=0; j<m_nCol; ++j)
+                    m_data[i*m_stride + j] = (Scalar) mat(i, j);
+            return *this;
+        }
+        const MatrixView& operator= (const MatrixView& view) const { return operator=<MatrixView>(view); }
+
+        /**
+         * @brief Copy the viewed values in a new matrix
+         */
+        operator Matrix<Scalar>() const
+        {
+            Matrix<Scalar> mat(m_nRow, m_nCol);
+            for (int i=0; i<m_nRow; ++i)
+                for (int j=0; j<m_nCol; ++j)
+                    mat.data()[i*m_nCol + j] = m_data[i*m_stride + j];
+            return mat;
+        }
+    };
+
+
     template<typename T>
     /**
      * @brief The Matrix class provide the use of template matrix
+     *
+     * The values are stored in one contiguous buffer, row after row.
      */
-    class Matrix // Don't use UCAPA_API for a template class
+    class Matrix<T, Dynamic, Dynamic> // Don't use UCAPA_API for a template class
     {
     protected:
         int m_nRow; ///< Number of lines
         int m_nCol; ///< Number of columns
-        T** m_pdData; ///< Array of matrix values.
+        T* m_pdData; ///< Array of matrix values, row after row.
 
         /**
          * @brief Allocate memory for a matrix
@@ -71,6 +154,11 @@ namespace ucapa{
          * @param mat Matrix to copy
          */
         Matrix(const Matrix& mat);
+        /**
+         * @brief Move Constructors, mat is left empty
+         * @param mat Matrix to move
+         */
+        Matrix(Matrix&& mat);
         ~Matrix(void);
 
         /**
@@ -95,14 +183,30 @@ namespace ucapa{
          */
         int getNbCols() const { return m_nCol; }
 
+        /**
+         * @brief Direct access to the values, row after row
+         */
+        T* data() { return m_pdData; }
+        const T* data() const { return m_pdData; }
+
         //Operators
         Matrix& operator= (const Matrix &mat);
+        Matrix& operator= (Matrix &&mat);
         template<typename C> Matrix& operator= (const Matrix<C> &mat);
         // Acces operators
         T& operator() (int i, int j);
         const T& operator() (int i, int j) const;
-        // Get the column i of the matrix in an other matrix (m_nRow, 1)
-        Matrix<T> operator[] (int i) const;
+        // Get a view on the column i of the matrix, which can be converted to a matrix (m_nRow, 1)
+        MatrixView<const T> operator[] (int i) const;
+
+        // Views borrowing the values of the matrix
+        MatrixView<T> row(int i);
+        MatrixView<const T> row(int i) const;
+        MatrixView<T> col(int j);
+        MatrixView<const T> col(int j) const;
+        MatrixView<T> block(int i, int j, int nbRow, int nbCol);
+        MatrixView<const T> block(int i, int j, int nbRow, int nbCol) const;
+
         // Math operators
         Matrix operator-() const;
         Matrix& operator+= (const Matrix &mat);
@@ -133,8 +237,8 @@ namespace ucapa{
          */
         Matrix reduce();
 
-        template<typename T2>
-        friend Vector3 operator* (const Matrix<T2>& mat, const Vector3& vec);
+        template<typename T2, typename U>
+        friend BasicVector3<U> operator* (const Matrix<T2>& mat, const BasicVector3<U>& vec);
     };
 
 
@@ -145,6 +249,7 @@ namespace ucapa{
         : m_pdData(NULL)
     {
         alloc(lig, col);
+        Zero();
     }
 
 
@@ -157,6 +262,17 @@ namespace ucapa{
     }
 
 
+    template<typename T>
+    Matrix<T>::Matrix(Matrix&& mat)
+        : m_nRow(mat.m_nRow)
+        , m_nCol(mat.m_nCol)
+        , m_pdData(mat.m_pdData)
+    {
+        mat.m_nRow = mat.m_nCol = 0;
+        mat.m_pdData = NULL;
+    }
+
+
     template<typename T>
     Matrix<T>::~Matrix(void)
     {
@@ -171,9 +287,7 @@ namespace ucapa{
         m_nRow = lig > 0 ? lig : 0;
         m_nCol = col > 0 ? col : 0;
 
-        m_pdData = new T*[m_nRow];
-        for(int i=0; i<m_nRow; ++i)
-            m_pdData[i] = new T[m_nCol];
+        m_pdData = (m_nRow*m_nCol > 0) ? new T[m_nRow*m_nCol] : NULL;
     }
 
 
@@ -182,17 +296,15 @@ namespace ucapa{
     void Matrix<T>::copy(const Matrix<C>& mat)
     {
         assert(m_nRow == mat.getNbRows() && m_nCol == mat.getNbCols());
-        for(int i=0; i<m_nRow; ++i)
-            for(int j=0; j<m_nCol; ++j)
-                m_pdData[i][j] = (T) mat(i, j);
+        const C* src = mat.data();
+        for(int k=0; k<m_nRow*m_nCol; ++k)
+            m_pdData[k] = (T) src[k];
     }
 
 
     template<typename T>
     void Matrix<T>::destroy(void)
     {
-        for(int i=0; i<m_nRow; ++i)
-            delete[] m_pdData[i];
         delete[] m_pdData;
         m_nRow = m_nCol = 0;
         m_pdData = NULL;
@@ -202,9 +314,8 @@ namespace ucapa{
     template<typename T>
     Matrix<T>& Matrix<T>::Zero(void)
     {
-        for(int i=0; i<m_nRow; ++i)
-            for(int j=0; j<m_nCol; ++j)
-                m_pdData[i][j] = 0;
+        for(int k=0; k<m_nRow*m_nCol; ++k)
+            m_pdData[k] = 0;
         return *this;
     }
 
@@ -215,7 +326,7 @@ namespace ucapa{
         int min = (m_nRow<m_nCol) ? m_nRow : m_nCol;
         Zero();
         for (int i=0; i<min; i++)
-            m_pdData[i][i] = 1;
+            m_pdData[i*m_nCol + i] = 1;
         return *this;
     }
 
@@ -226,33 +337,52 @@ namespace ucapa{
     {
         if(this != &mat)
         {
-            destroy();
-            alloc(mat.getNbRows(), mat.getNbCols());
+            // Keep the buffer when the size doesn't change
+            if (m_nRow*m_nCol != mat.m_nRow*mat.m_nCol)
+            {
+                destroy();
+                alloc(mat.getNbRows(), mat.getNbCols());
+            }
+            m_nRow = mat.m_nRow;
+            m_nCol = mat.m_nCol;
             copy(mat);
         }
         return *this;
     }
 
     template<typename T>
-    template<typename C>
-    Matrix<T>& Matrix<T>::operator= (const Matrix<C> &mat)
+    Matrix<T>& Matrix<T>::operator= (Matrix &&mat)
     {
-        if(this != dynamic_cast<Matrix<T>*>(&mat))
+        if(this != &mat)
         {
             destroy();
-            alloc(mat.getNbRows(), mat.getNbCols());
-            copy(mat);
+            m_nRow = mat.m_nRow;
+            m_nCol = mat.m_nCol;
+            m_pdData = mat.m_pdData;
+            mat.m_nRow = mat.m_nCol = 0;
+            mat.m_pdData = NULL;
         }
         return *this;
     }
 
+    template<typename T>
+    template<typename C>
+    Matrix<T>& Matrix<T>::operator= (const Matrix<C> &mat)
+    {
+        // A matrix of an other type can't be this matrix
+        destroy();
+        alloc(mat.getNbRows(), mat.getNbCols());
+        copy(mat);
+        return *this;
+    }
+
 
 
     template<typename T>
     T& Matrix<T>::operator() (int i, int j)
     {
         if(i>=0 && i<m_nRow && j>=0 && j<m_nCol)
-            return m_pdData[i][j];
+            return m_pdData[i*m_nCol + j];
         else
             throw std::out_of_range("Access to an invalid value of the matrix");
     }
@@ -263,19 +393,57 @@ namespace ucapa{
     {
 
         if(i>=0 && i<m_nRow && j>=0 && j<m_nCol)
-            return m_pdData[i][j];
+            return m_pdData[i*m_nCol + j];
         else
             throw std::out_of_range("Access to an invalid value of the matrix");
 
     }
 
     template<typename T>
-    Matrix<T> Matrix<T>::operator[] (int j) const
+    MatrixView<const T> Matrix<T>::operator[] (int j) const
+    {
+        return col(j);
+    }
+
+
+    template<typename T>
+    MatrixView<T> Matrix<T>::row(int i)
+    {
+        return block(i, 0, 1, m_nCol);
+    }
+
+    template<typename T>
+    MatrixView<const T> Matrix<T>::row(int i) const
+    {
+        return block(i, 0, 1, m_nCol);
+    }
+
+    template<typename T>
+    MatrixView<T> Matrix<T>::col(int j)
     {
-        Matrix<T> m(m_nRow, 1);
-        for (int i=0; i<m_nRow; i++)
-            m(i, 0) = (*this)(i, j);
-        return m;
+        return block(0, j, m_nRow, 1);
+    }
+
+    template<typename T>
+    MatrixView<const T> Matrix<T>::col(int j) const
+    {
+        return block(0, j, m_nRow, 1);
+    }
+
+    template<typename T>
+    MatrixView<T> Matrix<T>::block(int i, int j, int nbRow, int nbCol)
+    {
+        if (i<0 || j<0 || nbRow<0 || nbCol<0 || i+nbRow>m_nRow || j+nbCol>m_nCol)
+            throw std::out_of_range("Matrix block outside of the matrix");
+        return MatrixView<T>(m_pdData + i*m_nCol + j, nbRow, nbCol, m_nCol);
+    }
+
+    template<typename T>
+    MatrixView<const T> Matrix<T>::block(int i, int j, int nbRow, int nbCol) const
+    {
+        if (i<0 || j<0 || nbRow<0 || nbCol<0 || i+nbRow>m_nRow || j+nbCol>m_nCol)
+            throw std::out_of_range("Matrix block outside of the matrix");
+        return MatrixView<const T>(m_pdData + i*m_nCol + j, nbRow, nbCol, m_nCol);
     }
 
 
@@ -284,11 +452,8 @@ namespace ucapa{
     Matrix<T> Matrix<T>::operator-() const
     {
         Matrix<T> tempMat(m_nRow, m_nCol);
-        for(int i=0; i<m_nRow; ++i)
-        {
-            for(int j=0; j<m_nCol; ++j)
-                tempMat(i,j) = -(*this)(i,j);
-        }
+        for(int k=0; k<m_nRow*m_nCol; ++k)
+            tempMat.m_pdData[k] = -m_pdData[k];
 
         return tempMat;
     }
@@ -299,11 +464,8 @@ namespace ucapa{
     {
         if (m_nRow == mat.m_nRow && m_nCol == mat.m_nCol)
         {
-            for (int i=0 ; i<m_nRow ; ++i) {
-                for (int j=0 ; j<m_nCol ; ++j) {
-                    m_pdData[i][j] += mat(i,j);
-                }
-            }
+            for (int k=0; k<m_nRow*m_nCol; ++k)
+                m_pdData[k] += mat.m_pdData[k];
             return *this;
         }
         else
@@ -316,10 +478,9 @@ namespace ucapa{
     {
         if (m_nRow == mat.m_nRow && m_nCol == mat.m_nCol)
         {
-            Matrix<T> tempMat(mat.m_nRow, mat.m_nCol);
-            tempMat.Zero();
-            tempMat+=(*this);
-            tempMat+=mat;
+            Matrix<T> tempMat(m_nRow, m_nCol);
+            for (int k=0; k<m_nRow*m_nCol; ++k)
+                tempMat.m_pdData[k] = m_pdData[k] + mat.m_pdData[k];
             return tempMat;
         }
         else
@@ -332,11 +493,8 @@ namespace ucapa{
     {
         if (m_nRow == mat.m_nRow && m_nCol == mat.m_nCol)
         {
-            for (int i=0 ; i<m_nRow ; ++i) {
-                for (int j=0 ; j<m_nCol ; ++j) {
-                    m_pdData[i][j] -= mat(i,j);
-                }
-            }
+            for (int k=0; k<m_nRow*m_nCol; ++k)
+                m_pdData[k] -= mat.m_pdData[k];
             return *this;
         }
         else
@@ -349,10 +507,9 @@ namespace ucapa{
     {
         if (m_nRow == mat.m_nRow && m_nCol == mat.m_nCol)
         {
-            Matrix<T> tempMat(mat.m_nRow, mat.m_nCol);
-            tempMat.Zero();
-            tempMat+=(*this);
-            tempMat-=mat;
+            Matrix<T> tempMat(m_nRow, m_nCol);
+            for (int k=0; k<m_nRow*m_nCol; ++k)
+                tempMat.m_pdData[k] = m_pdData[k] - mat.m_pdData[k];
             return tempMat;
         }
         else
@@ -365,12 +522,30 @@ namespace ucapa{
     {
         if (mat.m_nRow == m_nCol)
         {
-            Matrix<T> tempMat(m_nRow, mat.m_nCol);
-            tempMat.Zero();
-            for(int i = 0 ; i< m_nRow ; ++i) {
-                for (int j=0; j < mat.m_nCol; ++j) {
-                    for (int k = 0; k < m_nCol; ++k) {
-                        tempMat(i, j) += (*this)(i, k) * mat(k, j);
+            // Blocks small enough for the three of them to stay in the L1 cache
+            const int BLOCK = 48;
+            const int n = m_nRow, m = m_nCol, p = mat.m_nCol;
+
+            Matrix<T> tempMat(n, p);
+            const T* a = m_pdData;
+            const T* b = mat.m_pdData;
+            T* c = tempMat.m_pdData;
+
+            for (int i0 = 0; i0 < n; i0 += BLOCK) {
+                const int i1 = (i0 + BLOCK < n) ? i0 + BLOCK : n;
+                for (int k0 = 0; k0 < m; k0 += BLOCK) {
+                    const int k1 = (k0 + BLOCK < m) ? k0 + BLOCK : m;
+                    for (int j0 = 0; j0 < p; j0 += BLOCK) {
+                        const int j1 = (j0 + BLOCK < p) ? j0 + BLOCK : p;
+                        for (int i = i0; i < i1; ++i) {
+                            for (int k = k0; k < k1; ++k) {
+                                const T aik = a[i*m + k];
+                                const T* bk = b + k*p;
+                                T* ci = c + i*p;
+                                for (int j = j0; j < j1; ++j)
+                                    ci[j] += aik * bk[j];
+                            }
+                        }
                     }
                 }
             }
@@ -386,11 +561,9 @@ namespace ucapa{
     {
         if (m_nRow == mat.m_nRow && m_nCol == mat.m_nCol)
         {
-            for (int i=0 ; i<m_nRow ; ++i) {
-                for (int j=0 ; j<m_nCol ; ++j) {
-                    if ( mat(i,j) != m_pdData[i][j] )
-                        return false;
-                }
+            for (int k=0; k<m_nRow*m_nCol; ++k) {
+                if ( mat.m_pdData[k] != m_pdData[k] )
+                    return false;
             }
             return true;
         }
@@ -398,6 +571,7 @@ namespace ucapa{
             return false;
     }
 
+
     template<typename T>
     bool Matrix<T>::operator!= (const Matrix &mat) const
     {
@@ -411,7 +585,7 @@ namespace ucapa{
         Matrix<T> mat(m_nCol, m_nRow);
         for(int i = 0 ; i<m_nRow ; ++i) {
                 for (int j=0; j < m_nCol; ++j) {
-                    mat(j, i)=(*this)(i, j);
+                    mat.m_pdData[j*m_nRow + i] = m_pdData[i*m_nCol + j];
                 }
         }
         return mat;
@@ -421,16 +595,12 @@ namespace ucapa{
     template<typename T>
     void Matrix<T>::swapRows(int row1, int row2)
     {
+        if (row1 < 0 || row1 >= m_nRow || row2 < 0 || row2 >= m_nRow)
+            throw std::out_of_range("Swap of an invalid row of the matrix");
         if (row1 == row2)
             return;
 
-        T tmp;
-        for (int i=0; i < m_nCol; i++)
-        {
-            tmp = (*this)(i, row1);
-            (*this)(i, row1) = (*this)(i, row2);
-            (*this)(i, row2) = tmp;
-        }
+        std::swap_ranges(m_pdData + row1*m_nCol, m_pdData + (row1+1)*m_nCol, m_pdData + row2*m_nCol);
     }
 
     template<typename T>
@@ -445,7 +615,7 @@ namespace ucapa{
                 break;
 
             int i = row;
-            while (reduced(lead, i) == 0)
+            while (reduced(i, lead) == 0)
             {
                 i++;
                 if (i == reduced.m_nRow)
@@ -459,37 +629,326 @@ namespace ucapa{
 
             reduced.swapRows(i, row);
 
-            T divFactor = reduced(lead, row);
+            T divFactor = reduced(row, lead);
             for (int k = 0; k < reduced.m_nCol; k++)
             {
-                reduced(k, row) = reduced(k, row) / divFactor;
+                reduced(row, k) = reduced(row, k) / divFactor;
             }
 
             for (int j = 0; j < reduced.m_nRow; j++)
             {
                 if (j == row) continue;
 
-                T factor = reduced(lead, j);
+                T factor = reduced(j, lead);
                 for (int k = 0; k < reduced.m_nCol; k++)
                 {
-                    reduced(k, j) = reduced(k, j) - reduced(k, row) * factor;
+                    reduced(j, k) = reduced(j, k) - reduced(row, k) * factor;
                 }
             }
 
+            lead++;
         }
         return reduced;
     }
 
 
-    template<typename T2>
-    Vector3 operator* (const Matrix<T2>& mat, const Vector3& vec)
+    template<typename T2, typename U>
+    BasicVector3<U> operator* (const Matrix<T2>& mat, const BasicVector3<U>& vec)
     {
         if (mat.m_nRow != 4 || mat.m_nCol != 4)
             throw std::invalid_argument("Matrix and Vector3 multiplication error. Matrix must have the size (4, 4)");
 
-        return Vector3(mat(0, 0)*vec.x + mat(0, 1)*vec.y + mat(0, 2)*vec.z,
-                       mat(1, 0)*vec.x + mat(1, 1)*vec.y + mat(1, 2)*vec.z,
-                       mat(2, 0)*vec.x + mat(2, 1)*vec.y + mat(2, 2)*vec.z);
+        return BasicVector3<U>(mat(0, 0)*vec.x + mat(0, 1)*vec.y + mat(0, 2)*vec.z,
+                               mat(1, 0)*vec.x + mat(1, 1)*vec.y + mat(1, 2)*vec.z,
+                               mat(2, 0)*vec.x + mat(2, 1)*vec.y + mat(2, 2)*vec.z);
+    }
+
+
+    /**
+     * @brief Base class of the fixed-size matrices and of the expressions combining them.
+     *
+     * Additions, subtractions, negations and scalings are not computed when the operator
+     * is called: they return an expression which computes each value when the result is
+     * assigned to a matrix, so no intermediate matrix is created. An element of these
+     * expressions only depends on the same element of the operands, so a matrix can be
+     * used on both sides of an assignment. Products and transposes are computed at once,
+     * in a matrix on the stack.
+     * An expression keeps references on its operands, so it must not be stored.
+     */
+    template<typename E, typename T, int R, int C>
+    class MatrixExpression
+    {
+    public:
+        typedef T Scalar;
+        static constexpr int ROWS = R;
+        static constexpr int COLS = C;
+
+        static constexpr int getNbRows() { return R; }
+        static constexpr int getNbCols() { return C; }
+
+        const E& derived() const { return static_cast<const E&>(*this); }
+        T operator() (int i, int j) const { return derived()(i, j); }
+    };
+
+    /**
+     * @brief Element-wise combination of two expressions.
+     */
+    template<typename Op, typename E1, typename E2, typename T, int R, int C>
+    class MatrixBinaryExpression : public MatrixExpression<MatrixBinaryExpression<Op, E1, E2, T, R, C>, T, R, C>
+    {
+    protected:
+        const E1& m_left;
+        const E2& m_right;
+
+    public:
+        MatrixBinaryExpression(const E1& left, const E2& right) : m_left(left), m_right(right) {}
+        T operator() (int i, int j) const { return Op::apply(m_left(i, j), m_right(i, j)); }
+    };
+
+    /**
+     * @brief Element-wise transformation of an expression.
+     */
+    template<typename Op, typename E, typename T, int R, int C>
+    class MatrixUnaryExpression : public MatrixExpression<MatrixUnaryExpression<Op, E, T, R, C>, T, R, C>
+    {
+    protected:
+        const E& m_operand;
+        const T m_scalar;
+
+    public:
+        MatrixUnaryExpression(const E& operand, T scalar = T()) : m_operand(operand), m_scalar(scalar) {}
+        T operator() (int i, int j) const { return Op::apply(m_operand(i, j), m_scalar); }
+    };
+
+    namespace matrixop{
+        struct Add { template<typename T> static T apply(T a, T b) { return a + b; } };
+        struct Subtract { template<typename T> static T apply(T a, T b) { return a - b; } };
+        struct Negate { template<typename T> static T apply(T a, T) { return -a; } };
+        struct Scale { template<typename T> static T apply(T a, T s) { return a * s; } };
+    }
+
+
+    template<typename T, int R, int C>
+    /**
+     * @brief Matrix with dimensions known at compile time.
+     *
+     * The values are stored contiguously, row after row, inside the object.
+     */
+    class Matrix : public MatrixExpression<Matrix<T, R, C>, T, R, C>
+    {
+        static_assert(R > 0 && C > 0, "A fixed-size matrix must have at least one row and one column");
+
+    protected:
+        alignas(16) T m_data[R*C]; ///< Values, row after row
+
+    public:
+        /**
+         * @brief Construct a matrix filled with zeros
+         */
+        Matrix() : m_data() {}
+        /**
+         * @brief Construct a matrix from the result of an expression
+         */
+        template<typename E>
+        Matrix(const MatrixExpression<E, T, R, C>& expression) { *this = expression; }
+
+        /**
+         * @brief Return a matrix filled with zeros
+         */
+        static Matrix zero() { return Matrix(); }
+        /**
+         * @brief Return the identity matrix (or to the nearest matrix for a non-square matrix)
+         */
+        static Matrix identity() { Matrix m; m.setToIdentity(); return m; }
+
+        Matrix& Zero()
+        {
+            for (int k=0; k<R*C; ++k)
+                m_data[k] = 0;
+            return *this;
+        }
+        Matrix& setToIdentity()
+        {
+            Zero();
+            for (int i=0; i<R && i<C; ++i)
+                m_data[i*C + i] = 1;
+            return *this;
+        }
+
+        // Acces operators, the indexes are only checked in debug
+        T& operator() (int i, int j) { assert(i>=0 && i<R && j>=0 && j<C); return m_data[i*C + j]; }
+        const T& operator() (int i, int j) const { assert(i>=0 && i<R && j>=0 && j<C); return m_data[i*C + j]; }
+        // Acces to the element i of a vector (matrix with one row or one column)
+        T& operator() (int i) { static_assert(R == 1 || C == 1, "Linear access is only allowed on vectors"); assert(i>=0 && i<R*C); return m_data[i]; }
+        const T& operator() (int i) const { static_assert(R == 1 || C == 1, "Linear access is only allowed on vectors"); assert(i>=0 && i<R*C); return m_data[i]; }
+
+        T* data() { return m_data; }
+        const T* data() const { return m_data; }
+
+        template<typename E>
+        Matrix& operator= (const MatrixExpression<E, T, R, C>& expression)
+        {
+            const E& e = expression.derived();
+            for (int i=0; i<R; ++i)
+                for (int j=0; j<C; ++j)
+                    m_data[i*C + j] = e(i, j);
+            return *this;
+        }
+        template<typename E>
+        Matrix& operator+= (const MatrixExpression<E, T, R, C>& expression)
+        {
+            const E& e = expression.derived();
+            for (int i=0; i<R; ++i)
+                for (int j=0; j<C; ++j)
+                    m_data[i*C + j] += e(i, j);
+            return *this;
+        }
+        template<typename E>
+        Matrix& operator-= (const MatrixExpression<E, T, R, C>& expression)
+        {
+            const E& e = expression.derived();
+            for (int i=0; i<R; ++i)
+                for (int j=0; j<C; ++j)
+                    m_data[i*C + j] -= e(i, j);
+            return *this;
+        }
+        Matrix& operator*= (T s)
+        {
+            for (int k=0; k<R*C; ++k)
+                m_data[k] *= s;
+            return *this;
+        }
+
+        bool operator== (const Matrix& mat) const
+        {
+            for (int k=0; k<R*C; ++k)
+                if (m_data[k] != mat.m_data[k])
+                    return false;
+            return true;
+        }
+        bool operator!= (const Matrix& mat) const { return !(*this == mat); }
+
+        /**
+         * @brief Compute the transpose of the matrix
+         * @return The transpose of the matrix
+         */
+        Matrix<T, C, R> transponate() const
+        {
+            Matrix<T, C, R> mat;
+            for (int i=0; i<R; ++i)
+                for (int j=0; j<C; ++j)
+                    mat(j, i) = m_data[i*C + j];
+            return mat;
+        }
+
+        /**
+         * @brief Copy the matrix in a matrix with dynamic dimensions
+         */
+        Matrix<T> toDynamic() const
+        {
+            Matrix<T> mat(R, C);
+            for (int i=0; i<R; ++i)
+                for (int j=0; j<C; ++j)
+                    mat(i, j) = m_data[i*C + j];
+            return mat;
+        }
+    };
+
+    typedef Matrix<float, 3, 3> Matrix3f;
+    typedef Matrix<float, 4, 4> Matrix4f;
+    typedef Matrix<double, 3, 3> Matrix3d;
+    typedef Matrix<double, 4, 4> Matrix4d;
+
+
+    template<typename E1, typename E2, typename T, int R1, int C1, int R2, int C2>
+    MatrixBinaryExpression<matrixop::Add, E1, E2, T, R1, C1>
+    operator+ (const MatrixExpression<E1, T, R1, C1>& a, const MatrixExpression<E2, T, R2, C2>& b)
+    {
+        static_assert(R1 == R2 && C1 == C2, "Matrix addition error. (The two operands haven't a compatible size.)");
+        return MatrixBinaryExpression<matrixop::Add, E1, E2, T, R1, C1>(a.derived(), b.derived());
+    }
+
+    template<typename E1, typename E2, typename T, int R1, int C1, int R2, int C2>
+    MatrixBinaryExpression<matrixop::Subtract, E1, E2, T, R1, C1>
+    operator- (const MatrixExpression<E1, T, R1, C1>& a, const MatrixExpression<E2, T, R2, C2>& b)
+    {
+        static_assert(R1 == R2 && C1 == C2, "Matrix substraction error. (The two operands haven't a compatible size.)");
+        return MatrixBinaryExpression<matrixop::Subtract, E1, E2, T, R1, C1>(a.derived(), b.derived());
+    }
+
+    template<typename E, typename T, int R, int C>
+    MatrixUnaryExpression<matrixop::Negate, E, T, R, C> operator- (const MatrixExpression<E, T, R, C>& a)
+    {
+        return MatrixUnaryExpression<matrixop::Negate, E, T, R, C>(a.derived());
+    }
+
+    template<typename E, typename T, int R, int C>
+    MatrixUnaryExpression<matrixop::Scale, E, T, R, C> operator* (const MatrixExpression<E, T, R, C>& a, typename std::common_type<T>::type s)
+    {
+        return MatrixUnaryExpression<matrixop::Scale, E, T, R, C>(a.derived(), s);
+    }
+
+    template<typename E, typename T, int R, int C>
+    MatrixUnaryExpression<matrixop::Scale, E, T, R, C> operator* (typename std::common_type<T>::type s, const MatrixExpression<E, T, R, C>& a)
+    {
+        return MatrixUnaryExpression<matrixop::Scale, E, T, R, C>(a.derived(), s);
+    }
+
+    template<typename E1, typename E2, typename T, int R1, int C1, int R2, int C2>
+    Matrix<T, R1, C2> operator* (const MatrixExpression<E1, T, R1, C1>& a, const MatrixExpression<E2, T, R2, C2>& b)
+    {
+        static_assert(C1 == R2, "Matrix multiplication error. (The two operands haven't a compatible size.)");
+        const E1& left = a.derived();
+        const E2& right = b.derived();
+
+        Matrix<T, R1, C2> mat;
+        for (int i=0; i<R1; ++i)
+            for (int k=0; k<C1; ++k)
+            {
+                const T value = left(i, k);
+                for (int j=0; j<C2; ++j)
+                    mat(i, j) += value * right(k, j);
+            }
+        return mat;
+    }
+
+    /**
+     * @brief Product of two fixed-size matrices, on their values directly
+     *
+     * Preferred to the product of expressions when both operands are matrices.
+     */
+    template<typename T, int R, int K, int C>
+    typename std::enable_if<R != Dynamic, Matrix<T, R, C> >::type
+    operator* (const Matrix<T, R, K>& a, const Matrix<T, K, C>& b)
+    {
+        const T* left = a.data();
+        const T* right = b.data();
+
+        Matrix<T, R, C> mat;
+        T* result = mat.data();
+        for (int i=0; i<R; ++i)
+            for (int k=0; k<K; ++k)
+            {
+                const T value = left[i*K + k];
+                for (int j=0; j<C; ++j)
+                    result[i*C + j] += value * right[k*C + j];
+            }
+        return mat;
+    }
+
+    /**
+     * @brief Multiply a vector by a 3x3 matrix, or by the rotation part of a 4x4 matrix
+     *
+     * The result has the precision of the vector.
+     */
+    template<typename E, typename T, int R, int C, typename U>
+    BasicVector3<U> operator* (const MatrixExpression<E, T, R, C>& mat, const BasicVector3<U>& vec)
+    {
+        static_assert((R == 3 && C == 3) || (R == 4 && C == 4), "Matrix and Vector3 multiplication error. Matrix must have the size (3, 3) or (4, 4)");
+        const E& m = mat.derived();
+        return BasicVector3<U>(m(0, 0)*vec.x + m(0, 1)*vec.y + m(0, 2)*vec.z,
+                               m(1, 0)*vec.x + m(1, 1)*vec.y + m(1, 2)*vec.z,
+                               m(2, 0)*vec.x + m(2, 1)*vec.y + m(2, 2)*vec.z);
     }
 }
 
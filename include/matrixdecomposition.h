@@ -0,0 +1,490 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_MATRIXDECOMPOSITION_H
+#define UCAPA_MATRIXDECOMPOSITION_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <matrix.h>
+
+namespace ucapa{
+    namespace matrixdetail{
+        /**
+         * @brief Dimension of a matrix, a constant for the fixed-size matrices so the loops
+         * using it have a known number of iterations and can be unrolled by the compiler.
+         */
+        template<int N>
+        struct Dimension { static int get(int) { return N; } };
+        template<>
+        struct Dimension<Dynamic> { static int get(int n) { return n; } };
+
+        /**
+         * @brief Create a matrix, the size is only used by the dynamic matrices
+         */
+        template<typename T, int R, int C>
+        struct Factory { static Matrix<T, R, C> create(int, int) { return Matrix<T, R, C>(); } };
+        template<typename T>
+        struct Factory<T, Dynamic, Dynamic> { static Matrix<T> create(int nbRows, int nbCols) { return Matrix<T>(nbRows, nbCols); } };
+
+        /**
+         * @brief Temporary array of n values, on the stack for the fixed-size matrices
+         */
+        template<typename T, int N>
+        struct Buffer { T values[N]; explicit Buffer(int) {} T& operator[](int i) { return values[i]; } };
+        template<typename T>
+        struct Buffer<T, Dynamic> { std::vector<T> values; explicit Buffer(int n) : values(n) {} T& operator[](int i) { return values[i]; } };
+
+        // The kernels work on the values of the matrices, stored row after row.
+        // n is the size of the square matrix, m the number of columns of the right-hand side.
+
+        /**
+         * @brief Solve L * x = b in place, L lower triangular
+         */
+        template<typename T, int N, int M>
+        void forwardSubstitution(const T* L, T* b, int n_, int m_, bool unitDiagonal)
+        {
+            const int n = Dimension<N>::get(n_), m = Dimension<M>::get(m_);
+            for (int i=0; i<n; ++i)
+            {
+                for (int k=0; k<i; ++k)
+                {
+                    const T l = L[i*n + k];
+                    for (int j=0; j<m; ++j)
+                        b[i*m + j] -= l * b[k*m + j];
+                }
+                if (!unitDiagonal)
+                {
+                    const T d = 1 / L[i*n + i];
+                    for (int j=0; j<m; ++j)
+                        b[i*m + j] *= d;
+                }
+            }
+        }
+
+        /**
+         * @brief Solve U * x = b in place, U upper triangular
+         */
+        template<typename T, int N, int M>
+        void backSubstitution(const T* U, T* b, int n_, int m_)
+        {
+            const int n = Dimension<N>::get(n_), m = Dimension<M>::get(m_);
+            for (int i=n-1; i>=0; --i)
+            {
+                for (int k=i+1; k<n; ++k)
+                {
+                    const T u = U[i*n + k];
+                    for (int j=0; j<m; ++j)
+                        b[i*m + j] -= u * b[k*m + j];
+                }
+                const T d = 1 / U[i*n + i];
+                for (int j=0; j<m; ++j)
+                    b[i*m + j] *= d;
+            }
+        }
+
+        /**
+         * @brief Solve L^T * x = b in place, L lower triangular
+         */
+        template<typename T, int N, int M>
+        void transposedBackSubstitution(const T* L, T* b, int n_, int m_)
+        {
+            const int n = Dimension<N>::get(n_), m = Dimension<M>::get(m_);
+            for (int i=n-1; i>=0; --i)
+            {
+                for (int k=i+1; k<n; ++k)
+                {
+                    const T l = L[k*n + i];
+                    for (int j=0; j<m; ++j)
+                        b[i*m + j] -= l * b[k*m + j];
+                }
+                const T d = 1 / L[i*n + i];
+                for (int j=0; j<m; ++j)
+                    b[i*m + j] *= d;
+            }
+        }
+
+        /**
+         * @brief LU decomposition with scaled partial pivoting, in place
+         * @return false if the matrix is singular
+         */
+        template<typename T, int N>
+        bool luDecompose(T* a, int* permutation, int& sign, int n_)
+        {
+            const int n = Dimension<N>::get(n_);
+
+            // Each row is compared to its own largest value (implicit row scaling), so that the rows in different units
+            // don't make each other look singular. A zero or infinite row has no valid pivot.
+            Buffer<T, N> inverseScales(n);
+            for (int i=0; i<n; ++i)
+            {
+                T scale = 0;
+                for (int j=0; j<n; ++j)
+                    scale = std::max(scale, (T)std::abs(a[i*n + j]));
+                inverseScales[i] = (scale > 0) ? 1 / scale : 0;
+            }
+            // A pivot negligible compared to the values of its row is treated as zero
+            const T tolerance = n * std::numeric_limits<T>::epsilon();
+
+            bool invertible = true;
+            sign = 1;
+            for (int i=0; i<n; ++i)
+                permutation[i] = i;
+
+            for (int k=0; k<n; ++k)
+            {
+                int pivot = k;
+                T pivotSize = std::abs(a[k*n + k]) * inverseScales[permutation[k]];
+                for (int i=k+1; i<n; ++i)
+                {
+                    const T size = std::abs(a[i*n + k]) * inverseScales[permutation[i]];
+                    if (size > pivotSize)
+                    {
+                        pivot = i;
+                        pivotSize = size;
+                    }
+                }
+
+                if (pivot != k)
+                {
+                    std::swap_ranges(a + k*n, a + (k+1)*n, a + pivot*n);
+                    std::swap(permutation[k], permutation[pivot]);
+                    sign = -sign;
+                }
+
+                if (!(pivotSize > tolerance))
+                {
+                    invertible = false;
+                    continue;
+                }
+
+                const T inversePivot = 1 / a[k*n + k];
+                for (int i=k+1; i<n; ++i)
+                {
+                    const T l = (a[i*n + k] *= inversePivot);
+                    for (int j=k+1; j<n; ++j)
+                        a[i*n + j] -= l * a[k*n + j];
+                }
+            }
+            return invertible;
+        }
+
+        /**
+         * @brief Cholesky decomposition in place, only the lower triangle is read and the upper one is set to 0
+         * @return false if the matrix isn't symmetric positive definite
+         */
+        template<typename T, int N>
+        bool choleskyDecompose(T* a, int n_)
+        {
+            const int n = Dimension<N>::get(n_);
+            for (int j=0; j<n; ++j)
+            {
+                T d = a[j*n + j];
+                for (int k=0; k<j; ++k)
+                    d -= a[j*n + k] * a[j*n + k];
+                if (!(d > 0))
+                    return false;
+
+                const T l = std::sqrt(d);
+                a[j*n + j] = l;
+                const T inverseL = 1 / l;
+                for (int i=j+1; i<n; ++i)
+                {
+                    T v = a[i*n + j];
+                    for (int k=0; k<j; ++k)
+                        v -= a[i*n + k] * a[j*n + k];
+                    a[i*n + j] = v * inverseL;
+                    a[j*n + i] = 0;
+                }
+            }
+            return true;
+        }
+
+        template<typename T, int N>
+        void checkSquare(const Matrix<T, N, N>& m, const char* operation)
+        {
+            if (m.getNbRows() != m.getNbCols())
+                throw std::length_error(std::string(operation) + " error. (The matrix isn't square.)");
+        }
+
+        template<typename T, int N, int M>
+        void checkRightHandSide(const Matrix<T, N, N>& m, const Matrix<T, N, M>& b, const char* operation)
+        {
+            if (b.getNbRows() != m.getNbRows())
+                throw std::length_error(std::string(operation) + " error. (The two operands haven't a compatible size.)");
+        }
+    }
+
+
+    template<typename T, int N = Dynamic>
+    /**
+     * @brief LU decomposition with partial pivoting: P * A = L * U.
+     *
+     * Works with any invertible square matrix. The decomposition is computed once, then
+     * solve() and inverse() reuse it. With a fixed-size matrix, nothing is allocated.
+     */
+    class LUDecomposition // Don't use UCAPA_API for a template class
+    {
+    public:
+        typedef Matrix<T, N, N> MatrixType;
+
+    protected:
+        MatrixType m_lu; ///< L below the diagonal (its diagonal is 1 and not stored), U on and above
+        Matrix<int, N, N == Dynamic ? Dynamic : 1> m_permutation; ///< Row i of L * U is the row m_permutation(i, 0) of A
+        int m_sign; ///< Sign of the permutation
+        bool m_invertible;
+
+    public:
+        LUDecomposition() : m_sign(1), m_invertible(false) {}
+        explicit LUDecomposition(const MatrixType& m) : m_sign(1), m_invertible(false) { compute(m); }
+
+        /**
+         * @brief Decompose a matrix, replacing the previous decomposition
+         * @return false if the matrix is singular
+         */
+        bool compute(const MatrixType& m)
+        {
+            matrixdetail::checkSquare(m, "LU decomposition");
+            const int n = m.getNbRows();
+            m_lu = m;
+            if (m_permutation.getNbRows() != n)
+                m_permutation = matrixdetail::Factory<int, N, N == Dynamic ? Dynamic : 1>::create(n, 1);
+
+            m_invertible = matrixdetail::luDecompose<T, N>(m_lu.data(), m_permutation.data(), m_sign, n);
+            return m_invertible;
+        }
+
+        bool isInvertible() const { return m_invertible; }
+
+        /**
+         * @brief Return the determinant of the decomposed matrix
+         */
+        T determinant() const
+        {
+            const int n = m_lu.getNbRows();
+            T det = (T)m_sign;
+            for (int i=0; i<n; ++i)
+                det *= m_lu.data()[i*n + i];
+            return det;
+        }
+
+        /**
+         * @brief Solve A * x = b
+         * @param b Right-hand side, it can have several columns
+         * @return x, throw std::domain_error if the matrix is singular
+         */
+        template<int M>
+        Matrix<T, N, M> solve(const Matrix<T, N, M>& b) const
+        {
+            matrixdetail::checkRightHandSide(m_lu, b, "LU solve");
+            if (!m_invertible)
+                throw std::domain_error("LU solve error. (The matrix is singular.)");
+
+            const int n = m_lu.getNbRows(), m = b.getNbCols();
+            Matrix<T, N, M> x(matrixdetail::Factory<T, N, M>::create(n, m));
+            for (int i=0; i<n; ++i)
+                for (int j=0; j<m; ++j)
+                    x.data()[i*m + j] = b.data()[m_permutation.data()[i]*m + j];
+
+            matrixdetail::forwardSubstitution<T, N, M>(m_lu.data(), x.data(), n, m, true);
+            matrixdetail::backSubstitution<T, N, M>(m_lu.data(), x.data(), n, m);
+            return x;
+        }
+
+        /**
+         * @brief Return the inverse of the decomposed matrix, throw std::domain_error if the matrix is singular
+         */
+        MatrixType inverse() const
+        {
+            const int n = m_lu.getNbRows();
+            MatrixType identity(matrixdetail::Factory<T, N, N>::create(n, n));
+            identity.setToIdentity();
+            return solve(identity);
+        }
+
+        const MatrixType& getLU() const { return m_lu; }
+    };
+
+
+    template<typename T, int N = Dynamic>
+    /**
+     * @brief Cholesky decomposition of a symmetric positive definite matrix: A = L * L^T.
+     *
+     * About twice as fast as the LU decomposition, and stable without pivoting, so it is the
+     * one to use with covariance matrices. Only the lower triangle of A is read.
+     */
+    class CholeskyDecomposition // Don't use UCAPA_API for a template class
+    {
+    public:
+        typedef Matrix<T, N, N> MatrixType;
+
+    protected:
+        MatrixType m_l; ///< L, lower triangular
+        bool m_positiveDefinite;
+
+    public:
+        CholeskyDecomposition() : m_positiveDefinite(false) {}
+        explicit CholeskyDecomposition(const MatrixType& m) : m_positiveDefinite(false) { compute(m); }
+
+        /**
+         * @brief Decompose a matrix, replacing the previous decomposition
+         * @return false if the matrix isn't positive definite
+         */
+        bool compute(const MatrixType& m)
+        {
+            matrixdetail::checkSquare(m, "Cholesky decomposition");
+            m_l = m;
+            m_positiveDefinite = matrixdetail::choleskyDecompose<T, N>(m_l.data(), m.getNbRows());
+            return m_positiveDefinite;
+        }
+
+        bool isPositiveDefinite() const { return m_positiveDefinite; }
+
+        /**
+         * @brief Return the determinant of the decomposed matrix
+         */
+        T determinant() const
+        {
+            const int n = m_l.getNbRows();
+            T det = 1;
+            for (int i=0; i<n; ++i)
+                det *= m_l.data()[i*n + i];
+            return det * det;
+        }
+
+        /**
+         * @brief Solve A * x = b
+         * @param b Right-hand side, it can have several columns
+         * @return x, throw std::domain_error if the matrix isn't positive definite
+         */
+        template<int M>
+        Matrix<T, N, M> solve(const Matrix<T, N, M>& b) const
+        {
+            matrixdetail::checkRightHandSide(m_l, b, "Cholesky solve");
+            if (!m_positiveDefinite)
+                throw std::domain_error("Cholesky solve error. (The matrix isn't positive definite.)");
+
+            const int n = m_l.getNbRows(), m = b.getNbCols();
+            Matrix<T, N, M> x(b);
+            matrixdetail::forwardSubstitution<T, N, M>(m_l.data(), x.data(), n, m, false);
+            matrixdetail::transposedBackSubstitution<T, N, M>(m_l.data(), x.data(), n, m);
+            return x;
+        }
+
+        /**
+         * @brief Return the inverse of the decomposed matrix, throw std::domain_error if the matrix isn't positive definite
+         */
+        MatrixType inverse() const
+        {
+            const int n = m_l.getNbRows();
+            MatrixType identity(matrixdetail::Factory<T, N, N>::create(n, n));
+            identity.setToIdentity();
+            return solve(identity);
+        }
+
+        const MatrixType& getL() const { return m_l; }
+    };
+
+
+    /**
+     * @brief Solve L * x = b, with L lower triangular
+     * @param L Lower triangular matrix, the values above the diagonal are ignored
+     * @param b Right-hand side, it can have several columns
+     * @param unitDiagonal Consider that the diagonal of L is 1, as in a LU decomposition
+     * @return x
+     */
+    template<typename T, int N, int M>
+    Matrix<T, N, M> solveLowerTriangular(const Matrix<T, N, N>& L, const Matrix<T, N, M>& b, bool unitDiagonal = false)
+    {
+        matrixdetail::checkSquare(L, "Triangular solve");
+        matrixdetail::checkRightHandSide(L, b, "Triangular solve");
+        Matrix<T, N, M> x(b);
+        matrixdetail::forwardSubstitution<T, N, M>(L.data(), x.data(), L.getNbRows(), b.getNbCols(), unitDiagonal);
+        return x;
+    }
+
+    /**
+     * @brief Solve U * x = b, with U upper triangular
+     * @param U Upper triangular matrix, the values below the diagonal are ignored
+     * @param b Right-hand side, it can have several columns
+     * @return x
+     */
+    template<typename T, int N, int M>
+    Matrix<T, N, M> solveUpperTriangular(const Matrix<T, N, N>& U, const Matrix<T, N, M>& b)
+    {
+        matrixdetail::checkSquare(U, "Triangular solve");
+        matrixdetail::checkRightHandSide(U, b, "Triangular solve");
+        Matrix<T, N, M> x(b);
+        matrixdetail::backSubstitution<T, N, M>(U.data(), x.data(), U.getNbRows(), b.getNbCols());
+        return x;
+    }
+
+    /**
+     * @brief Compute the inverse of a square matrix with a LU decomposition
+     * @return The inverse, throw std::domain_error if the matrix is singular
+     */
+    template<typename T, int N>
+    Matrix<T, N, N> inverse(const Matrix<T, N, N>& m)
+    {
+        return LUDecomposition<T, N>(m).inverse();
+    }
+
+    /**
+     * @brief Compute the inverse of a 3x3 matrix from its cofactors, faster than the LU decomposition
+     * @return The inverse, throw std::domain_error if the matrix is singular
+     */
+    template<typename T>
+    Matrix<T, 3, 3> inverse(const Matrix<T, 3, 3>& m)
+    {
+        Matrix<T, 3, 3> inv;
+        inv(0, 0) = m(1, 1)*m(2, 2) - m(1, 2)*m(2, 1);
+        inv(1, 0) = m(1, 2)*m(2, 0) - m(1, 0)*m(2, 2);
+        inv(2, 0) = m(1, 0)*m(2, 1) - m(1, 1)*m(2, 0);
+
+        const T det = m(0, 0)*inv(0, 0) + m(0, 1)*inv(1, 0) + m(0, 2)*inv(2, 0);
+        // The determinant is compared to the product of the largest value of each row, so that the rows in different
+        // units don't make the matrix look singular
+        T rowScales = 1;
+        for (int i=0; i<3; ++i)
+            rowScales *= std::max(std::max(std::abs(m(i, 0)), std::abs(m(i, 1))), std::abs(m(i, 2)));
+        if (!(std::abs(det) > 3 * std::numeric_limits<T>::epsilon() * rowScales) || !std::isfinite(det))
+            throw std::domain_error("Matrix inversion error. (The matrix is singular.)");
+
+        inv(0, 1) = m(0, 2)*m(2, 1) - m(0, 1)*m(2, 2);
+        inv(1, 1) = m(0, 0)*m(2, 2) - m(0, 2)*m(2, 0);
+        inv(2, 1) = m(0, 1)*m(2, 0) - m(0, 0)*m(2, 1);
+        inv(0, 2) = m(0, 1)*m(1, 2) - m(0, 2)*m(1, 1);
+        inv(1, 2) = m(0, 2)*m(1, 0) - m(0, 0)*m(1, 2);
+        inv(2, 2) = m(0, 0)*m(1, 1) - m(0, 1)*m(1, 0);
+        inv *= 1 / det;
+        return inv;
+    }
+}
+
+#endif // UCAPA_MATRIXDECOMPOSITION_H
@@ -27,12 +27,22 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <mutex>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <clocksync.h>
+#include <navdatalog.h>
+#include <navdatashm.h>
+#include <poseestimator.h>
+#include <positionintegrator.h>
 #include <quaternion.h>
+#include <telemetryaggregator.h>
 #include <vector3.h>
 #include <utils.h>
 
@@ -131,7 +141,12 @@ namespace ucapa{
         mutable std::mutex m_mutex;
         std::atomic<bool> m_computeWorldData; ///< Enable or Disable the world data computation
         std::atomic<bool> m_needToResetRotation; ///< Permit to know if the rotation needs to be reset
-        std::chrono::duration<float> m_navdataDeltaTime; ///< Permit to know the time between two reception
+        std::chrono::duration<float> m_navdataDeltaTime; ///< Permit to know the time between two samples
+        ClockSync m_clockSync; ///< Mapping between the drone clock and the host clock
+        bool m_hasSampleTime; ///< Permit to know if m_sampleTime is valid
+        std::chrono::steady_clock::time_point m_sampleTime; ///< Host time at which the drone sent the last packet
+        bool m_hasDroneTime; ///< Permit to know if m_droneTime is valid
+        double m_droneTime; ///< Unwrapped drone time of the last packet, in seconds
         std::atomic<int> m_state;  ///< Number containing the drone's states
         std::atomic<int> m_sequenceNumber; ///< Sequence number of command send by the drone
         std::atomic<int> m_vision; ///< Number containing informations on Augmented reality data stream
@@ -142,6 +157,19 @@ namespace ucapa{
         Vector3 m_localVelocity; ///< Local velocity of the drone
         Vector3 m_worldVelocity; ///< Velocity of the drone
         Vector3 m_worldPosition; ///< Position of the drone (comparing with the take off position)
+        PositionIntegrator m_positionIntegrator; ///< Integrate the world velocity into m_worldPosition
+        std::shared_ptr<NavdataShmPublisher> m_publisher; ///< Optional publisher of each decoded packet
+        std::shared_ptr<NavdataLogWriter> m_recorder; ///< Optional recorder of each received packet
+        std::vector<std::shared_ptr<TelemetryAggregator> > m_aggregators; ///< Aggregators fed with each decoded packet
+        std::vector<std::pair<std::shared_ptr<TelemetryAggregator>, TelemetryAggregator::Summary> > m_finishedSummaries; ///< Windows finished by the packet being parsed
+        std::atomic<bool> m_estimatePose; ///< Enable or Disable the pose estimation
+        PoseEstimator m_poseEstimator; ///< Filter fusing the sensors into a pose
+        PoseMeasurements m_poseMeasurements; ///< Measurements of the packet being parsed
+
+        /**
+         * @brief Fill a snapshot with the current data, the mutex must be locked.
+         */
+        void fillSnapshot(NavdataSnapshot& snapshot) const;
 
         /**
          * @brief Retrieves informations contained in NAVDATA_DEMO option
@@ -149,7 +177,51 @@ namespace ucapa{
          */
         void navdataDemo(const char *buffer); ///< Manage the attribute contained in the demo part of the sequence receive from the drone
 
+        /**
+         * @brief Retrieves the accelerometers and gyroscopes contained in NAVDATA_PHYS_MEASURES option
+         * @param buffer Navdata physical measures option
+         */
+        void navdataPhysMeasures(const char *buffer);
+
+        /**
+         * @brief Retrieves the heading contained in NAVDATA_MAGNETO option
+         * @param buffer Navdata magnetometer option
+         */
+        void navdataMagneto(const char *buffer);
+
+        /**
+         * @brief Retrieves the pressure contained in NAVDATA_PRESSURE_RAW option
+         * @param buffer Navdata raw pressure option
+         */
+        void navdataPressureRaw(const char *buffer);
+
+        /**
+         * @brief Call the callback of each option of the packet, the mutex must be locked.
+         * @param navdata buffer containing the navdata
+         */
+        void parse(const std::string& navdata);
+
+        /**
+         * @brief Unlock the mutex, then call the aggregator callbacks of the windows finished by the packet.
+         */
+        void unlockAndNotify();
+
+        /**
+         * @brief Convert the raw value of the NAVDATA_TIME option in continuous seconds.
+         *
+         * The drone sends 11 bits of seconds and 21 bits of microseconds, so its clock wraps every 2048 seconds.
+         */
+        double unwrapDroneTime(unsigned int raw);
+
     public:
+        /**
+         * @brief Find an option in a navdata packet.
+         * @param navdata buffer containing the navdata
+         * @param tag Id of the wanted option
+         * @return A pointer on the beginning of the option (its tag), nullptr if it is not in the packet
+         */
+        static const char* findOption(const std::string& navdata, NAVDATA_TAG tag);
+
         /**
          * @brief Construct a Navdata object
          * @param computeWorldData Specify if the world velocity and the world position of the drone
@@ -157,12 +229,23 @@ namespace ucapa{
          */
         Navdata();
 
+        /**
+         * @brief Retrieves differents informations in the navdata stream
+         *
+         * When the packet contains the NAVDATA_TIME option, the drone timestamp is
+         * converted into host time and used instead of the reception time, so the
+         * network jitter does not affect the integrations.
+         * @param navdata buffer containing the navdata
+         * @param receptionTime time at which the packet was received
+         */
+        virtual void update(const std::string& navdata, std::chrono::steady_clock::time_point receptionTime); ///< Update all the attributes
         /**
          * @brief Retrieves differents informations in the navdata stream
          * @param navdata buffer containing the navdata
          * @param deltaTime time between two updates call
+         * @deprecated The drone timestamps are ignored, use update(navdata, receptionTime).
          */
-        virtual void update(const std::string& navdata, std::chrono::duration<double> deltaTime); ///< Update all the attributes
+        virtual void update(const std::string& navdata, std::chrono::duration<double> deltaTime);
 
         /**
          * @brief Check if world data are computed.
@@ -181,10 +264,97 @@ namespace ucapa{
          */
         virtual void resetWorldData();
 
+        /**
+         * @brief Return the method used to integrate the world velocity into the position.
+         */
+        virtual PositionIntegrator::METHOD getPositionIntegration() const;
+        /**
+         * @brief Set the method used to integrate the world velocity into the position.
+         *
+         * The default is PositionIntegrator::TRAPEZOIDAL.
+         */
+        virtual void setPositionIntegration(PositionIntegrator::METHOD method);
+        /**
+         * @brief Check if the world position is accumulated in double precision.
+         */
+        virtual bool isPositionDoublePrecision() const;
+        /**
+         * @brief Accumulate the world position in double precision.
+         *
+         * Avoid the drift caused by the rounding of the small steps over a long flight.
+         * The velocities and the rotations stay in float.
+         * @param activate true to use double, false to use float (default).
+         */
+        virtual void setPositionDoublePrecision(bool activate);
+
+        /**
+         * @brief Check if the pose is estimated.
+         * @return true if the pose is estimated.
+         */
+        virtual bool isEstimatingPose() const {return m_estimatePose;}
+        /**
+         * @brief Enable or disable the pose estimation.
+         *
+         * The estimator fuses the inertial sensors, the velocity, the altitude, the pressure
+         * and the magnetometer, so the drone must send full navdata (not only the demo
+         * option) to get the best estimation. Enabling it resets the estimation.
+         * @see PoseEstimator
+         */
+        virtual void setEstimatePose(bool activate);
+
+        /**
+         * @brief Publish every decoded packet with the specified publisher.
+         * @param publisher An opened publisher, or nullptr to stop publishing.
+         */
+        virtual void setPublisher(std::shared_ptr<NavdataShmPublisher> publisher);
+
+        /**
+         * @brief Record every received packet, with its reception time.
+         *
+         * The recording can be replayed by calling update() with the decoded records.
+         * @param recorder A log writer, or nullptr to stop recording.
+         */
+        virtual void setRecorder(std::shared_ptr<NavdataLogWriter> recorder);
+
+        /**
+         * @brief Feed an aggregator with every decoded packet.
+         * @param aggregator Aggregator to add.
+         */
+        virtual void addAggregator(std::shared_ptr<TelemetryAggregator> aggregator);
+        /**
+         * @brief Stop feeding an aggregator.
+         * @param aggregator Aggregator to remove.
+         */
+        virtual void removeAggregator(std::shared_ptr<TelemetryAggregator> aggregator);
+
+        /**
+         * @brief Return a copy of all the current navdata.
+         */
+        virtual NavdataSnapshot getSnapshot() const;
+
         virtual int getState() const {return m_state;} ///< Return the number containing the drone's states
         virtual int getSequenceNumber() const {return m_sequenceNumber;} ///< Return the sequence number of command send by the drone
         virtual int getVisionFlags() const {return m_vision;} ///< Return the number containing vision's informations (RA)
 
+        /**
+         * @brief Return the host time at which the drone sent the last packet.
+         *
+         * If the drone does not send its timestamps, this is the reception time.
+         */
+        virtual std::chrono::steady_clock::time_point getTimestamp() const;
+        /**
+         * @brief Return the drone time of the last packet, in seconds.
+         * @return The drone time, or a negative value if the drone does not send its timestamps.
+         */
+        virtual double getDroneTime() const;
+        /**
+         * @brief Convert a drone timestamp into host time.
+         *
+         * Permit to align other drone data (like video frames) with the navdata.
+         * @param droneTime Drone time, in seconds, as returned by getDroneTime().
+         */
+        virtual std::chrono::steady_clock::time_point droneTimeToHost(double droneTime) const;
+
         /**
          * @brief Return the battery level in percentage.
          */
@@ -216,6 +386,40 @@ namespace ucapa{
          * The take off position is considered as the origin (0, 0, 0).
          */
         virtual Vector3 getPosition() const;
+        /**
+         * @brief Return the position of the drone at a given time, extrapolated from the last packet.
+         *
+         * Permit to get a smooth position between packets, or during a short loss of packets.
+         * The extrapolation is bounded to PositionIntegrator::getMaxExtrapolation() seconds.
+         * @param time Time of the position, in the clock of getTimestamp().
+         */
+        virtual Vector3 getPosition(std::chrono::steady_clock::time_point time) const;
+        /**
+         * @brief Return the position of the drone, with the precision of the accumulator.
+         *
+         * Same as getPosition(), but without rounding to float when setPositionDoublePrecision() is activated.
+         */
+        virtual Vector3d getPrecisePosition() const;
+
+        /**
+         * @brief Return the position estimated by the pose estimator, in meters, in world coordinates.
+         *
+         * Same frame as getPosition(), but much less drift.
+         */
+        virtual Vector3 getEstimatedPosition() const;
+        /**
+         * @brief Return the velocity estimated by the pose estimator, in m/s, in world coordinates.
+         */
+        virtual Vector3 getEstimatedVelocity() const;
+        /**
+         * @brief Return euler angles estimated by the pose estimator, in degrees.
+         */
+        virtual Vector3 getEstimatedRotation() const;
+        /**
+         * @brief Return the covariance of the pose estimator state.
+         * @see PoseEstimator::STATE_INDEX
+         */
+        virtual PoseEstimator::Covariance getEstimatedPoseCovariance() const;
     };
 }
 
@@ -0,0 +1,152 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_NAVDATALOG_H
+#define UCAPA_NAVDATALOG_H
+
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <config.h>
+
+namespace ucapa{
+    /**
+     * @brief One recorded navdata packet.
+     */
+    struct NavdataLogRecord
+    {
+        int64_t timestamp;  ///< Reception time, in nanoseconds since the std::chrono::steady_clock epoch
+        std::string packet; ///< Raw navdata packet, as received from the drone
+    };
+
+    /**
+     * @brief Streaming encoder for navdata recordings.
+     *
+     * Every keyframeInterval records, the packet is stored as-is. Other packets are
+     * stored relatively to the previous one: options that did not change only
+     * cost 2 bits, and the 32 bits words of the other options are stored as
+     * zig-zag varint differences or, when smaller (floats), as XORs without
+     * their trailing zeros, with runs of unchanged words merged. The words of an
+     * option start at its beginning or 2 bytes after, whichever is smaller, since
+     * 16 bits fields shift the following ones. Timestamps
+     * are stored as differences of the time between records.
+     * Each record is prefixed by its length, so a reader can skip records without
+     * decoding them.
+     */
+    class UCAPA_API NavdataLogWriter
+    {
+    protected:
+        std::ostream& m_stream;     ///< Stream receiving the encoded records.
+        unsigned int m_keyframeInterval; ///< Number of records between two keyframes.
+        unsigned int m_nbRecords;   ///< Number of records written.
+        int64_t m_previousTimestamp; ///< Timestamp of the previous record.
+        int64_t m_previousDelta;     ///< Time between the two previous records.
+        std::string m_previousPacket; ///< Previous packet, reference of the delta encoding.
+        std::string m_buffer;       ///< Encoding buffer, kept to avoid allocations.
+        std::string m_payload;      ///< Encoded data of the options, kept to avoid allocations.
+        std::string m_shifted;      ///< Encoding of an option with shifted words, kept to avoid allocations.
+
+    public:
+        /**
+         * @brief Construct an encoder and write the stream header.
+         * @param stream Stream receiving the encoded records, opened in binary mode.
+         * @param keyframeInterval Number of records between two keyframes (200 is one second of full navdata).
+         */
+        NavdataLogWriter(std::ostream& stream, unsigned int keyframeInterval = 200);
+        virtual ~NavdataLogWriter() {}
+
+        /**
+         * @brief Encode a packet.
+         * @param timestamp Reception time, in nanoseconds.
+         * @param packet Raw navdata packet.
+         */
+        virtual void write(int64_t timestamp, const std::string& packet);
+
+        /**
+         * @brief Return the number of records written.
+         */
+        unsigned int getNbRecords() const {return m_nbRecords;}
+    };
+
+    /**
+     * @brief Decoder for streams written by NavdataLogWriter.
+     *
+     * The whole encoded stream is kept in memory. Opening it only reads the
+     * record lengths to build an index, so any record can be reached by decoding
+     * from its preceding keyframe.
+     */
+    class UCAPA_API NavdataLogReader
+    {
+    protected:
+        std::string m_data;               ///< Encoded stream.
+        unsigned int m_version;           ///< Format version of the stream.
+        std::vector<uint32_t> m_offsets;  ///< Offset of each record body.
+        std::vector<uint32_t> m_sizes;    ///< Size of each record body.
+        std::vector<uint32_t> m_keyframes; ///< Index of each keyframe record.
+        std::size_t m_nextRecord;         ///< Index of the record returned by the next call to next().
+        NavdataLogRecord m_current;       ///< Last decoded record, reference of the next delta.
+        int64_t m_currentDelta;           ///< Time between the two last decoded records.
+        std::string m_buffer;             ///< Decoding buffer, kept to avoid allocations.
+
+        /**
+         * @brief Decode the record at the specified index using m_current as reference.
+         * @return false if the record is corrupted.
+         */
+        bool decodeRecord(std::size_t index);
+
+    public:
+        NavdataLogReader();
+        virtual ~NavdataLogReader() {}
+
+        /**
+         * @brief Take an encoded stream and index its records.
+         * @param data Content written by a NavdataLogWriter.
+         * @return false if the header is invalid. A truncated last record is ignored.
+         */
+        virtual bool open(const std::string& data);
+
+        /**
+         * @brief Return the number of complete records.
+         */
+        std::size_t getNbRecords() const {return m_offsets.size();}
+
+        /**
+         * @brief Set the index of the record that next() will return.
+         * @param index Record index, in [0, getNbRecords()].
+         * @return false if the index is out of the stream.
+         */
+        virtual bool seek(std::size_t index);
+
+        /**
+         * @brief Decode the next record.
+         * @param record Filled with the decoded record.
+         * @return false at the end of the stream, or if the record is corrupted.
+         */
+        virtual bool next(NavdataLogRecord& record);
+    };
+}
+
+#endif // UCAPA_NAVDATALOG_H
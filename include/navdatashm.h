@@ -0,0 +1,179 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_NAVDATASHM_H
+#define UCAPA_NAVDATASHM_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+#include <config.h>
+
+namespace ucapa{
+    /**
+     * @brief Snapshot of the decoded navdata, as written in the shared memory ring.
+     *
+     * This is a plain structure so that it can be shared between processes
+     * without any serialization. Vectors are stored as (x, y, z).
+     */
+    struct NavdataSnapshot
+    {
+        uint64_t index;          ///< Publication index of the snapshot (starts at 1)
+        int64_t timestamp;       ///< Time of the sample, in nanoseconds since the std::chrono::steady_clock epoch
+        int32_t state;           ///< Number containing the drone's states
+        int32_t sequenceNumber;  ///< Sequence number of the navdata packet
+        int32_t vision;          ///< Number containing vision's informations (RA)
+        int32_t batteryLvl;      ///< Battery level, in percentage
+        float altitude;          ///< Altitude, in meters
+        float rotation[3];       ///< Euler angles, in degrees
+        float localVelocity[3];  ///< Velocity in drone's local coordinates, in meters per second
+        float worldVelocity[3];  ///< Velocity in world coordinates, in meters per second
+        float worldPosition[3];  ///< Position in world coordinates, in meters
+    };
+
+    /**
+     * @brief Publish navdata snapshots into a POSIX shared memory ring.
+     *
+     * The ring is made of a header followed by a fixed number of slots. Each slot
+     * is protected by a sequence lock, so the writer never waits for readers and
+     * readers never do a system call once the segment is mapped.
+     * Only one publisher should write in a given segment.
+     */
+    class UCAPA_API NavdataShmPublisher
+    {
+    protected:
+        std::string m_name;  ///< Name of the shared memory segment.
+        int m_fd;            ///< File descriptor of the shared memory segment.
+        std::size_t m_size;  ///< Size of the mapping, in bytes.
+        void* m_pMapping;    ///< Start of the mapping.
+
+    public:
+        /**
+         * @brief Construct a closed publisher.
+         */
+        NavdataShmPublisher();
+        virtual ~NavdataShmPublisher();
+
+        NavdataShmPublisher(const NavdataShmPublisher&) = delete;
+        NavdataShmPublisher& operator=(const NavdataShmPublisher&) = delete;
+
+        /**
+         * @brief Create (or recreate) the shared memory segment.
+         *
+         * An existing segment of the same name is unlinked and a new one is created: the readers that mapped the old one
+         * keep it, and have to be opened again to follow the new one.
+         * @param name Name of the segment, following shm_open() rules (ie. "/ucapa_navdata").
+         * @param nbSlots Number of snapshots kept in the ring.
+         * @return true if the segment is ready to be written.
+         */
+        virtual bool open(const std::string& name, unsigned int nbSlots = 256);
+        /**
+         * @brief Unmap and unlink the shared memory segment.
+         */
+        virtual void close();
+        /**
+         * @brief Check if the segment is opened.
+         */
+        virtual bool isOpen() const {return m_pMapping != nullptr;}
+
+        /**
+         * @brief Write a snapshot in the next slot of the ring.
+         *
+         * The index field of the snapshot is set by the publisher.
+         * @param snapshot Snapshot to publish.
+         */
+        virtual void publish(const NavdataSnapshot& snapshot);
+    };
+
+    /**
+     * @brief Read navdata snapshots published by a NavdataShmPublisher.
+     *
+     * Once opened, all reads are done directly in the mapped memory.
+     */
+    class UCAPA_API NavdataShmReader
+    {
+    protected:
+        int m_fd;            ///< File descriptor of the shared memory segment.
+        std::size_t m_size;  ///< Size of the mapping, in bytes.
+        const void* m_pMapping; ///< Start of the mapping.
+
+        /**
+         * @brief Copy a slot, retrying while the writer is modifying it.
+         * @return false if the slot did not become stable.
+         */
+        bool readSlot(uint64_t index, NavdataSnapshot& snapshot) const;
+
+    public:
+        /**
+         * @brief Construct a closed reader.
+         */
+        NavdataShmReader();
+        virtual ~NavdataShmReader();
+
+        NavdataShmReader(const NavdataShmReader&) = delete;
+        NavdataShmReader& operator=(const NavdataShmReader&) = delete;
+
+        /**
+         * @brief Map an existing shared memory segment.
+         * @param name Name of the segment given to the publisher.
+         * @return true if the segment is mapped and valid.
+         */
+        virtual bool open(const std::string& name);
+        /**
+         * @brief Unmap the shared memory segment.
+         */
+        virtual void close();
+        /**
+         * @brief Check if the segment is opened.
+         */
+        virtual bool isOpen() const {return m_pMapping != nullptr;}
+
+        /**
+         * @brief Return the index of the last published snapshot, 0 if nothing was published.
+         */
+        virtual uint64_t getLastIndex() const;
+        /**
+         * @brief Number of slots of the ring.
+         */
+        virtual unsigned int getNbSlots() const;
+
+        /**
+         * @brief Read the last published snapshot.
+         * @param snapshot Filled with the snapshot.
+         * @return false if nothing was published yet.
+         */
+        virtual bool readLatest(NavdataSnapshot& snapshot) const;
+        /**
+         * @brief Read a specific snapshot.
+         * @param index Publication index of the wanted snapshot.
+         * @param snapshot Filled with the snapshot.
+         * @return false if the snapshot is not published yet or was already overwritten.
+         */
+        virtual bool read(uint64_t index, NavdataSnapshot& snapshot) const;
+    };
+}
+
+#endif // UCAPA_NAVDATASHM_H
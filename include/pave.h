@@ -0,0 +1,102 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_PAVE_H
+#define UCAPA_PAVE_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <config.h>
+
+namespace ucapa{
+    /**
+     * @brief Parrot Video Encapsulation header, sent before each frame of the AR.Drone 2.0 video stream.
+     *
+     * The payload following the header is the H.264 access unit of the frame, with the
+     * SPS and PPS at its beginning for the I-frames. Only the useful fields are kept.
+     */
+    struct UCAPA_API PaVEHeader
+    {
+        /**
+         * @brief Codecs of the payload
+         */
+        enum CODEC {
+            CODEC_UNKNOWN = 0,
+            CODEC_VLIB,
+            CODEC_P264,
+            CODEC_MPEG4_VISUAL,
+            CODEC_MPEG4_AVC     ///< H.264, the only codec of the AR.Drone 2.0
+        };
+
+        /**
+         * @brief Types of frames
+         */
+        enum FRAME_TYPE {
+            FRAME_UNKNOWN = 0,
+            FRAME_IDR,
+            FRAME_I,
+            FRAME_P,
+            FRAME_HEADERS
+        };
+
+        static const std::size_t MIN_SIZE = 64;     ///< Size of the fixed part of the header, headerSize may be larger
+        static const std::size_t MAX_SIZE = 256;    ///< Larger headers are considered as a loss of synchronization
+        static const uint32_t MAX_PAYLOAD_SIZE = 4 * 1024 * 1024; ///< Larger payloads are considered as a loss of synchronization
+
+        uint8_t version;
+        uint8_t codec;           ///< One of CODEC
+        uint16_t headerSize;     ///< Size of the header, in bytes
+        uint32_t payloadSize;    ///< Size of the payload following the header, in bytes
+        uint16_t encodedWidth;   ///< Size of the encoded picture, multiple of 16
+        uint16_t encodedHeight;
+        uint16_t displayWidth;   ///< Size of the picture once cropped
+        uint16_t displayHeight;
+        uint32_t frameNumber;
+        uint32_t timestamp;      ///< Drone time of the capture, in milliseconds
+        uint8_t frameType;       ///< One of FRAME_TYPE
+
+        /**
+         * @brief Read a header.
+         * @param data Beginning of the header, at least MIN_SIZE bytes.
+         * @return false if the data is not a valid header: bad signature, or sizes out of bounds.
+         */
+        bool parse(const uint8_t* data);
+
+        /**
+         * @brief Check if the frame can be decoded without the previous ones.
+         */
+        bool isKeyFrame() const {return frameType == FRAME_IDR || frameType == FRAME_I;}
+
+        /**
+         * @brief Search the signature of a header, to resynchronize after a corrupted header.
+         * @param data Received bytes.
+         * @param size Number of bytes.
+         * @return Position of the first signature, or of a partial signature at the end of the data. size if there is none.
+         */
+        static std::size_t findSignature(const uint8_t* data, std::size_t size);
+    };
+}
+
+#endif // UCAPA_PAVE_H
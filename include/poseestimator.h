@@ -0,0 +1,255 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_POSEESTIMATOR_H
+#define UCAPA_POSEESTIMATOR_H
+
+#include <config.h>
+#include <matrix.h>
+#include <vector3.h>
+
+namespace ucapa{
+    /**
+     * @brief Measurements extracted from one navdata packet.
+     *
+     * Each group has a flag telling if it was in the packet.
+     * Angles are in the aeronautic convention of the drone: roll (phi) and pitch (theta)
+     * around the forward and right axes, heading (psi) clockwise seen from above.
+     */
+    struct UCAPA_API PoseMeasurements
+    {
+        bool hasImu;
+        float accelerometers[3];   ///< Specific force in mg, in drone frame (forward, right, down)
+        float gyroscopes[3];       ///< Angular rates in deg/s, in drone frame (forward, right, down)
+
+        bool hasAttitude;
+        float roll;                ///< Roll estimated by the drone, in degrees
+        float pitch;               ///< Pitch estimated by the drone, in degrees
+
+        bool hasHeading;
+        float heading;             ///< Heading, in degrees
+
+        bool hasVelocity;
+        float velocity[2];         ///< Horizontal velocity in m/s, in drone frame (forward, right)
+
+        bool hasAltitude;
+        float altitude;            ///< Altitude above the ground, in meters
+
+        bool hasPressure;
+        float pressure;            ///< Atmospheric pressure, in Pa
+
+        PoseMeasurements() { clear(); }
+
+        /**
+         * @brief Mark all the measurements as missing.
+         */
+        void clear()
+        {
+            hasImu = hasAttitude = hasHeading = hasVelocity = hasAltitude = hasPressure = false;
+        }
+    };
+
+    /**
+     * @brief Extended Kalman filter estimating the pose of the drone.
+     *
+     * The state is the position and the velocity in a north-east-down frame, and
+     * the attitude as Euler angles (roll, pitch, heading). When the packets contain
+     * the physical measures, accelerometers and gyroscopes drive the prediction,
+     * otherwise a constant velocity model is used. The two horizontal velocities are
+     * corrected together, with a Cholesky decomposition of their 2x2 innovation covariance;
+     * the attitude, heading, altitude and pressure measurements correct it one scalar at a time.
+     * Everything is stored in fixed-size matrices: an update does no allocation.
+     *
+     * The getters return values in the same frame as Navdata::getPosition():
+     * x on the right, y up and z forward, the origin being the pose at the last reset.
+     */
+    class UCAPA_API PoseEstimator
+    {
+    public:
+        /**
+         * @brief Index of each component in the state vector.
+         */
+        enum STATE_INDEX {
+            POSITION_NORTH = 0,
+            POSITION_EAST,
+            POSITION_DOWN,
+            VELOCITY_NORTH,
+            VELOCITY_EAST,
+            VELOCITY_DOWN,
+            ROLL,
+            PITCH,
+            HEADING,
+            STATE_SIZE
+        };
+
+        /**
+         * @brief Covariance of the state, in SI units and radians, in STATE_INDEX order.
+         */
+        typedef Matrix<double, STATE_SIZE, STATE_SIZE> Covariance;
+        typedef Matrix<double, STATE_SIZE, 1> StateVector;
+
+        /**
+         * @brief Standard deviations of the noises, in SI units.
+         */
+        struct Parameters
+        {
+            double accelerometerNoise;  ///< m/s^2, includes the vibrations of the motors
+            double gyroscopeNoise;      ///< rad/s
+            double accelerationNoise;   ///< m/s^2, unknown acceleration of the constant velocity model
+            double angularRateNoise;    ///< rad/s, unknown angular rate of the constant velocity model
+            double velocityNoise;       ///< m/s
+            double attitudeNoise;       ///< rad
+            double headingNoise;        ///< rad
+            double altitudeNoise;       ///< m
+            double pressureAltitudeNoise; ///< m
+            double gate;                ///< Measurements further than this number of standard deviations are rejected
+
+            Parameters()
+                : accelerometerNoise(0.5)
+                , gyroscopeNoise(0.02)
+                , accelerationNoise(2.0)
+                , angularRateNoise(1.0)
+                , velocityNoise(0.1)
+                , attitudeNoise(0.02)
+                , headingNoise(0.1)
+                , altitudeNoise(0.03)
+                , pressureAltitudeNoise(1.0)
+                , gate(5.0)
+            {
+            }
+        };
+
+    protected:
+        Parameters m_parameters;
+        bool m_initialized;         ///< Permit to know if the state is set
+        StateVector m_state;
+        Covariance m_covariance;
+        double m_headingOrigin;     ///< Heading of the origin frame, in radians
+        bool m_hasPressureReference;
+        double m_pressureReference; ///< Pressure at the origin altitude, in Pa
+        double m_pressureOffset;    ///< Altitude of the pressure reference, in meters
+
+        Matrix3d m_rotation;        ///< Drone to world rotation of the current state
+        Matrix3d m_rotationDerivatives[3]; ///< Derivatives of m_rotation by roll, pitch and heading
+
+        /**
+         * @brief Compute m_rotation and its derivatives from the current attitude.
+         */
+        void computeRotation();
+
+        /**
+         * @brief Propagate the state and the covariance.
+         * @param dt Time step, in seconds.
+         * @param measurements Measurements, the IMU is used if present.
+         */
+        void predict(double dt, const PoseMeasurements& measurements);
+
+        /**
+         * @brief Correct the state with a scalar measurement.
+         * @param innovation Measurement minus its prediction.
+         * @param h Derivatives of the measurement by the state.
+         * @param variance Variance of the measurement noise.
+         * @return false if the measurement is rejected.
+         */
+        bool correct(double innovation, const StateVector& h, double variance);
+
+        /**
+         * @brief Correct the state with a vector measurement.
+         *
+         * The measurement is rejected if its Mahalanobis distance exceeds Parameters::gate.
+         * @param innovation Measurement minus its prediction.
+         * @param H Derivatives of the measurement by the state, one row per component.
+         * @param variance Variance of the noise of each component, the noises are independent.
+         * @return false if the measurement is rejected.
+         */
+        template<int M>
+        bool correct(const Matrix<double, M, 1>& innovation, const Matrix<double, M, STATE_SIZE>& H, double variance);
+
+        /**
+         * @brief Correct the state with a measurement of one component of the state.
+         */
+        bool correct(STATE_INDEX index, double measurement, double variance, bool isAngle = false);
+
+        /**
+         * @brief Set the state from the first measurements.
+         * @return false if the attitude is missing.
+         */
+        bool initialize(const PoseMeasurements& measurements);
+
+        /**
+         * @brief Convert a north-east-down vector into the origin frame, with Navdata axes.
+         */
+        Vector3 toOriginFrame(double north, double east, double down) const;
+
+    public:
+        /**
+         * @brief Construct an estimator, it is initialized by the first packet with the attitude.
+         */
+        PoseEstimator(const Parameters& parameters = Parameters());
+        virtual ~PoseEstimator() {}
+
+        /**
+         * @brief Forget the state.
+         */
+        virtual void reset();
+
+        /**
+         * @brief Move the horizontal origin to the current position, and the forward axis to the current heading.
+         *
+         * The altitude is kept, it is measured from the ground.
+         */
+        virtual void resetOrigin();
+
+        /**
+         * @brief Check if the estimator has a state.
+         */
+        virtual bool isInitialized() const {return m_initialized;}
+
+        /**
+         * @brief Process the measurements of one packet.
+         * @param dt Time elapsed since the previous packet, in seconds.
+         * @param measurements Measurements of the packet.
+         */
+        virtual void update(double dt, const PoseMeasurements& measurements);
+
+        /**
+         * @brief Return the estimated position, in meters.
+         */
+        virtual Vector3 getPosition() const;
+        /**
+         * @brief Return the estimated velocity, in m/s.
+         */
+        virtual Vector3 getVelocity() const;
+        /**
+         * @brief Return the estimated Euler angles, in degrees, like Navdata::getRotation().
+         */
+        virtual Vector3 getRotation() const;
+        /**
+         * @brief Return the covariance of the state.
+         */
+        virtual Covariance getCovariance() const;
+    };
+}
+
+#endif // UCAPA_POSEESTIMATOR_H
@@ -0,0 +1,137 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_POSITIONINTEGRATOR_H
+#define UCAPA_POSITIONINTEGRATOR_H
+
+#include <config.h>
+#include <vector3.h>
+
+namespace ucapa{
+    /**
+     * @brief Integrate timestamped velocity samples into a position.
+     *
+     * Each sample carries its own timestamp, so the step is the real time between two
+     * samples, and a dropped packet only makes the step longer. Between two samples the
+     * velocity is interpolated, which is the best guess over a burst of lost packets.
+     * After the last sample, the position can be extrapolated for a bounded duration.
+     *
+     * The position is accumulated in float by default. Over a long flight, the steps become
+     * small compared to the position and are rounded away, setDoublePrecision() avoids it.
+     */
+    class UCAPA_API PositionIntegrator
+    {
+    public:
+        /**
+         * @brief Integration methods
+         */
+        enum METHOD {
+            EULER = 0,      ///< Newest velocity times the step, the former behaviour of Navdata
+            TRAPEZOIDAL,    ///< Mean of the two velocities times the step
+            RK2             ///< Midpoint velocity, interpolated by a parabola through the last three samples
+        };
+
+    protected:
+        METHOD m_method;
+        double m_maxExtrapolation;  ///< Maximal duration of extrapolation, in seconds
+        bool m_doublePrecision;     ///< If true, m_precisePosition is the accumulator instead of m_position
+        Vector3 m_position;
+        Vector3d m_precisePosition;
+        int m_nbSamples;            ///< Number of valid samples in m_times and m_velocities, up to 3
+        double m_times[3];          ///< Timestamps of the last samples, the newest last
+        Vector3 m_velocities[3];    ///< Velocities of the last samples, the newest last
+
+        /**
+         * @brief Compute the displacement between the last two samples, in the precision of T.
+         */
+        template<typename T>
+        BasicVector3<T> getDisplacement(METHOD method) const;
+
+    public:
+        /**
+         * @brief Construct an integrator at the origin.
+         * @param method Integration method.
+         * @param maxExtrapolation Maximal duration, in seconds, the position is extrapolated after
+         *        the last sample. It also limits the gaps over which RK2 uses a parabola.
+         */
+        PositionIntegrator(METHOD method = TRAPEZOIDAL, double maxExtrapolation = 0.1);
+        virtual ~PositionIntegrator() {}
+
+        virtual METHOD getMethod() const {return m_method;}
+        virtual void setMethod(METHOD method) {m_method = method;}
+
+        virtual double getMaxExtrapolation() const {return m_maxExtrapolation;}
+        virtual void setMaxExtrapolation(double seconds) {m_maxExtrapolation = seconds;}
+
+        virtual bool isDoublePrecision() const {return m_doublePrecision;}
+        /**
+         * @brief Choose the precision of the position accumulator.
+         *
+         * The velocities stay in float, only the displacements and their sum use double.
+         * The current position is kept when switching.
+         * @param activate true to accumulate in double, false to accumulate in float (default).
+         */
+        virtual void setDoublePrecision(bool activate);
+
+        /**
+         * @brief Forget the samples and set the position.
+         */
+        virtual void reset(const Vector3& position = Vector3());
+        virtual void reset(const Vector3d& position);
+
+        /**
+         * @brief Set the position, the samples are kept.
+         */
+        virtual void setPosition(const Vector3& position);
+        virtual void setPosition(const Vector3d& position);
+
+        /**
+         * @brief Integrate up to a new sample.
+         *
+         * A sample which is not more recent than the previous one replaces its velocity.
+         * @param time Timestamp of the sample, in seconds.
+         * @param velocity Velocity at this time.
+         */
+        virtual void addSample(double time, const Vector3& velocity);
+
+        /**
+         * @brief Return the position at the time of the last sample.
+         */
+        virtual Vector3 getPosition() const;
+        /**
+         * @brief Return the position at the time of the last sample, with the precision of the accumulator.
+         */
+        virtual Vector3d getPrecisePosition() const;
+
+        /**
+         * @brief Return the position at a given time, extrapolated with the last velocity.
+         *
+         * The extrapolation stops getMaxExtrapolation() seconds after the last sample.
+         * @param time Time, in seconds, in the same clock as the samples.
+         */
+        virtual Vector3 getPosition(double time) const;
+    };
+}
+
+#endif // UCAPA_POSITIONINTEGRATOR_H
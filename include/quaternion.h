@@ -26,6 +26,7 @@
 #define UCAPA_QUATERNION_H
 
 #include <cmath>
+#include <type_traits>
 
 #include <matrix.h>
 #include <vector3.h>
@@ -34,82 +35,376 @@
 namespace ucapa{
     /**
      * @brief A Quaternion class allow to do some 3D rotations
+     *
+     * T is the type of the components, use the Quaternion (float) and Quaterniond (double) aliases.
      */
-    class UCAPA_API Quaternion
+    template<typename T>
+    class BasicQuaternion // Don't use UCAPA_API for a template class, the instantiations are exported below
     {
     public:
-        float x; // Vectorial imaginary part
-        float y;
-        float z;
+        typedef T Scalar;
 
-        float w; // Real part
+        T x; // Vectorial imaginary part
+        T y;
+        T z;
+
+        T w; // Real part
 
 
         /**
          * @brief Init the quaternion with default properties (0, 0, 0, 0)
          */
-        Quaternion();
+        constexpr BasicQuaternion() : x(0), y(0), z(0), w(0) {}
         /**
          * @brief Init the quaternion with its properties
          * @param x,y,z Vectorial imaginary part
          * @param w Real part
          */
-        Quaternion(float x, float y, float z, float w);
+        constexpr BasicQuaternion(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
         /**
          * @brief Init the quaternion with an euler angle in radian.
          * @param x,y,z Euler angle, in radian
          */
-        Quaternion(float x, float y, float z);
+        BasicQuaternion(T x, T y, T z);
         /**
          * @brief Init the quaternion with an euler angle in radian.
          * @paramv Euler angle, in radian
          */
-        Quaternion(const Vector3& v);
+        BasicQuaternion(const BasicVector3<T>& v);
 
         /**
          * @brief Set the quaternion with an euler angle in radian.
          * @param x,y,z Euler angle, in radian
          */
-        Quaternion& setFromEulerAngles(float x, float y, float z);
+        BasicQuaternion& setFromEulerAngles(T x, T y, T z);
         /**
          * @brief Set the quaternion with an euler angle in radian.
          * @paramv Euler angle, in radian
          */
-        Quaternion& setFromEulerAngles(const Vector3& v);
+        BasicQuaternion& setFromEulerAngles(const BasicVector3<T>& v);
+        /**
+         * @brief Create the rotation of an angle around an axis.
+         * @param axis Rotation axis, it doesn't need to be normalized
+         * @param angle Angle, in radian
+         * @return A new normalized quaternion, the identity if the axis is null
+         */
+        static BasicQuaternion fromAxisAngle(const BasicVector3<T>& axis, T angle);
+        /**
+         * @brief Create the quaternion of a rotation matrix.
+         *
+         * The opposite of getRotationMatrix(), the matrix must be orthonormal.
+         * @param m Rotation matrix
+         * @return A new normalized quaternion
+         */
+        static BasicQuaternion fromRotationMatrix(const Matrix<T, 3, 3>& m);
 
         /**
          * @brief Return a normalized quaternion.
          * @return A new normalized quaternion
          */
-        Quaternion normalized() const;
+        BasicQuaternion normalized() const {return *this * (T(1) / std::sqrt(dot(*this)));}
+        /**
+         * @brief Return the conjugate of the quaternion.
+         *
+         * For a unit quaternion, it is the opposite rotation.
+         * @return A new quaternion (-x, -y, -z, w)
+         */
+        constexpr BasicQuaternion conjugate() const {return BasicQuaternion(-x, -y, -z, w);}
+        /**
+         * @brief Return the inverse of the quaternion.
+         *
+         * Same as conjugate() for a unit quaternion, but also valid for the others.
+         * @return A new quaternion, such as q * q.inverse() is the identity
+         */
+        BasicQuaternion inverse() const {return conjugate() * (T(1) / dot(*this));}
+
+        /**
+         * @brief Integrate an angular rate over a time step.
+         *
+         * The rotation of the quaternion is followed by the rotation of rate * dt,
+         * expressed in the rotated frame, as with the gyroscopes of the drone.
+         * The exact rotation is used, so it stays accurate at high rates, and the result is normalized.
+         * @param rate Angular rate, in radian/s
+         * @param dt Time step, in seconds
+         * @return A reference to this quaternion
+         */
+        BasicQuaternion& integrate(const BasicVector3<T>& rate, T dt);
+
+        /**
+         * @brief Normalized linear interpolation.
+         *
+         * Faster than slerp, the angular speed is not constant but the path is the same.
+         * The shortest path is taken.
+         * @param q Quaternion at t = 1
+         * @param t Interpolation factor, between 0 and 1
+         * @return A new normalized quaternion
+         */
+        BasicQuaternion nlerp(const BasicQuaternion& q, T t) const;
+        /**
+         * @brief Spherical linear interpolation, at constant angular speed.
+         *
+         * The shortest path is taken. Both quaternions must be normalized.
+         * @param q Quaternion at t = 1
+         * @param t Interpolation factor, between 0 and 1
+         * @return A new normalized quaternion
+         */
+        BasicQuaternion slerp(const BasicQuaternion& q, T t) const;
 
         // Binary operators
-        bool operator!() const;
-        bool operator==(const Quaternion& q) const;
-        bool operator!=(const Quaternion& q) const;
+        constexpr bool operator!() const {return x == 0 && y == 0 && z == 0 && w == 0;} // True if all the components are null
+        constexpr bool operator==(const BasicQuaternion& q) const {return x == q.x && y == q.y && z == q.z && w == q.w;}
+        constexpr bool operator!=(const BasicQuaternion& q) const {return !(*this == q);}
 
         // Arithmetic operators
-        Quaternion operator+(const Quaternion& q) const;
-        Quaternion operator*(const Quaternion& q) const;
-        Quaternion operator*(float s) const;
-        Quaternion& operator*=(float s);
+        constexpr BasicQuaternion operator+(const BasicQuaternion& q) const {return BasicQuaternion(x + q.x, y + q.y, z + q.z, w + q.w);}
+        /**
+         * @brief Compose two rotations: the result rotates by this quaternion, then by q
+         */
+        constexpr BasicQuaternion operator*(const BasicQuaternion& q) const
+        {
+            return BasicQuaternion((q.w * x) + (q.x * w) + (q.y * z) - (q.z * y),
+                                   (q.w * y) + (q.y * w) + (q.z * x) - (q.x * z),
+                                   (q.w * z) + (q.z * w) + (q.x * y) - (q.y * x),
+                                   (q.w * w) - (q.x * x) - (q.y * y) - (q.z * z));
+        }
+        constexpr BasicQuaternion operator*(T s) const {return BasicQuaternion(s*x, s*y, s*z, s*w);}
+        BasicQuaternion& operator*=(T s) {x *= s; y *= s; z *= s; w *= s; return *this;}
 
         /**
          * @brief Create a matrix from the quaternion
          * @return The generated matrix(4, 4)
          */
-        Matrix<float> getMatrix() const;
+        Matrix<T> getMatrix() const;
+        /**
+         * @brief Create the rotation matrix of the quaternion, without allocation
+         * @return The generated matrix(3, 3)
+         */
+        Matrix<T, 3, 3> getRotationMatrix() const;
+
+        /**
+         * @brief Rotate a vector by the quaternion, without building a matrix.
+         *
+         * The quaternion must be normalized. The result is the same as
+         * multiplying the vector by getRotationMatrix().
+         * @param v Vector to rotate
+         * @return The rotated vector
+         */
+        BasicVector3<T> rotate(const BasicVector3<T>& v) const
+        {
+            // v' = v + 2w(u x v) + 2u x (u x v), with u the vectorial part
+            const BasicVector3<T> u(x, y, z);
+            const BasicVector3<T> t = u.cross(v) * T(2);
+            return v + t*w + u.cross(t);
+        }
 
         /**
          * @brief Compute dot product
          * @param q Other quaternion
          * @return Dot product
          */
-        float dot(const Quaternion& q) const;
+        constexpr T dot(const BasicQuaternion& q) const {return x * q.x + y * q.y + z * q.z + w * q.w;}
 
-        float getAngle() const;
-        Vector3 getVectorAxis() const;
+        T getAngle() const;
+        BasicVector3<T> getVectorAxis() const;
     };
+
+    template<typename T>
+    BasicQuaternion<T>::BasicQuaternion(T x, T y, T z)
+    {
+        setFromEulerAngles(x, y, z);
+    }
+
+    template<typename T>
+    BasicQuaternion<T>::BasicQuaternion(const BasicVector3<T>& v)
+    {
+        setFromEulerAngles(v.x, v.y, v.z);
+    }
+
+    template<typename T>
+    BasicQuaternion<T>& BasicQuaternion<T>::setFromEulerAngles(T x, T y, T z)
+    {
+        double angle;
+
+        angle = x * 0.5;
+        const double cx = cos(angle);
+        const double sx = sin(angle);
+
+        angle = y * 0.5;
+        const double cy = cos(angle);
+        const double sy = sin(angle);
+
+        angle = z * 0.5;
+        const double cz = cos(angle);
+        const double sz = sin(angle);
+
+        const double cycz = cy * cz;
+        const double sycz = sy * cz;
+        const double cysz = cy * sz;
+        const double sysz = sy * sz;
+
+        this->x = (T)(sx * cycz - cx * sysz);
+        this->y = (T)(cx * sycz + sx * cysz);
+        this->z = (T)(cx * cysz - sx * sycz);
+        this->w = (T)(cx * cycz + sx * sysz);
+
+        *this = normalized();
+        return *this;
+    }
+
+    template<typename T>
+    BasicQuaternion<T>& BasicQuaternion<T>::setFromEulerAngles(const BasicVector3<T>& v)
+    {
+        return setFromEulerAngles(v.x, v.y, v.z);
+    }
+
+    template<typename T>
+    BasicQuaternion<T> BasicQuaternion<T>::fromAxisAngle(const BasicVector3<T>& axis, T angle)
+    {
+        const T n = axis.magnitude();
+        if (n == 0)
+            return BasicQuaternion(0, 0, 0, 1);
+
+        const T s = std::sin(angle * T(0.5)) / n;
+        return BasicQuaternion(axis.x * s, axis.y * s, axis.z * s, std::cos(angle * T(0.5)));
+    }
+
+    template<typename T>
+    BasicQuaternion<T> BasicQuaternion<T>::fromRotationMatrix(const Matrix<T, 3, 3>& m)
+    {
+        // Compute the largest component from the diagonal first, to avoid dividing by a small number
+        const T trace = m(0, 0) + m(1, 1) + m(2, 2);
+        BasicQuaternion q;
+        if (trace > 0)
+        {
+            const T s = T(2) * std::sqrt(T(1) + trace);
+            q.w = T(0.25) * s;
+            q.x = (m(2, 1) - m(1, 2)) / s;
+            q.y = (m(0, 2) - m(2, 0)) / s;
+            q.z = (m(1, 0) - m(0, 1)) / s;
+        }
+        else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+        {
+            const T s = T(2) * std::sqrt(T(1) + m(0, 0) - m(1, 1) - m(2, 2));
+            q.w = (m(2, 1) - m(1, 2)) / s;
+            q.x = T(0.25) * s;
+            q.y = (m(0, 1) + m(1, 0)) / s;
+            q.z = (m(0, 2) + m(2, 0)) / s;
+        }
+        else if (m(1, 1) > m(2, 2))
+        {
+            const T s = T(2) * std::sqrt(T(1) + m(1, 1) - m(0, 0) - m(2, 2));
+            q.w = (m(0, 2) - m(2, 0)) / s;
+            q.x = (m(0, 1) + m(1, 0)) / s;
+            q.y = T(0.25) * s;
+            q.z = (m(1, 2) + m(2, 1)) / s;
+        }
+        else
+        {
+            const T s = T(2) * std::sqrt(T(1) + m(2, 2) - m(0, 0) - m(1, 1));
+            q.w = (m(1, 0) - m(0, 1)) / s;
+            q.x = (m(0, 2) + m(2, 0)) / s;
+            q.y = (m(1, 2) + m(2, 1)) / s;
+            q.z = T(0.25) * s;
+        }
+
+        return q.normalized();
+    }
+
+    template<typename T>
+    BasicQuaternion<T>& BasicQuaternion<T>::integrate(const BasicVector3<T>& rate, T dt)
+    {
+        // The rate is measured in the rotated frame, so the increment applies to the vectors before this rotation
+        const BasicQuaternion increment(fromAxisAngle(rate, rate.magnitude() * dt));
+        *this = (increment * *this).normalized();
+        return *this;
+    }
+
+    template<typename T>
+    BasicQuaternion<T> BasicQuaternion<T>::nlerp(const BasicQuaternion& q, T t) const
+    {
+        // q and -q are the same rotation, take the closest one
+        const T s = (dot(q) < 0) ? -t : t;
+        return (*this * (T(1) - t) + q * s).normalized();
+    }
+
+    template<typename T>
+    BasicQuaternion<T> BasicQuaternion<T>::slerp(const BasicQuaternion& q, T t) const
+    {
+        T cosAngle = dot(q);
+        const T sign = (cosAngle < 0) ? T(-1) : T(1);
+        cosAngle *= sign;
+
+        // sin(angle) is close to 0, but so is the difference between the two quaternions
+        if (cosAngle > T(0.9995))
+            return nlerp(q, t);
+
+        const T angle = std::acos(cosAngle);
+        const T invSin = T(1) / std::sin(angle);
+        return (*this * (std::sin((T(1) - t) * angle) * invSin) + q * (sign * std::sin(t * angle) * invSin)).normalized();
+    }
+
+    template<typename T>
+    Matrix<T> BasicQuaternion<T>::getMatrix() const
+    {
+        Matrix<T> m(4, 4);
+        const Matrix<T, 3, 3> r(getRotationMatrix());
+        for (int i=0; i<3; ++i)
+        {
+            for (int j=0; j<3; ++j)
+                m(i, j) = r(i, j);
+            m(i, 3) = 0;
+            m(3, i) = 0;
+        }
+        m(3, 3) = 1;
+
+        return m;
+    }
+
+    template<typename T>
+    Matrix<T, 3, 3> BasicQuaternion<T>::getRotationMatrix() const
+    {
+        Matrix<T, 3, 3> m;
+        m(0, 0) = T(1) - T(2)*y*y - T(2)*z*z;
+        m(1, 0) = T(2)*x*y + T(2)*z*w;
+        m(2, 0) = T(2)*x*z - T(2)*y*w;
+
+        m(0, 1) = T(2)*x*y - T(2)*z*w;
+        m(1, 1) = T(1) - T(2)*x*x - T(2)*z*z;
+        m(2, 1) = T(2)*z*y + T(2)*x*w;
+
+        m(0, 2) = T(2)*x*z + T(2)*y*w;
+        m(1, 2) = T(2)*z*y - T(2)*x*w;
+        m(2, 2) = T(1) - T(2)*x*x - T(2)*y*y;
+
+        return m;
+    }
+
+    template<typename T>
+    T BasicQuaternion<T>::getAngle() const
+    {
+        return T(2)*std::acos(w)*(T(180)/T(3.1415926535897932384626433832795));
+    }
+
+    template<typename T>
+    BasicVector3<T> BasicQuaternion<T>::getVectorAxis() const
+    {
+        return BasicVector3<T>(x, y, z).normalized();
+    }
+
+    typedef BasicQuaternion<float> Quaternion;
+    typedef BasicQuaternion<double> Quaterniond;
+
+    // Instantiated once in quaternion.cpp, so the code isn't compiled again in each file using it
+    extern template class UCAPA_API BasicQuaternion<float>;
+    extern template class UCAPA_API BasicQuaternion<double>;
+
+    static_assert(sizeof(Quaternion) == 4*sizeof(float), "Quaternion must be four packed floats");
+    static_assert(sizeof(Quaterniond) == 4*sizeof(double), "Quaterniond must be four packed doubles");
+    static_assert(std::is_standard_layout<Quaternion>::value, "Quaternion must have a standard layout");
+#if UCAPA_HAS_IS_TRIVIALLY_COPYABLE
+    static_assert(std::is_trivially_copyable<Quaternion>::value, "Quaternion must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Quaterniond>::value, "Quaterniond must be trivially copyable");
+#endif
 }
 
 #endif // UCAPA_QUATERNION_H
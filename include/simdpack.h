@@ -0,0 +1,130 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_SIMDPACK_H
+#define UCAPA_SIMDPACK_H
+
+#include <cmath>
+#include <cstddef>
+
+#include <config.h>
+
+#if defined(UCAPA_HAS_AVX)
+    #include <immintrin.h>
+#elif defined(UCAPA_HAS_SSE2)
+    #include <emmintrin.h>
+#endif
+
+namespace ucapa{
+    /**
+     * @brief Packs of floats used by the vectorized kernels of the library.
+     *
+     * Each pack type wraps the operations of one instruction set, so every kernel is
+     * written once as a template. A kernel processes the values from begin while a full
+     * pack fits, and returns the index of the first value left to the narrower packs.
+     * This header is an implementation detail, it is only included by the sources.
+     */
+    namespace simd{
+        struct ScalarPack
+        {
+            typedef float Type;
+            typedef bool Mask;
+            static const std::size_t WIDTH = 1;
+            static Type load(const float* p) {return *p;}
+            static void store(float* p, Type v) {*p = v;}
+            static Type set(float f) {return f;}
+            static Type add(Type a, Type b) {return a + b;}
+            static Type sub(Type a, Type b) {return a - b;}
+            static Type mul(Type a, Type b) {return a * b;}
+            static Type div(Type a, Type b) {return a / b;}
+            static Type sqrt(Type a) {return std::sqrt(a);}
+            static Type round(Type a) {return (float)(int)(a < 0 ? a - 0.5f : a + 0.5f);} ///< Round to the nearest integer, exact below 2^31
+            static Mask lessThan(Type a, Type b) {return a < b;}
+            static Mask both(Mask a, Mask b) {return a && b;}
+            static Type select(Mask m, Type a, Type b) {return m ? a : b;} ///< a where m is set, b elsewhere
+        };
+
+#if defined(UCAPA_HAS_SSE2)
+        struct SsePack
+        {
+            typedef __m128 Type;
+            typedef __m128 Mask;
+            static const std::size_t WIDTH = 4;
+            static Type load(const float* p) {return _mm_loadu_ps(p);}
+            static void store(float* p, Type v) {_mm_storeu_ps(p, v);}
+            static Type set(float f) {return _mm_set1_ps(f);}
+            static Type add(Type a, Type b) {return _mm_add_ps(a, b);}
+            static Type sub(Type a, Type b) {return _mm_sub_ps(a, b);}
+            static Type mul(Type a, Type b) {return _mm_mul_ps(a, b);}
+            static Type div(Type a, Type b) {return _mm_div_ps(a, b);}
+            static Type sqrt(Type a) {return _mm_sqrt_ps(a);}
+            static Type round(Type a) {return _mm_cvtepi32_ps(_mm_cvtps_epi32(a));} // Exact below 2^31
+            static Mask lessThan(Type a, Type b) {return _mm_cmplt_ps(a, b);}
+            static Mask both(Mask a, Mask b) {return _mm_and_ps(a, b);}
+            static Type select(Mask m, Type a, Type b) {return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));}
+        };
+#endif
+
+#if defined(UCAPA_HAS_AVX)
+        struct AvxPack
+        {
+            typedef __m256 Type;
+            typedef __m256 Mask;
+            static const std::size_t WIDTH = 8;
+            static Type load(const float* p) {return _mm256_loadu_ps(p);}
+            static void store(float* p, Type v) {_mm256_storeu_ps(p, v);}
+            static Type set(float f) {return _mm256_set1_ps(f);}
+            static Type add(Type a, Type b) {return _mm256_add_ps(a, b);}
+            static Type sub(Type a, Type b) {return _mm256_sub_ps(a, b);}
+            static Type mul(Type a, Type b) {return _mm256_mul_ps(a, b);}
+            static Type div(Type a, Type b) {return _mm256_div_ps(a, b);}
+            static Type sqrt(Type a) {return _mm256_sqrt_ps(a);}
+            static Type round(Type a) {return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);}
+            static Mask lessThan(Type a, Type b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+            static Mask both(Mask a, Mask b) {return _mm256_and_ps(a, b);}
+            static Type select(Mask m, Type a, Type b) {return _mm256_blendv_ps(b, a, m);}
+        };
+#endif
+    }
+}
+
+// Run a kernel with the widest pack available, then the narrower ones for the remaining values.
+// The kernel takes its arguments followed by the first and the end indexes.
+#if defined(UCAPA_HAS_AVX)
+    #define UCAPA_RUN_KERNEL(kernel, size, ...) \
+        do { std::size_t i_ = 0; \
+             i_ = kernel<simd::AvxPack>(__VA_ARGS__, i_, size); \
+             i_ = kernel<simd::SsePack>(__VA_ARGS__, i_, size); \
+             kernel<simd::ScalarPack>(__VA_ARGS__, i_, size); } while (0)
+#elif defined(UCAPA_HAS_SSE2)
+    #define UCAPA_RUN_KERNEL(kernel, size, ...) \
+        do { std::size_t i_ = 0; \
+             i_ = kernel<simd::SsePack>(__VA_ARGS__, i_, size); \
+             kernel<simd::ScalarPack>(__VA_ARGS__, i_, size); } while (0)
+#else
+    #define UCAPA_RUN_KERNEL(kernel, size, ...) \
+        kernel<simd::ScalarPack>(__VA_ARGS__, 0, size)
+#endif
+
+#endif // UCAPA_SIMDPACK_H
@@ -0,0 +1,161 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_TELEMETRYAGGREGATOR_H
+#define UCAPA_TELEMETRYAGGREGATOR_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+
+#include <config.h>
+#include <navdatashm.h>
+
+namespace ucapa{
+    /**
+     * @brief Reduce navdata over fixed time windows.
+     *
+     * For each selected field, the minimum, maximum, mean and last value are
+     * updated at each sample in constant time. When a sample falls after the end
+     * of the current window, a summary of the window is published and a new
+     * window starts. So the summary rate only depends on the window duration.
+     */
+    class UCAPA_API TelemetryAggregator
+    {
+    public:
+        /**
+         * @brief List of fields that can be aggregated
+         */
+        enum FIELD {
+            ALTITUDE = 0,
+            BATTERY,
+            ROTATION_X,
+            ROTATION_Y,
+            ROTATION_Z,
+            LOCAL_VELOCITY_X,
+            LOCAL_VELOCITY_Y,
+            LOCAL_VELOCITY_Z,
+            WORLD_VELOCITY_X,
+            WORLD_VELOCITY_Y,
+            WORLD_VELOCITY_Z,
+            POSITION_X,
+            POSITION_Y,
+            POSITION_Z,
+            NB_FIELDS
+        };
+
+        /**
+         * @brief Statistics of one field over a window.
+         */
+        struct FieldSummary
+        {
+            float min;
+            float max;
+            float mean;
+            float last;
+        };
+
+        /**
+         * @brief Statistics of all the selected fields over a window.
+         */
+        struct Summary
+        {
+            int64_t windowStart;   ///< Beginning of the window, in nanoseconds since the std::chrono::steady_clock epoch
+            int64_t windowEnd;     ///< End of the window, in nanoseconds since the std::chrono::steady_clock epoch
+            uint32_t nbSamples;    ///< Number of samples in the window
+            uint32_t fieldMask;    ///< Fields of the summary that are set (bit i for FIELD i)
+            FieldSummary fields[NB_FIELDS]; ///< Statistics of each field
+        };
+
+        typedef std::function<void(const Summary&)> Callback;
+
+        /**
+         * @brief Return the mask selecting all the fields.
+         */
+        static uint32_t allFields() {return (1U << NB_FIELDS) - 1;}
+
+    protected:
+        const int64_t m_window;     ///< Duration of a window, in nanoseconds.
+        const uint32_t m_fieldMask; ///< Aggregated fields.
+        Callback m_callback;        ///< Function called with each finished window.
+
+        bool m_started;             ///< Permit to know if the first window is placed.
+        Summary m_current;          ///< Window being aggregated, means are computed when the window is finished.
+        double m_sums[NB_FIELDS];   ///< Sums of the values, in double to avoid precision loss.
+
+        mutable std::mutex m_mutex; ///< Protect m_last.
+        bool m_hasLast;             ///< Permit to know if m_last is valid.
+        Summary m_last;             ///< Last finished window.
+
+        /**
+         * @brief Compute the means, store the current window as the last one and start the next one.
+         * @param timestamp Time of the sample that ends the window, in nanoseconds.
+         * @param finished Filled with the finished window.
+         */
+        void finishWindow(int64_t timestamp, Summary& finished);
+
+    public:
+        /**
+         * @brief Construct an aggregator.
+         * @param window Duration of the windows.
+         * @param fieldMask Fields to aggregate (bit i for FIELD i).
+         * @param callback Function called with each finished window, from the navdata reception thread.
+         * It is called once the navdata are updated, but it must not call into Navdata since it delays the next packets.
+         */
+        TelemetryAggregator(std::chrono::duration<double> window, uint32_t fieldMask = allFields(), Callback callback = Callback());
+        virtual ~TelemetryAggregator() {}
+
+        /**
+         * @brief Add a sample to the current window.
+         * @param snapshot Navdata sample.
+         */
+        virtual void addSample(const NavdataSnapshot& snapshot);
+
+        /**
+         * @brief Add a sample to the current window without calling the callback.
+         *
+         * Used by Navdata, which calls notify() once its mutex is released.
+         * @param snapshot Navdata sample.
+         * @param finished Filled with the window finished by this sample, if any.
+         * @return true if a window was finished.
+         */
+        virtual bool addSample(const NavdataSnapshot& snapshot, Summary& finished);
+
+        /**
+         * @brief Call the callback with a finished window.
+         * @param summary Window returned by addSample().
+         */
+        virtual void notify(const Summary& summary) const;
+
+        /**
+         * @brief Return the last finished window.
+         * @param summary Filled with the summary.
+         * @return false if no window is finished yet.
+         */
+        virtual bool getLastSummary(Summary& summary) const;
+    };
+}
+
+#endif // UCAPA_TELEMETRYAGGREGATOR_H
@@ -0,0 +1,136 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_TRAJECTORYSMOOTHER_H
+#define UCAPA_TRAJECTORYSMOOTHER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <config.h>
+#include <vector3.h>
+
+namespace ucapa{
+    /**
+     * @brief One pose of a smoothed trajectory, in the frame of Navdata::getPosition().
+     */
+    struct UCAPA_API TrajectorySample
+    {
+        int64_t timestamp;          ///< Host time of the sample, in nanoseconds since the std::chrono::steady_clock epoch
+        Vector3 position;           ///< Smoothed position, in meters
+        Vector3 velocity;           ///< Smoothed velocity, in m/s
+        Vector3 rotation;           ///< Euler angles sent by the drone, in degrees
+        Vector3 positionDeviation;  ///< Standard deviation of each position component, in meters
+    };
+
+    /**
+     * @brief Compute the best trajectory of a recorded flight.
+     *
+     * The online position only uses past packets. After the flight, a Rauch-Tung-Striebel
+     * smoother runs a Kalman filter forward over the whole recording, then corrects every
+     * estimate with the future ones in a backward pass. Each axis is a position-velocity
+     * filter, fed with the world velocity, and the altitude for the vertical axis.
+     *
+     * The storage is allocated once for the length of the log, and reused by the next logs.
+     * A smoother is not thread safe, but smoothFiles() processes several flights in parallel.
+     */
+    class UCAPA_API TrajectorySmoother
+    {
+    public:
+        /**
+         * @brief Standard deviations of the noises, in SI units.
+         */
+        struct Parameters
+        {
+            double accelerationNoise;   ///< m/s^2, unknown acceleration of the drone
+            double velocityNoise;       ///< m/s
+            double altitudeNoise;       ///< m
+
+            Parameters()
+                : accelerationNoise(1.0)
+                , velocityNoise(0.1)
+                , altitudeNoise(0.05)
+            {
+            }
+        };
+
+    protected:
+        /**
+         * @brief Forward filter results of one axis at one sample.
+         */
+        struct AxisState
+        {
+            double state[2];            ///< Filtered position and velocity
+            double covariance[3];       ///< Filtered covariance (pp, pv, vv)
+            double predicted[2];        ///< Predicted position and velocity, before the measurement
+            double predictedCovariance[3];
+        };
+
+        Parameters m_parameters;
+        std::vector<double> m_steps;        ///< Time from the previous sample, in seconds
+        std::vector<AxisState> m_axes[3];   ///< Forward filter of each axis
+        std::vector<float> m_altitudes;     ///< Altitude of each sample, negative if unknown
+
+        /**
+         * @brief Decode the log and fill the measurements of the trajectory.
+         * @return The number of samples, or -1 if the log is invalid.
+         */
+        int decode(const std::string& log, std::vector<TrajectorySample>& trajectory);
+
+        /**
+         * @brief Run the forward filter and the backward pass of one axis.
+         * @param axis Index of the axis (0 for x, 1 for y, 2 for z).
+         * @param trajectory Measurements, replaced by the smoothed values.
+         */
+        void smoothAxis(int axis, std::vector<TrajectorySample>& trajectory);
+
+    public:
+        TrajectorySmoother(const Parameters& parameters = Parameters());
+        virtual ~TrajectorySmoother() {}
+
+        /**
+         * @brief Smooth one recorded flight.
+         * @param log Content of a log written by NavdataLogWriter.
+         * @param trajectory Filled with one sample per navdata packet.
+         * @return false if the log is invalid.
+         */
+        virtual bool smooth(const std::string& log, std::vector<TrajectorySample>& trajectory);
+
+        /**
+         * @brief Smooth several recorded flights in parallel.
+         * @param paths Paths of the log files.
+         * @param trajectories Filled with the trajectory of each log, empty for the invalid ones.
+         * @param nbThreads Number of threads, 0 to use all the cores.
+         * @param parameters Parameters of the smoothers.
+         * @return The number of flights successfully smoothed.
+         */
+        static int smoothFiles(const std::vector<std::string>& paths,
+                               std::vector<std::vector<TrajectorySample> >& trajectories,
+                               unsigned int nbThreads = 0,
+                               const Parameters& parameters = Parameters());
+    };
+}
+
+#endif // UCAPA_TRAJECTORYSMOOTHER_H
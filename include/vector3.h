@@ -26,6 +26,7 @@
 #define UCAPA_VECTOR3_H
 
 #include <cmath>
+#include <type_traits>
 
 #include <config.h>
 
@@ -34,80 +35,128 @@ namespace ucapa{
      * @brief A Vector3 class
      *
      * Allow to store triplet of value and allow to do some maths operations like dot and cross product, etc...
+     * All the operations are inline, and the ones which don't need a square root are constexpr,
+     * so they can be folded by the compiler.
+     * T is the type of the components, use the Vector3 (float) and Vector3d (double) aliases.
      */
-    class UCAPA_API Vector3
+    template<typename T>
+    class BasicVector3 // Don't use UCAPA_API for a template class, the instantiations are exported below
     {
     public:
-        const static Vector3 zero;     ///< Vector3(0, 0, 0)
-        const static Vector3 right;    ///< Vector3(1, 0, 0)
-        const static Vector3 left;     ///< Vector3(-1, 0, 0)
-        const static Vector3 up;       ///< Vector3(0, 1, 0)
-        const static Vector3 down;     ///< Vector3(0, -1, 0)
-        const static Vector3 forward;  ///< Vector3(0, 0, 1)
-        const static Vector3 backward; ///< Vector3(0, 0, -1)
-
-        float x;
-        float y;
-        float z;
+        const static BasicVector3 zero;     ///< Vector3(0, 0, 0)
+        const static BasicVector3 right;    ///< Vector3(1, 0, 0)
+        const static BasicVector3 left;     ///< Vector3(-1, 0, 0)
+        const static BasicVector3 up;       ///< Vector3(0, 1, 0)
+        const static BasicVector3 down;     ///< Vector3(0, -1, 0)
+        const static BasicVector3 forward;  ///< Vector3(0, 0, 1)
+        const static BasicVector3 backward; ///< Vector3(0, 0, -1)
+
+        typedef T Scalar;
+
+        T x;
+        T y;
+        T z;
 
         /**
          * @brief Construct a default Vector3 initialize to (0, 0, 0)
          */
-        Vector3();
+        constexpr BasicVector3() : x(0), y(0), z(0) {}
         /**
          * @brief Construct a Vector3 initialize to (x, y, z)
          */
-        Vector3(float x, float y, float z);
+        constexpr BasicVector3(T x, T y, T z) : x(x), y(y), z(z) {}
+        /**
+         * @brief Convert a vector of another precision
+         */
+        template<typename U>
+        constexpr explicit BasicVector3(const BasicVector3<U>& v) : x((T)v.x), y((T)v.y), z((T)v.z) {}
 
         /**
          * @brief Return the magnitude of the vector
          */
-        float magnitude() const;
+        T magnitude() const {return std::sqrt(x*x + y*y + z*z);}
         /**
          * @brief Return a normalized Vector
          * @return A new normalized vector
          */
-        Vector3 normalized() const;
+        BasicVector3 normalized() const
+        {
+            const T m = magnitude();
+            return BasicVector3(x/m, y/m, z/m);
+        }
 
         // Binary operators
-        bool operator!() const;
-        bool operator==(const Vector3& v) const;
-        bool operator!=(const Vector3& v) const;
+        constexpr bool operator!() const {return x == 0 && y == 0 && z == 0;} // True if all the components are null
+        constexpr bool operator==(const BasicVector3& v) const {return x == v.x && y == v.y && z == v.z;}
+        constexpr bool operator!=(const BasicVector3& v) const {return !(*this == v);}
 
         // Arithmetic operators
-        Vector3 operator-() const;
-        Vector3 operator+=(const Vector3& v);
-        Vector3 operator-=(const Vector3& v);
-        Vector3 operator/=(float f);
-        Vector3 operator*=(float f);
-        Vector3 operator+(const Vector3& v) const;
-        Vector3 operator-(const Vector3& v) const;
-        Vector3 operator/(float f) const;
-        Vector3 operator*(float f) const;
-        friend Vector3 operator*(float f, const Vector3& v) { return v*f;}
+        constexpr BasicVector3 operator-() const {return BasicVector3(-x, -y, -z);}
+        BasicVector3& operator+=(const BasicVector3& v) {x += v.x; y += v.y; z += v.z; return *this;}
+        BasicVector3& operator-=(const BasicVector3& v) {x -= v.x; y -= v.y; z -= v.z; return *this;}
+        BasicVector3& operator/=(T f) {x /= f; y /= f; z /= f; return *this;}
+        BasicVector3& operator*=(T f) {x *= f; y *= f; z *= f; return *this;}
+        constexpr BasicVector3 operator+(const BasicVector3& v) const {return BasicVector3(x + v.x, y + v.y, z + v.z);}
+        constexpr BasicVector3 operator-(const BasicVector3& v) const {return BasicVector3(x - v.x, y - v.y, z - v.z);}
+        constexpr BasicVector3 operator/(T f) const {return BasicVector3(x / f, y / f, z / f);}
+        constexpr BasicVector3 operator*(T f) const {return BasicVector3(x * f, y * f, z * f);}
+        friend constexpr BasicVector3 operator*(T f, const BasicVector3& v) {return v*f;}
 
         /**
          * @brief Compute dot product
          * @param v Other vector
          * @return Dot product
          */
-        float dot(const Vector3& v) const;
+        constexpr T dot(const BasicVector3& v) const {return x * v.x + y * v.y + z * v.z;}
 
         /**
          * @brief Compute cross product
          * @param Other vector
          * @return Cross product
          */
-        Vector3 cross(const Vector3& v) const;
+        constexpr BasicVector3 cross(const BasicVector3& v) const
+        {
+            return BasicVector3(y * v.z - z * v.y,
+                                z * v.x - x * v.z,
+                                x * v.y - y * v.x);
+        }
 
         /**
          * @brief Compute angle
          * @param v Other vector
          * @return Angle between the two vector in range [-pi, pi]
          */
-        float angle(const Vector3& v) const;
+        T angle(const BasicVector3& v) const {return std::acos(dot(v)/(magnitude()*v.magnitude()));}
 
     };
+
+    // Defined constexpr, so the constants can be used in constant expressions
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::zero;
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::right(1, 0, 0);
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::left(-1, 0, 0);
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::up(0, 1, 0);
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::down(0, -1, 0);
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::forward(0, 0, 1);
+    template<typename T> constexpr BasicVector3<T> BasicVector3<T>::backward(0, 0, -1);
+
+    typedef BasicVector3<float> Vector3;
+    typedef BasicVector3<double> Vector3d;
+
+    // Instantiated once in vector3.cpp, so the constants have a single address, even across a shared library.
+    // vector3.cpp does not see these declarations, else GCC does not emit the constructors used by the constants.
+#ifndef UCAPA_VECTOR3_INSTANTIATION
+    extern template class UCAPA_API BasicVector3<float>;
+    extern template class UCAPA_API BasicVector3<double>;
+#endif
+
+    // The layout is guaranteed, so an array of Vector3 can be copied or read as an array of floats
+    static_assert(sizeof(Vector3) == 3*sizeof(float), "Vector3 must be three packed floats");
+    static_assert(sizeof(Vector3d) == 3*sizeof(double), "Vector3d must be three packed doubles");
+    static_assert(std::is_standard_layout<Vector3>::value, "Vector3 must have a standard layout");
+#if UCAPA_HAS_IS_TRIVIALLY_COPYABLE
+    static_assert(std::is_trivially_copyable<Vector3>::value, "Vector3 must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Vector3d>::value, "Vector3d must be trivially copyable");
+#endif
 }
 
 #endif // UCAPA_VECTOR3_H
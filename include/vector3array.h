@@ -0,0 +1,141 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_VECTOR3ARRAY_H
+#define UCAPA_VECTOR3ARRAY_H
+
+#include <cstddef>
+
+#include <config.h>
+#include <matrix.h>
+#include <quaternion.h>
+#include <vector3.h>
+
+namespace ucapa{
+    /**
+     * @brief Array of vectors, stored as three arrays of components.
+     *
+     * All the x are contiguous, then all the y, then all the z, so the operations
+     * process 4 (SSE2) or 8 (AVX) vectors per instruction. The instruction set is chosen
+     * at compile time (see config.h), with a plain C++ fallback.
+     * Operations between two arrays require the same size, or throw std::length_error.
+     */
+    class UCAPA_API Vector3Array
+    {
+    protected:
+        std::size_t m_size;     ///< Number of vectors
+        std::size_t m_capacity; ///< Number of vectors allocated, a multiple of 8
+        float* m_buffer;        ///< Allocated memory
+        float* m_x;             ///< x components, aligned on 32 bytes
+        float* m_y;             ///< y components, aligned on 32 bytes
+        float* m_z;             ///< z components, aligned on 32 bytes
+
+        /**
+         * @brief Throw std::length_error if the arrays don't have the same size
+         */
+        void checkSize(const Vector3Array& v, const char* operation) const;
+
+    public:
+        /**
+         * @brief Construct an array of size vectors (0, 0, 0)
+         */
+        explicit Vector3Array(std::size_t size = 0);
+        Vector3Array(const Vector3Array& v);
+        Vector3Array(Vector3Array&& v);
+        ~Vector3Array();
+
+        Vector3Array& operator=(const Vector3Array& v);
+        Vector3Array& operator=(Vector3Array&& v);
+
+        std::size_t size() const {return m_size;}
+        std::size_t capacity() const {return m_capacity;}
+
+        /**
+         * @brief Allocate memory for at least capacity vectors, the content is kept
+         */
+        void reserve(std::size_t capacity);
+        /**
+         * @brief Change the number of vectors, new vectors are set to (0, 0, 0)
+         */
+        void resize(std::size_t size);
+        void clear() {m_size = 0;}
+        void push_back(const Vector3& v);
+
+        Vector3 get(std::size_t i) const {return Vector3(m_x[i], m_y[i], m_z[i]);}
+        void set(std::size_t i, const Vector3& v) {m_x[i] = v.x; m_y[i] = v.y; m_z[i] = v.z;}
+
+        // Direct access to the components
+        float* x() {return m_x;}
+        float* y() {return m_y;}
+        float* z() {return m_z;}
+        const float* x() const {return m_x;}
+        const float* y() const {return m_y;}
+        const float* z() const {return m_z;}
+
+        /**
+         * @brief Add the vectors of v to the vectors of this array
+         */
+        Vector3Array& add(const Vector3Array& v);
+        /**
+         * @brief Add a vector to all the vectors
+         */
+        Vector3Array& add(const Vector3& v);
+        /**
+         * @brief Multiply all the vectors by a scalar
+         */
+        Vector3Array& scale(float s);
+        /**
+         * @brief Normalize all the vectors
+         */
+        Vector3Array& normalize();
+        /**
+         * @brief Replace each vector by the matrix product m * vector
+         */
+        Vector3Array& rotate(const Matrix3f& m);
+        /**
+         * @brief Rotate all the vectors by a normalized quaternion
+         */
+        Vector3Array& rotate(const Quaternion& q);
+
+        /**
+         * @brief Compute the dot product of each vector with the vector of the same index in v
+         * @param v Other vectors
+         * @param result Array of size() floats receiving the products
+         */
+        void dot(const Vector3Array& v, float* result) const;
+        /**
+         * @brief Compute the cross product of each vector with the vector of the same index in v
+         * @param v Other vectors
+         * @param result Receive the products, it can be this array or v
+         */
+        void cross(const Vector3Array& v, Vector3Array& result) const;
+
+        /**
+         * @brief Return the name of the instruction set used: "avx", "sse2" or "scalar"
+         */
+        static const char* getInstructionSet();
+    };
+}
+
+#endif // UCAPA_VECTOR3ARRAY_H
@@ -26,66 +26,166 @@
 #define UCAPA_VIDEO_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
 #include <mutex>
 #include <iostream>
 #include <sstream>
 #include <thread>
 
+#include <asio.hpp>
+
 extern "C" {
     #include <stdint.h>
     #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
     #include <libswscale/swscale.h>
 }
 
 #include <config.h>
+#include <framepool.h>
+#include <pave.h>
+#include <yuvconverter.h>
 
 class ARDrone;
 
 namespace ucapa{
+    /**
+     * @brief Image produced with each published frame, for a consumer which needs a smaller frame or a part of it.
+     */
+    struct UCAPA_API VideoOutputSpec
+    {
+        FrameHandle::FORMAT format; ///< FORMAT_RGB24, FORMAT_BGRA, FORMAT_RGBA or FORMAT_GRAY8
+        float scale;    ///< Size of the image relative to the region, in ]0, 1]. 0.25 gives 320x180 from the 720p stream
+        int x;          ///< Left of the region of interest, rounded down to even
+        int y;          ///< Top of the region of interest, rounded down to even
+        int width;      ///< Width of the region, 0 to extend it to the right of the frame
+        int height;     ///< Height of the region, 0 to extend it to the bottom of the frame
+
+        VideoOutputSpec(FrameHandle::FORMAT format = FrameHandle::FORMAT_RGB24, float scale = 1.0f, int x = 0, int y = 0, int width = 0, int height = 0)
+            : format(format), scale(scale), x(x), y(y), width(width), height(height) {}
+    };
+
     /**
      * @brief Manage ARDrone video stream.
      *
      * Receive video stream from the drone.
+     * The PaVE headers of the stream are parsed directly on the TCP socket, so the H.264
+     * payloads are decoded from the first key frame, without probing the stream.
      */
     class UCAPA_API Video
     {
     protected:
+        /**
+         * @brief Packet read from the stream, waiting to be decoded.
+         */
+        struct VideoPacket
+        {
+            AVPacket packet;
+            PaVEHeader header;
+            std::chrono::steady_clock::time_point receptionTime; ///< Time at which the packet was read
+            std::chrono::steady_clock::time_point timestamp; ///< Time of the capture if the drone clock is known, else receptionTime
+        };
+
         const std::string m_droneIP; ///< Drone IP.
         const unsigned short m_videoPort; ///< Drone video port.
         std::function<void()> m_callbackInitFunc; ///< Function that will send the init packet to the video port.
+        std::function<std::chrono::steady_clock::time_point(double)> m_droneTimeToHost; ///< Convert the drone time of the frames, protected by m_packetMutex.
 
         // Video Data (codec, format, frame, etc..)
         std::thread m_videoThread; ///< Thread with the loop for decoding the video.
+        std::thread m_readThread; ///< Thread running m_ioService, to read the packets of the stream as soon as they arrive.
         std::thread m_reconnectionThread; ///< Thread for the test ofreconnection if it's needed.
         std::thread m_launcherReconnectThread;  ///< Thread for the automatic video reconnection.
         mutable std::mutex m_videoMutex; ///< Mutex that manage access to video variables.
-        AVFormatContext* m_pFormatCtx; ///< Pointer on the Format of the video stream.
+        asio::io_service m_ioService; ///< Network service of the video stream.
+        asio::ip::tcp::socket m_socket; ///< Video stream socket.
+        uint8_t m_headerBuffer[PaVEHeader::MAX_SIZE]; ///< Header being read.
+        std::size_t m_headerLength; ///< Number of bytes of the header already in m_headerBuffer.
+        VideoPacket m_pendingPacket; ///< Packet whose payload is being read.
         AVCodecContext* m_pCodecCtx; ///< Pointer on the Codec to use for the video stream.
         AVFrame* m_pFrame; ///< Pointer on the frame decoded.
-        AVFrame* m_pFrameRGB; ///< Pointer on the frame in color.
-        uint8_t* m_pFrameBufferReturned; ///< Pointer on the buffer in color of the frame returned, copy of the buffer of pFrameRGB, because of the use of mutex.
-        uint8_t* m_bufferRGB; ///< Buffer used for the frame allocation.
-        SwsContext* m_pConvertCtx; ///< Converter, to convert the frame into RGB mode.
+        mutable std::mutex m_frameMutex; ///< Mutex that manage access to m_framePool and m_pFrameBufferReturned, never held while decoding.
+        std::shared_ptr<FramePool> m_framePool; ///< Decoded frames, referencing the planes of the decoder, converted on demand.
+        AVPixelFormat m_poolFormat; ///< Pixel format of the frames of m_framePool, only used by the decoding thread.
+        std::shared_ptr<YuvConverter> m_yuvConverter; ///< Converter of the frames, shared by the successive frame pools.
+        std::mutex m_outputMutex; ///< Mutex that manage access to m_outputs and m_nextOutputId.
+        std::map<int, VideoOutputSpec> m_outputs; ///< Registered outputs, by identifier.
+        int m_nextOutputId; ///< Identifier of the next registered output.
+        std::map<int, SwsContext*> m_outputScalers; ///< Scalers of the resized outputs, only used by the decoding thread.
+        uint8_t* m_pFrameBufferReturned; ///< Copy of the latest frame returned by the deprecated getFrame().
+        std::mutex m_packetMutex; ///< Mutex that manage access to m_packets and m_waitKeyFrame.
+        std::condition_variable m_packetAvailable; ///< Wake up the decoding thread when a packet is read or when it needs to stop.
+        std::deque<VideoPacket> m_packets; ///< Packets read and not decoded yet, the oldest first.
+        bool m_waitKeyFrame; ///< Indicate if the packets are skipped until the next key frame, after a backlog was dropped.
+        std::atomic<bool> m_latestFrameOnly; ///< Indicate if the decoded frames are only converted when no newer packet is waiting.
+        std::atomic<int> m_decoderThreading; ///< Threading of the decoder, a DECODER_THREADING.
+        std::atomic<int> m_decoderThreadCount; ///< Number of decoding threads, 0 for one per core.
+        std::atomic<bool> m_decoderLowDelay; ///< Indicate if the decoder outputs the frames without delay.
+        std::atomic<uint64_t> m_nbStaleFrames; ///< Number of frames skipped because newer ones were already received.
+        std::atomic<long long> m_frameLatency; ///< Smoothed delay between the capture of a frame and its publication, in nanoseconds
+        std::chrono::steady_clock::time_point m_lastPublication; ///< Time of the last frame published, only used by the decoding thread.
         std::atomic<bool> m_isActive; ///< State of video stream, enable or disable.
         std::atomic<bool> m_possiblyDeconnected; ///< Indicate if we have maybe a deconnection with the drone, return to false if another frame of video stream is received.
         std::atomic<bool> m_firstConnection;    ///< Indicate if it's the first time that we try to connect to video stream.
         std::atomic<bool> m_terminate;  ///< Indicate if the application need to terminate the video receiving.
         const int m_nbTryingReconnection = 16; ///< Number of attempts to try to reconnect Video Stream.
+        const std::size_t m_maxQueuedPackets = 60; ///< Number of packets waiting to be decoded above which the backlog is dropped.
+        const std::chrono::milliseconds m_maxSkipDuration = std::chrono::milliseconds(100); ///< Maximal time without publication when the frames are stale.
 
         /**
          * @brief Init the connection on ARDrone Video port.
          * @return 0 if no problem happen,<br>
-         *         -1 if Could not open the video file,<br>
+         *         -1 if Could not connect to the video port,<br>
          *         -2 if Finding Codec failed,<br>
          *         -3 if Opening Codec failed,<br>
          *         -256 if an exception was thrown.
          */
         virtual int init();
         /**
-         * @brief Decode a frame from ARDrone Video port.
+         * @brief Wait asynchronously for the next PaVE header, or for the end of the current one.
+         */
+        virtual void readHeader();
+        /**
+         * @brief Check the received header, and wait for its payload.
+         *
+         * If the header is corrupted, the next signature is searched.
+         */
+        virtual void handleHeader(const std::error_code& error);
+        /**
+         * @brief Queue the received packet for the decoding, and wait for the next header.
+         *
+         * When the decoding is too late, the waiting packets are dropped and the
+         * next ones are skipped until a key frame.
+         */
+        virtual void handlePayload(const std::error_code& error);
+        /**
+         * @brief Stop the reading after an error of the socket, the video thread then reconnects.
+         */
+        virtual void handleReadError(const std::error_code& error);
+        /**
+         * @brief Decode the oldest queued packet, wait for one if there is none.
+         *
+         * A decoded frame is published as soon as it is ready.
          */
         virtual void decode();
+        /**
+         * @brief Free the queued packets, m_packetMutex must be locked.
+         */
+        void clearPackets();
+        /**
+         * @brief Create the frame pool and its converters, if the size or the format of the frames changed.
+         * @return false if the format of the frames is not YUV 4:2:0, they can't be published.
+         */
+        virtual bool prepareFramePool(int width, int height, AVPixelFormat format);
+        /**
+         * @brief Produce the images of the registered outputs from the frame of a buffer, before its publication.
+         *
+         * The outputs at the scale of the frame use the YUV converter, the other ones are resized with swscale.
+         */
+        virtual void produceOutputs(FrameHandle::Buffer* buffer);
         /**
          * @brief Try to connect Video Stream nbTryingReconnection times.
          */
@@ -108,6 +208,16 @@ namespace ucapa{
         virtual void stopVideoThread();
 
     public:
+        /**
+         * @brief Parallelization of the H.264 decoding.
+         */
+        enum DECODER_THREADING {
+            NO_THREADING = 0, ///< Decode on the video thread only.
+            FRAME_THREADING = 1, ///< Decode several frames in parallel, each thread delays the frames by one.
+            SLICE_THREADING = 2, ///< Decode the slices of a frame in parallel, without delay. Useless if the frames have a single slice.
+            FRAME_AND_SLICE_THREADING = 3 ///< Let the decoder choose, frame threading first.
+        };
+
         /**
          * @brief Video constructor.
          * @param droneIP Drone IP.
@@ -122,6 +232,14 @@ namespace ucapa{
          * @param callbackInitFunc function that will be call in the first init of video
          */
         virtual void setCallbackInitFunc(std::function<void()> callbackInitFunc);
+        /**
+         * @brief Set the function converting the drone time of the frames into host time.
+         *
+         * The frames are then stamped with their capture time, in the same clock as the navdata,
+         * instead of their reception time. The ARDrone class uses Navdata::droneTimeToHost().
+         * @param droneTimeToHost function converting a drone time, in seconds, into host time
+         */
+        virtual void setDroneClock(std::function<std::chrono::steady_clock::time_point(double)> droneTimeToHost);
 
         /**
          * @brief Try to init the video stream for receiving it.
@@ -133,14 +251,114 @@ namespace ucapa{
         virtual void stop();
 
         // Accessors
+        /**
+         * @brief Return the latest frame decoded from ARDrone video stream, without copy.
+         *
+         * The YUV420P planes are those of the decoder. The frame is only converted into
+         * RGB24, BGRA, RGBA or GRAY8 when a reader asks for it, see FrameHandle::getData().
+         * The frame is not modified while the handle exists, but hold it only while reading it:
+         * the decoder drops the new frames when the readers hold all the buffers.
+         *
+         * @return the latest frame, an invalid handle if no frame was decoded yet.
+         */
+        virtual FrameHandle getLatestFrame() const;
         /**
          * @brief Return buffer data of the current frame decoded from ARDrone video stream.
          *
          * Each pixel is represented by the sequence of the following 3 values: R, G, B.
          *
          * @return the current RGB frame data buffer.
+         * @deprecated The frame is copied, and the buffer is overwritten by the next call. Use getLatestFrame().
          */
         virtual uint8_t* getFrame() const;
+        /**
+         * @brief Return the number of frames dropped because the readers held all the buffers.
+         */
+        virtual uint64_t getNbDroppedFrames() const;
+        /**
+         * @brief Return if only the latest frame is published.
+         */
+        virtual bool isLatestFrameOnly() const {return m_latestFrameOnly;}
+        /**
+         * @brief Only publish the latest frame.
+         *
+         * Under load, when a newer packet is already received after a frame is decoded,
+         * the frame is not converted and not published. All the packets are still decoded,
+         * because the next frames depend on them. If the decoding can't catch up, a frame is
+         * still published every 100 ms. Activated by default.
+         * @param activate true to skip the stale frames, false to publish all the frames.
+         */
+        virtual void setLatestFrameOnly(bool activate) {m_latestFrameOnly = activate;}
+        /**
+         * @brief Return the threading of the decoder.
+         */
+        virtual DECODER_THREADING getDecoderThreading() const {return (DECODER_THREADING)(int)m_decoderThreading;}
+        /**
+         * @brief Set the threading of the decoder, used at the next connection (see restart()).
+         *
+         * SLICE_THREADING by default, it adds no latency. FRAME_THREADING also speeds up
+         * the streams with a single slice per frame, but it delays each frame by one frame
+         * per thread, and it is only active without the low delay.
+         * @param threading threading of the decoder
+         */
+        virtual void setDecoderThreading(DECODER_THREADING threading) {m_decoderThreading = threading;}
+        /**
+         * @brief Return the number of decoding threads, 0 for one per core.
+         */
+        virtual int getDecoderThreadCount() const {return m_decoderThreadCount;}
+        /**
+         * @brief Set the number of decoding threads, used at the next connection (see restart()).
+         * @param nbThreads number of threads, 0 for one per core (default), 1 to disable the threading
+         */
+        virtual void setDecoderThreadCount(int nbThreads) {m_decoderThreadCount = nbThreads;}
+        /**
+         * @brief Return if the decoder outputs each frame as soon as it is decoded.
+         */
+        virtual bool isDecoderLowDelay() const {return m_decoderLowDelay;}
+        /**
+         * @brief Output each frame as soon as it is decoded, used at the next connection (see restart()).
+         *
+         * Activated by default. It disables the frame threading.
+         * @param activate true to force the low delay, false to let the decoder reorder the frames
+         */
+        virtual void setDecoderLowDelay(bool activate) {m_decoderLowDelay = activate;}
+        /**
+         * @brief Apply threading options to a decoder, before it is opened.
+         *
+         * Used for the video stream, public to test the options on recorded streams.
+         * @param codecCtx context of the decoder, not opened yet
+         * @param threading threading of the decoder
+         * @param nbThreads number of threads, 0 for one per core
+         * @param lowDelay true to output each frame as soon as it is decoded
+         */
+        static void configureDecoder(AVCodecContext* codecCtx, DECODER_THREADING threading, int nbThreads, bool lowDelay);
+        /**
+         * @brief Return the number of frames skipped because newer ones were already received.
+         */
+        virtual uint64_t getNbStaleFrames() const {return m_nbStaleFrames;}
+        /**
+         * @brief Return the smoothed delay between the capture of a frame and its publication.
+         *
+         * It includes the encoding and the transmission when the drone clock is set with setDroneClock(),
+         * then the waiting in the queue, the decoding and the conversion.
+         * Without the drone clock, it starts at the reception of the frame.
+         */
+        virtual std::chrono::duration<double> getFrameLatency() const;
+        /**
+         * @brief Produce an image with each published frame, read with FrameHandle::getOutput().
+         *
+         * The image is produced once per frame by the decoding thread, in memory reused from frame to frame,
+         * so the consumers don't convert or resize the full frame themselves. It costs decoding time
+         * until the output is unregistered, even if nobody reads it.
+         * @param spec format, scale and region of interest of the image
+         * @return the identifier of the output, -1 if the spec is invalid.
+         */
+        virtual int registerOutput(const VideoOutputSpec& spec);
+        /**
+         * @brief Stop producing an output, the frames already published keep their image.
+         * @return false if the identifier is unknown.
+         */
+        virtual bool unregisterOutput(int id);
         /**
          * @brief Return the width of the current frame.
          * @return frame width,
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef UCAPA_YUVCONVERTER_H
+#define UCAPA_YUVCONVERTER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include <config.h>
+#include <framepool.h>
+
+namespace ucapa{
+    /**
+     * @brief Convert YUV420P frames into packed RGB formats.
+     *
+     * Same-size conversion only, with the BT.601 coefficients in 16 bits fixed point, as the
+     * decoders of the AR.Drone stream expect. The kernel uses AVX2 when the CPU supports it,
+     * detected at runtime, else SSE2 (see config.h), else plain C++. All of them give the same result.
+     * The rows are split in stripes converted in parallel by persistent workers, so the
+     * threads are not created for each frame.
+     * A converter can be shared: when it is busy, other callers convert on their own thread.
+     */
+    class UCAPA_API YuvConverter
+    {
+    public:
+        /**
+         * @brief Instruction sets of the kernels
+         */
+        enum INSTRUCTION_SET {
+            SCALAR = 0,
+            SSE2,
+            AVX2
+        };
+
+        /**
+         * @brief Parameters of a conversion, given to the workers.
+         */
+        struct Job
+        {
+            const uint8_t* planes[3];
+            int strides[3];
+            int width;
+            int height;
+            bool fullRange;
+            FrameHandle::FORMAT format;
+            uint8_t* dest;
+            int destStride;
+            INSTRUCTION_SET instructionSet;
+            int nbStripes;
+        };
+
+    protected:
+        INSTRUCTION_SET m_instructionSet;
+        std::vector<std::thread> m_workers;
+        std::mutex m_jobMutex;          ///< Held by the caller whose conversion uses the workers
+        std::mutex m_mutex;             ///< Protect the job and the stripe counters
+        std::condition_variable m_stripeAvailable;
+        std::condition_variable m_jobDone;
+        Job m_job;
+        int m_nextStripe;               ///< Next stripe of m_job to convert
+        int m_nbPendingStripes;         ///< Number of stripes of m_job not converted yet
+        bool m_stop;
+
+        static const int MIN_STRIPE_HEIGHT = 64; ///< Smaller stripes cost more to synchronize than to convert
+
+        /**
+         * @brief Wait for stripes to convert, until the converter is destroyed.
+         */
+        void work();
+        /**
+         * @brief Convert the stripes of m_job that are left, and wait for the workers. m_mutex must be locked.
+         */
+        void finishJob(std::unique_lock<std::mutex>& lock);
+        /**
+         * @brief Convert a stripe of rows of a job.
+         */
+        static void convertStripe(const Job& job, int stripe);
+
+    public:
+        /**
+         * @brief Start the workers.
+         * @param nbThreads Number of threads converting a frame, including the caller. 0 for one per core, up to 4
+         */
+        explicit YuvConverter(int nbThreads = 0);
+        virtual ~YuvConverter();
+
+        YuvConverter(const YuvConverter&) = delete;
+        YuvConverter& operator=(const YuvConverter&) = delete;
+
+        /**
+         * @brief Convert a frame.
+         * @param planes,strides Y, U and V planes, U and V have half the width and the height of Y, rounded up
+         * @param width,height Size of the frame, in pixels
+         * @param fullRange true for YUVJ420P (Y from 0 to 255), false for YUV420P (Y from 16 to 235)
+         * @param format FORMAT_RGB24, FORMAT_BGRA or FORMAT_RGBA
+         * @param dest,destStride Converted frame
+         * @return false if the format is not supported
+         */
+        bool convert(const uint8_t* const planes[3], const int strides[3], int width, int height, bool fullRange,
+                     FrameHandle::FORMAT format, uint8_t* dest, int destStride);
+
+        int getNbThreads() const {return (int)m_workers.size() + 1;}
+        INSTRUCTION_SET getInstructionSet() const {return m_instructionSet;}
+        /**
+         * @brief Force an instruction set, to compare them. The best one is used by default.
+         *
+         * Not thread safe, call it before the conversions.
+         * @return false if the CPU or the build don't support it, the instruction set is then unchanged
+         */
+        bool setInstructionSet(INSTRUCTION_SET instructionSet);
+
+        /**
+         * @brief Return the best instruction set supported by the CPU and the build.
+         */
+        static INSTRUCTION_SET detectInstructionSet();
+        static const char* getInstructionSetName(INSTRUCTION_SET instructionSet);
+    };
+}
+
+#endif // UCAPA_YUVCONVERTER_H
@@ -24,6 +24,8 @@
 
 #include <ardrone.h>
 
+#include <cmath>
+
 namespace ucapa{
     ARDrone::ARDrone(std::string sessionId, std::string userId, std::string appId,
                      const std::string ardIp,
@@ -54,6 +56,13 @@ namespace ucapa{
         , m_video(video)
     {
         m_video->setCallbackInitFunc([this]() {this->m_connectionsHandler->sendInitVideoData();});
+        // The PaVE timestamps don't wrap like the navdata ones, the frames are close to the last navdata
+        m_video->setDroneClock([this](double droneTime) -> std::chrono::steady_clock::time_point {
+                                    double navdataTime = this->m_navdata->getDroneTime();
+                                    if (navdataTime < 0)
+                                        return std::chrono::steady_clock::time_point();
+                                    return this->m_navdata->droneTimeToHost(navdataTime + std::remainder(droneTime - navdataTime, 2048.0));
+                                });
 
         AT_CONFIG("custom:session_id", sessionId);
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -283,6 +292,21 @@ namespace ucapa{
         m_navdata->setComputeWorldData(b);
     }
 
+    void ARDrone::setEstimatePose(bool b)
+    {
+        m_navdata->setEstimatePose(b);
+    }
+
+    void ARDrone::setNavdataPublisher(std::shared_ptr<NavdataShmPublisher> publisher)
+    {
+        m_navdata->setPublisher(publisher);
+    }
+
+    void ARDrone::setNavdataRecorder(std::shared_ptr<NavdataLogWriter> recorder)
+    {
+        m_navdata->setRecorder(recorder);
+    }
+
 
     void ARDrone::setDefaultConfig()
     {
@@ -24,6 +24,13 @@
 
 #include <ardroneconnections.h>
 
+#include <cstring>
+
+#ifdef __linux__
+    #include <sys/socket.h>
+    #include <time.h>
+#endif
+
 namespace ucapa{
     ARDroneConnections::ARDroneConnections(const std::string& droneIP,
                                            unsigned short ATCmdsPort,
@@ -45,6 +52,9 @@ namespace ucapa{
         // Init Control connection with the drone
         , m_CtrlEndpoint(asio::ip::address::from_string(droneIP), CtrlPort)
         , m_CtrlSocket(m_ioService)
+        , m_kernelTimestamps(false)
+        , m_navdataPendingWithTimestamp(false)
+        , m_navdataLatency(0)
     {
         static_assert( sizeof(float) == 4, "float must be coded on 4 Bytes.");
         try
@@ -92,10 +102,7 @@ namespace ucapa{
         try
         {
             // Receive nadata
-            udp::endpoint sender_endpoint;
-            auto buffer = asio::buffer(navdataBuffer, m_max_length);
-            m_NavdataSocket.async_receive_from(buffer, sender_endpoint,
-                                             [this](std::error_code ec, std::size_t bytes_recvd){ this->handleNavdata(ec, bytes_recvd);});
+            startNavdataReception();
 
             // Start running asyncronous service
             m_ioServiceRunningThread = std::thread([this]() {this->m_ioService.run();});
@@ -106,28 +113,116 @@ namespace ucapa{
         }
     }
 
-    void ARDroneConnections::handleNavdata(std::error_code ec, std::size_t bytes_recvd)
+    void ARDroneConnections::startNavdataReception()
     {
-        if (!ec)
+        m_navdataPendingWithTimestamp = m_kernelTimestamps;
+        if (m_navdataPendingWithTimestamp)
         {
-            std::cerr << std::endl << "error: handle " << ec.message() << std::endl << std::endl;
+            // Only wait for the packet, it is read with its timestamp in the handler
+            m_NavdataSocket.async_receive(asio::null_buffers(),
+                                          [this](std::error_code ec, std::size_t bytes_recvd){ this->handleNavdata(ec, bytes_recvd);});
         }
-        else //if(bytes_recvd > 0)
+        else
         {
-            if (!m_navdata.expired())
+            auto buffer = asio::buffer(navdataBuffer, m_max_length);
+            m_NavdataSocket.async_receive_from(buffer, m_navdataSenderEndpoint,
+                                               [this](std::error_code ec, std::size_t bytes_recvd){ this->handleNavdata(ec, bytes_recvd);});
+        }
+    }
+
+    int ARDroneConnections::receiveNavdataWithTimestamp(std::chrono::steady_clock::time_point& receptionTime)
+    {
+#ifdef __linux__
+        struct iovec iov;
+        iov.iov_base = navdataBuffer;
+        iov.iov_len = m_max_length;
+
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+        struct msghdr msg = msghdr();
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(m_NavdataSocket.native_handle(), &msg, MSG_DONTWAIT);
+        if (received < 0)
+            return -1;
+
+        // Take both clocks now, to convert the kernel time (realtime clock) into steady time
+        receptionTime = std::chrono::steady_clock::now();
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
             {
-               std::shared_ptr<Navdata> nav = m_navdata.lock();
-               auto receptionTime = std::chrono::steady_clock::now();
-               nav->update(std::string(navdataBuffer, bytes_recvd), receptionTime - m_navdataLastReceptionTime);
-               m_navdataLastReceptionTime = receptionTime;
+                struct timespec kernelTime;
+                std::memcpy(&kernelTime, CMSG_DATA(cmsg), sizeof(kernelTime));
+                long long delay = (now.tv_sec - kernelTime.tv_sec) * 1000000000LL + (now.tv_nsec - kernelTime.tv_nsec);
+                if (delay >= 0)
+                {
+                    receptionTime -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(delay));
+                    m_navdataLatency = (m_navdataLatency * 15 + delay) / 16;
+                }
+                break;
             }
         }
+        return (int)received;
+#else
+        (void)receptionTime;
+        return -1;
+#endif
+    }
+
+    void ARDroneConnections::handleNavdata(std::error_code ec, std::size_t bytes_recvd)
+    {
+        if (ec)
+        {
+            if (ec == asio::error::operation_aborted)
+                return;
+            std::cerr << std::endl << "error: handle " << ec.message() << std::endl << std::endl;
+        }
+        else
+        {
+            auto receptionTime = std::chrono::steady_clock::now();
+            int size = (int)bytes_recvd;
+            if (m_navdataPendingWithTimestamp)
+                size = receiveNavdataWithTimestamp(receptionTime);
+
+            std::shared_ptr<Navdata> nav = m_navdata.lock();
+            if (nav && size > 0)
+                nav->update(std::string(navdataBuffer, size), receptionTime);
+            m_navdataLastReceptionTime = receptionTime;
+        }
 
         // Prepare the reception again
-        udp::endpoint sender_endpoint;
-        auto buffer = asio::buffer(navdataBuffer, m_max_length);
-        m_NavdataSocket.async_receive_from(buffer, sender_endpoint,
-                                         [this](std::error_code ec, std::size_t bytes_recvd){ this->handleNavdata(ec, bytes_recvd);} );
+        startNavdataReception();
+    }
+
+    bool ARDroneConnections::setKernelTimestamps(bool enable)
+    {
+#ifdef __linux__
+        int value = enable ? 1 : 0;
+        if (setsockopt(m_NavdataSocket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &value, sizeof(value)) != 0)
+        {
+            std::cerr << "Could not set SO_TIMESTAMPNS on the navdata socket" << std::endl;
+            return false;
+        }
+        // The pending reception keeps its mode, the next ones will use the new one
+        m_kernelTimestamps = enable;
+        return true;
+#else
+        if (enable)
+            std::cerr << "Kernel timestamps are only available on Linux" << std::endl;
+        m_kernelTimestamps = false;
+        return !enable;
+#endif
+    }
+
+    std::chrono::duration<double> ARDroneConnections::getNavdataReceptionLatency() const
+    {
+        return std::chrono::nanoseconds(m_navdataLatency.load());
     }
 
     void ARDroneConnections::sendInitVideoData()
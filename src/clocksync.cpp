@@ -0,0 +1,135 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <clocksync.h>
+
+namespace ucapa{
+    ClockSync::ClockSync(double blockDuration, int nbBlocks)
+        : m_blockDuration(blockDuration > 0 ? blockDuration : 1.0)
+        , m_nbBlocks(nbBlocks < 2 ? 2 : (nbBlocks > MAX_BLOCKS ? MAX_BLOCKS : nbBlocks))
+    {
+        reset();
+    }
+
+    void ClockSync::reset()
+    {
+        m_hasReference = false;
+        m_blockEmpty = true;
+        m_blockStart = 0;
+        m_blockMinDrone = 0;
+        m_blockMinDiff = 0;
+        m_nbFinishedBlocks = 0;
+        m_nextBlock = 0;
+        m_offset = 0;
+        m_drift = 0;
+    }
+
+    void ClockSync::addSample(double droneTime, TimePoint receptionTime)
+    {
+        bool firstSample = !m_hasReference;
+        if (firstSample)
+        {
+            m_hostReference = receptionTime;
+            m_hasReference = true;
+        }
+
+        double host = std::chrono::duration<double>(receptionTime - m_hostReference).count();
+        double diff = host - droneTime;
+
+        if (!m_blockEmpty && droneTime - m_blockStart >= m_blockDuration)
+            finishBlock();
+
+        if (m_blockEmpty)
+        {
+            m_blockStart = droneTime;
+            m_blockMinDrone = droneTime;
+            m_blockMinDiff = diff;
+            m_blockEmpty = false;
+        }
+        else if (diff < m_blockMinDiff)
+        {
+            m_blockMinDrone = droneTime;
+            m_blockMinDiff = diff;
+        }
+
+        // Until a drift can be fitted, use the smallest difference seen so far
+        if (m_nbFinishedBlocks < 2 && (firstSample || diff < m_offset))
+            m_offset = diff;
+    }
+
+    void ClockSync::finishBlock()
+    {
+        m_blockDrone[m_nextBlock] = m_blockMinDrone;
+        m_blockDiff[m_nextBlock] = m_blockMinDiff;
+        m_nextBlock = (m_nextBlock + 1) % m_nbBlocks;
+        if (m_nbFinishedBlocks < m_nbBlocks)
+            m_nbFinishedBlocks++;
+        m_blockEmpty = true;
+
+        fit();
+    }
+
+    void ClockSync::fit()
+    {
+        if (m_nbFinishedBlocks < 2)
+            return;
+
+        // Least squares line through the block minima, centered for precision
+        double meanDrone = 0, meanDiff = 0;
+        for (int i=0; i<m_nbFinishedBlocks; ++i)
+        {
+            meanDrone += m_blockDrone[i];
+            meanDiff += m_blockDiff[i];
+        }
+        meanDrone /= m_nbFinishedBlocks;
+        meanDiff /= m_nbFinishedBlocks;
+
+        double sxx = 0, sxy = 0;
+        for (int i=0; i<m_nbFinishedBlocks; ++i)
+        {
+            double dx = m_blockDrone[i] - meanDrone;
+            sxx += dx * dx;
+            sxy += dx * (m_blockDiff[i] - meanDiff);
+        }
+
+        m_drift = (sxx > 0) ? sxy / sxx : 0;
+
+        // Lower the line so that no block minimum is under it
+        double offset = meanDiff - m_drift * meanDrone;
+        double minResidual = 0;
+        for (int i=0; i<m_nbFinishedBlocks; ++i)
+        {
+            double residual = m_blockDiff[i] - (offset + m_drift * m_blockDrone[i]);
+            if (residual < minResidual)
+                minResidual = residual;
+        }
+        m_offset = offset + minResidual;
+    }
+
+    ClockSync::TimePoint ClockSync::toHostTime(double droneTime) const
+    {
+        double host = droneTime + m_offset + m_drift * droneTime;
+        return m_hostReference + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(host));
+    }
+}
@@ -0,0 +1,185 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <fastmath.h>
+
+#include <cmath>
+
+#include <simdpack.h>
+
+namespace ucapa{
+    namespace{
+        // pi/2 split in three parts, the first ones have few significant bits so that j * part is exact
+        const float PIO2_1 = 1.5703125f;
+        const float PIO2_2 = 4.837512969970703125e-4f;
+        const float PIO2_3 = 7.54978995489188216e-8f;
+        const float TWO_OVER_PI = 0.636619772367581343f;
+
+        /**
+         * @brief Sine and cosine of a pack of angles
+         */
+        template<typename P>
+        inline void sinCosPack(typename P::Type x, typename P::Type& sine, typename P::Type& cosine)
+        {
+            typedef typename P::Type T;
+
+            // x = j * pi/2 + r, with r in [-pi/4, pi/4]
+            const T j = P::round(P::mul(x, P::set(TWO_OVER_PI)));
+            T r = P::sub(x, P::mul(j, P::set(PIO2_1)));
+            r = P::sub(r, P::mul(j, P::set(PIO2_2)));
+            r = P::sub(r, P::mul(j, P::set(PIO2_3)));
+
+            // Minimax polynomials on [-pi/4, pi/4]
+            const T z = P::mul(r, r);
+            T s = P::add(P::mul(P::set(-1.9515295891e-4f), z), P::set(8.3321608736e-3f));
+            s = P::add(P::mul(s, z), P::set(-1.6666654611e-1f));
+            s = P::add(r, P::mul(P::mul(s, z), r));
+            T c = P::add(P::mul(P::set(2.443315711809948e-5f), z), P::set(-1.388731625493765e-3f));
+            c = P::add(P::mul(c, z), P::set(4.166664568298827e-2f));
+            c = P::add(P::sub(P::set(1.0f), P::mul(P::set(0.5f), z)), P::mul(P::mul(c, z), z));
+
+            // Quadrant q = j mod 4, computed with floats since AVX has no integer operations.
+            // j is an integer, so the rounded values below are floors.
+            const T q = P::sub(j, P::mul(P::set(4.0f), P::round(P::sub(P::mul(j, P::set(0.25f)), P::set(0.375f)))));
+            const T parity = P::sub(q, P::mul(P::set(2.0f), P::round(P::sub(P::mul(q, P::set(0.5f)), P::set(0.25f)))));
+            const typename P::Mask odd = P::lessThan(P::set(0.5f), parity);
+            const typename P::Mask sineNegative = P::lessThan(P::set(1.5f), q);
+            const typename P::Mask cosineNegative = P::both(P::lessThan(P::set(0.5f), q), P::lessThan(q, P::set(2.5f)));
+
+            const T s0 = P::select(odd, c, s);
+            const T c0 = P::select(odd, s, c);
+            sine = P::select(sineNegative, P::sub(P::set(0.0f), s0), s0);
+            cosine = P::select(cosineNegative, P::sub(P::set(0.0f), c0), c0);
+        }
+
+        template<typename P>
+        std::size_t sinCosKernel(const float* angles, float* sines, float* cosines, std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                typename P::Type s, c;
+                sinCosPack<P>(P::load(angles+i), s, c);
+                P::store(sines+i, s);
+                P::store(cosines+i, c);
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t eulerKernel(const float* x, const float* y, const float* z, Quaternion* quaternions,
+                                std::size_t begin, std::size_t end)
+        {
+            typedef typename P::Type T;
+            const T half = P::set(0.5f);
+
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                T sx, cx, sy, cy, sz, cz;
+                sinCosPack<P>(P::mul(P::load(x+i), half), sx, cx);
+                sinCosPack<P>(P::mul(P::load(y+i), half), sy, cy);
+                sinCosPack<P>(P::mul(P::load(z+i), half), sz, cz);
+
+                const T cycz = P::mul(cy, cz);
+                const T sycz = P::mul(sy, cz);
+                const T cysz = P::mul(cy, sz);
+                const T sysz = P::mul(sy, sz);
+
+                // Computed as packs of x, of y..., then interleaved
+                float components[4][P::WIDTH];
+                P::store(components[0], P::sub(P::mul(sx, cycz), P::mul(cx, sysz)));
+                P::store(components[1], P::add(P::mul(cx, sycz), P::mul(sx, cysz)));
+                P::store(components[2], P::sub(P::mul(cx, cysz), P::mul(sx, sycz)));
+                P::store(components[3], P::add(P::mul(cx, cycz), P::mul(sx, sysz)));
+                for (std::size_t k=0; k<P::WIDTH; ++k)
+                    quaternions[i+k] = Quaternion(components[0][k], components[1][k], components[2][k], components[3][k]);
+            }
+            return i;
+        }
+    }
+
+
+    void FastMath::sinCos(float angle, float& sine, float& cosine, ACCURACY accuracy)
+    {
+        if (accuracy == EXACT)
+        {
+            sine = (float)std::sin((double)angle);
+            cosine = (float)std::cos((double)angle);
+        }
+        else
+            sinCosPack<simd::ScalarPack>(angle, sine, cosine);
+    }
+
+    void FastMath::sinCos(const float* angles, std::size_t n, float* sines, float* cosines, ACCURACY accuracy)
+    {
+        if (accuracy == EXACT)
+        {
+            for (std::size_t i=0; i<n; ++i)
+                sinCos(angles[i], sines[i], cosines[i], EXACT);
+        }
+        else
+            UCAPA_RUN_KERNEL(sinCosKernel, n, angles, sines, cosines);
+    }
+
+    Quaternion FastMath::eulerToQuaternion(float x, float y, float z, ACCURACY accuracy)
+    {
+        if (accuracy == EXACT)
+            return Quaternion(x, y, z);
+
+#if defined(UCAPA_HAS_SSE2)
+        // The three half angles fit in one pack, and the selections of the quadrants have no branch
+        float s[4], c[4];
+        simd::SsePack::Type sines, cosines;
+        sinCosPack<simd::SsePack>(_mm_mul_ps(_mm_set_ps(0.0f, z, y, x), _mm_set1_ps(0.5f)), sines, cosines);
+        simd::SsePack::store(s, sines);
+        simd::SsePack::store(c, cosines);
+
+        const float cycz = c[1] * c[2];
+        const float sycz = s[1] * c[2];
+        const float cysz = c[1] * s[2];
+        const float sysz = s[1] * s[2];
+        return Quaternion(s[0] * cycz - c[0] * sysz,
+                          c[0] * sycz + s[0] * cysz,
+                          c[0] * cysz - s[0] * sycz,
+                          c[0] * cycz + s[0] * sysz);
+#else
+        Quaternion q;
+        eulerKernel<simd::ScalarPack>(&x, &y, &z, &q, 0, 1);
+        return q;
+#endif
+    }
+
+    void FastMath::eulerToQuaternions(const float* x, const float* y, const float* z, std::size_t n,
+                                      Quaternion* quaternions, ACCURACY accuracy)
+    {
+        if (accuracy == EXACT)
+        {
+            for (std::size_t i=0; i<n; ++i)
+                quaternions[i].setFromEulerAngles(x[i], y[i], z[i]);
+        }
+        else
+            UCAPA_RUN_KERNEL(eulerKernel, n, x, y, z, quaternions);
+    }
+}
@@ -0,0 +1,234 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <framepool.h>
+
+#include <utility>
+
+namespace ucapa{
+    FrameHandle::FrameHandle(const FrameHandle& other)
+        : m_pool(other.m_pool)
+        , m_buffer(other.m_buffer)
+    {
+        if (m_buffer)
+            m_buffer->nbReaders++;
+    }
+
+    FrameHandle::FrameHandle(FrameHandle&& other)
+        : m_pool(std::move(other.m_pool))
+        , m_buffer(other.m_buffer)
+    {
+        other.m_buffer = nullptr;
+    }
+
+    FrameHandle::~FrameHandle()
+    {
+        reset();
+    }
+
+    FrameHandle& FrameHandle::operator=(FrameHandle other)
+    {
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_buffer, other.m_buffer);
+        return *this;
+    }
+
+    void FrameHandle::reset()
+    {
+        // The writer only checks the counter under the lock of the pool, a decrement never needs it
+        if (m_buffer)
+            m_buffer->nbReaders--;
+        m_buffer = nullptr;
+        m_pool.reset();
+    }
+
+    const uint8_t* FrameHandle::getData(FORMAT format) const
+    {
+        if (!m_buffer)
+            return nullptr;
+        if (format == FORMAT_YUV420P || format == FORMAT_GRAY8)
+            return m_buffer->planes[0];
+
+        return m_pool->convert(m_buffer, format);
+    }
+
+    int FrameHandle::getStride(FORMAT format) const
+    {
+        if (!m_buffer)
+            return 0;
+        if (format == FORMAT_YUV420P || format == FORMAT_GRAY8)
+            return m_buffer->strides[0];
+
+        return m_pool->getStride(format);
+    }
+
+    int FrameHandle::getWidth() const
+    {
+        return m_pool ? m_pool->getWidth() : 0;
+    }
+
+    int FrameHandle::getHeight() const
+    {
+        return m_pool ? m_pool->getHeight() : 0;
+    }
+
+    const FrameHandle::Image* FrameHandle::getOutput(int id) const
+    {
+        if (!m_buffer)
+            return nullptr;
+
+        for (std::size_t i=0; i<m_buffer->outputs.size(); ++i)
+        {
+            if (m_buffer->outputs[i].id == id)
+                return &m_buffer->outputs[i];
+        }
+        return nullptr;
+    }
+
+    int FrameHandle::getBytesPerPixel(FORMAT format)
+    {
+        switch (format)
+        {
+        case FORMAT_RGB24:
+            return 3;
+        case FORMAT_BGRA:
+        case FORMAT_RGBA:
+            return 4;
+        case FORMAT_GRAY8:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+
+    FramePool::FramePool(int width, int height, Converter converter, int nbBuffers)
+        : m_width(width)
+        , m_height(height)
+        , m_converter(converter)
+        , m_buffers(nbBuffers < 3 ? 3 : nbBuffers)
+        , m_latest(nullptr)
+        , m_nbPublished(0)
+        , m_nbDropped(0)
+        , m_nbConversions(0)
+    {
+        for (std::size_t i=0; i<m_buffers.size(); ++i)
+        {
+            FrameHandle::Buffer& buffer = m_buffers[i];
+            for (int plane=0; plane<3; ++plane)
+            {
+                buffer.planes[plane] = nullptr;
+                buffer.strides[plane] = 0;
+            }
+            buffer.sequenceNumber = 0;
+            buffer.nbReaders = 0;
+            for (int format=0; format<FrameHandle::NB_FORMATS; ++format)
+            {
+                buffer.converted[format] = false;
+                buffer.images[format] = nullptr;
+            }
+        }
+    }
+
+    FramePool::~FramePool()
+    {
+    }
+
+    FrameHandle::Buffer* FramePool::acquire()
+    {
+        FrameHandle::Buffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::size_t i=0; i<m_buffers.size() && !buffer; ++i)
+            {
+                if (&m_buffers[i] != m_latest && m_buffers[i].nbReaders == 0)
+                    buffer = &m_buffers[i];
+            }
+        }
+        if (!buffer)
+        {
+            m_nbDropped++;
+            return nullptr;
+        }
+
+        // Nobody can read the buffer until it is published again
+        buffer->owner.reset();
+        for (int format=0; format<FrameHandle::NB_FORMATS; ++format)
+            buffer->converted[format] = false;
+        // The writer produces the outputs again, their memory is kept
+        for (std::size_t i=0; i<buffer->outputs.size(); ++i)
+            buffer->outputs[i].id = -1;
+        return buffer;
+    }
+    void FramePool::publish(FrameHandle::Buffer* buffer, std::chrono::steady_clock::time_point timestamp)
+    {
+        if (buffer == nullptr)
+            return;
+
+        buffer->timestamp = timestamp;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->sequenceNumber = ++m_nbPublished;
+        m_latest = buffer;
+    }
+
+    FrameHandle FramePool::getLatest() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_latest == nullptr)
+            return FrameHandle();
+
+        // Incremented under the lock, so the writer can't acquire the buffer in the meantime
+        m_latest->nbReaders++;
+        return FrameHandle(shared_from_this(), m_latest);
+    }
+
+    const uint8_t* FramePool::convert(FrameHandle::Buffer* buffer, FrameHandle::FORMAT format) const
+    {
+        // The readers of the same frame wait for the first conversion, instead of doing it again
+        std::lock_guard<std::mutex> lock(buffer->conversionMutex);
+        if (buffer->converted[format])
+            return buffer->images[format];
+
+        const int stride = getStride(format);
+        if (!buffer->images[format])
+        {
+            buffer->memory[format].resize((std::size_t)stride * m_height + 32);
+            buffer->images[format] = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(buffer->memory[format].data()) + 31) & ~(uintptr_t)31);
+        }
+
+        if (!m_converter || !m_converter(*buffer, format, buffer->images[format], stride))
+            return nullptr;
+
+        m_nbConversions++;
+        buffer->converted[format] = true;
+        return buffer->images[format];
+    }
+
+    uint64_t FramePool::getNbPublished() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_nbPublished;
+    }
+}
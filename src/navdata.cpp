@@ -24,18 +24,34 @@
 
 #include <navdata.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include <fastmath.h>
+
 namespace ucapa{
     Navdata::Navdata()
         : m_computeWorldData(false)
         , m_needToResetRotation(false)
+        , m_navdataDeltaTime(0)
+        , m_hasSampleTime(false)
+        , m_hasDroneTime(false)
+        , m_droneTime(0)
         , m_state(0)
         , m_sequenceNumber(0)
         , m_vision(0)
         , m_batteryLvl(-1)
         , m_altitude(0)
+        , m_estimatePose(false)
     {
         m_navCallbackFunc[NAVDATA_DEMO_TAG]
                 = std::function<void(const char*)>(std::bind(&Navdata::navdataDemo, this, std::placeholders::_1));
+        m_navCallbackFunc[NAVDATA_PHYS_MEASURES_TAG]
+                = std::function<void(const char*)>(std::bind(&Navdata::navdataPhysMeasures, this, std::placeholders::_1));
+        m_navCallbackFunc[NAVDATA_MAGNETO_TAG]
+                = std::function<void(const char*)>(std::bind(&Navdata::navdataMagneto, this, std::placeholders::_1));
+        m_navCallbackFunc[NAVDATA_PRESSURE_RAW_TAG]
+                = std::function<void(const char*)>(std::bind(&Navdata::navdataPressureRaw, this, std::placeholders::_1));
     }
 
 
@@ -79,42 +95,181 @@ namespace ucapa{
         m_localVelocity.x = *(++f);
         m_localVelocity.y = *(++f);
         m_localVelocity /= 1000.0f;
-        if (m_localVelocity.y == 0) {// If it is a buggy version of the drone firmware
+        if (m_localVelocity.y == 0 && m_navdataDeltaTime.count() > 0) {// If it is a buggy version of the drone firmware
             m_localVelocity.y = (m_altitude - previousAltitude)/m_navdataDeltaTime.count();
         }
 
+        m_poseMeasurements.hasAttitude = true;
+        m_poseMeasurements.roll = m_rotation.z;
+        m_poseMeasurements.pitch = m_rotation.y;
+        if (!m_poseMeasurements.hasHeading) { // The magnetometer heading is preferred
+            m_poseMeasurements.hasHeading = true;
+            m_poseMeasurements.heading = -m_rotation.x;
+        }
+        m_poseMeasurements.hasVelocity = true;
+        m_poseMeasurements.velocity[0] = m_localVelocity.z;
+        m_poseMeasurements.velocity[1] = m_localVelocity.x;
+        m_poseMeasurements.hasAltitude = true;
+        m_poseMeasurements.altitude = m_altitude;
+
         if (m_computeWorldData)
         {
             // Calculate world velocity
             Vector3 rot = m_rotation;
             rot.x = rot.x - m_startingRotation.x;
             rot = rot*(PI/180.0f);
-            Quaternion q(rot.z, rot.x, rot.y);
-            Matrix<float> T(q.getMatrix());
-            Matrix<float> tT(T.transponate());
-            m_worldVelocity = tT * m_localVelocity;
+            // The drone frame to world frame rotation is the inverse of the attitude.
+            // The angles are sent in millidegrees, far coarser than the error of the approximation.
+            const Quaternion q(FastMath::eulerToQuaternion(rot.z, rot.x, rot.y, FastMath::APPROXIMATE));
+            m_worldVelocity = q.conjugate().rotate(m_localVelocity);
 
             // Update position
-            m_worldPosition.x += m_worldVelocity.x * m_navdataDeltaTime.count();
-            m_worldPosition.y += m_worldVelocity.y * m_navdataDeltaTime.count();
-            m_worldPosition.z += m_worldVelocity.z * m_navdataDeltaTime.count();
+            m_positionIntegrator.addSample(std::chrono::duration<double>(m_sampleTime.time_since_epoch()).count(),
+                                           m_worldVelocity);
+            m_worldPosition = m_positionIntegrator.getPosition();
+        }
+    }
+
+    void Navdata::navdataPhysMeasures(const char *buffer)
+    {
+        // The option is packed: accelerometers start at byte 10 and gyroscopes at byte 22
+        if (*((unsigned short*)(buffer + 2)) < 34)
+            return;
+
+        std::memcpy(m_poseMeasurements.accelerometers, buffer + 10, 3*sizeof(float));
+        std::memcpy(m_poseMeasurements.gyroscopes, buffer + 22, 3*sizeof(float));
+        m_poseMeasurements.hasImu = true;
+    }
+
+    void Navdata::navdataMagneto(const char *buffer)
+    {
+        // Heading computed from the magnetometer only (heading_unwrapped)
+        if (*((unsigned short*)(buffer + 2)) < 50)
+            return;
+
+        std::memcpy(&m_poseMeasurements.heading, buffer + 46, sizeof(float));
+        m_poseMeasurements.hasHeading = true;
+    }
+
+    void Navdata::navdataPressureRaw(const char *buffer)
+    {
+        // The option is packed: the compensated pressure, in Pa, is at byte 14
+        if (*((unsigned short*)(buffer + 2)) < 18)
+            return;
+
+        int pressure;
+        std::memcpy(&pressure, buffer + 14, sizeof(int));
+        m_poseMeasurements.pressure = (float)pressure;
+        m_poseMeasurements.hasPressure = true;
+    }
+
+
+    const char* Navdata::findOption(const std::string& navdata, NAVDATA_TAG tag)
+    {
+        const char* navdataBuffer = navdata.c_str();
+
+        if (navdata.size() < 16 || *((int*)navdataBuffer) != 0x55667788)
+            return nullptr;
+
+        unsigned int index = 16;
+        unsigned short optionTag, size;
+
+        while(index + 4 <= navdata.size())
+        {
+            optionTag = *((unsigned short*)(navdataBuffer + index));
+            size = *((unsigned short*)(navdataBuffer + index + 2));
+
+            if (optionTag == tag)
+                return (index + size <= navdata.size()) ? navdataBuffer + index : nullptr;
+            if (size < 4)
+                break;
+
+            index += size;
+        }
+        return nullptr;
+    }
+
+    double Navdata::unwrapDroneTime(unsigned int raw)
+    {
+        const double period = 2048.0;
+        double seconds = (raw >> 21) + (raw & 0x1FFFFF) / 1000000.0;
+
+        if (!m_hasDroneTime)
+        {
+            m_hasDroneTime = true;
+            m_droneTime = seconds;
+            return m_droneTime;
         }
+
+        double previous = std::fmod(m_droneTime, period);
+        double elapsed = seconds - previous;
+        if (elapsed < -period/2)
+            elapsed += period;
+
+        m_droneTime += elapsed;
+        return m_droneTime;
     }
 
+    void Navdata::update(const std::string& navdata, std::chrono::steady_clock::time_point receptionTime)
+    {
+        m_mutex.lock();
+
+        if (m_recorder)
+            m_recorder->write(std::chrono::duration_cast<std::chrono::nanoseconds>(receptionTime.time_since_epoch()).count(), navdata);
+
+        std::chrono::steady_clock::time_point sampleTime = receptionTime;
+
+        const char* timeOption = findOption(navdata, NAVDATA_TIME_TAG);
+        if (timeOption != nullptr && *((unsigned short*)(timeOption + 2)) >= 8)
+        {
+            unsigned int raw = *((unsigned int*)(timeOption + 4));
+            double droneTime = unwrapDroneTime(raw);
+            m_clockSync.addSample(droneTime, receptionTime);
+            sampleTime = m_clockSync.toHostTime(droneTime);
+        }
+
+        // A late packet must not make the time go backward
+        if (!m_hasSampleTime)
+            m_navdataDeltaTime = std::chrono::duration<float>(0);
+        else if (sampleTime > m_sampleTime)
+            m_navdataDeltaTime = sampleTime - m_sampleTime;
+        else
+        {
+            m_navdataDeltaTime = std::chrono::duration<float>(0);
+            sampleTime = m_sampleTime;
+        }
+        m_sampleTime = sampleTime;
+        m_hasSampleTime = true;
+
+        parse(navdata);
+
+        unlockAndNotify();
+    }
 
     void Navdata::update(const std::string& navdata, std::chrono::duration<double> deltaTime)
     {
         m_mutex.lock();
 
         m_navdataDeltaTime = deltaTime;
+        m_sampleTime = m_hasSampleTime
+                ? m_sampleTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(deltaTime)
+                : std::chrono::steady_clock::now();
+        m_hasSampleTime = true;
+
+        parse(navdata);
+
+        unlockAndNotify();
+    }
 
+    void Navdata::parse(const std::string& navdata)
+    {
         const char* navdataBuffer = navdata.c_str();
 
         // Retrieve of the navdatas
         int* i = (int*) navdataBuffer;
         int searchValue = 0x55667788;
 
-        if (*i == searchValue)
+        if (navdata.size() >= 16 && *i == searchValue)
         {
             i++;
             // Retrieve the drone's states
@@ -131,7 +286,7 @@ namespace ucapa{
 
             unsigned short tag, size;
 
-            while(index < navdata.size())
+            while(index + 4 <= navdata.size())
             {
                 // Retrieve the tag of the option
                 tag = *((unsigned short*)(navdataBuffer + index)); index += 2;
@@ -140,24 +295,60 @@ namespace ucapa{
                 // Return to intial position
                 index-=4;
 
+                // A malformed option would make us loop forever or read outside of the packet
+                if (size < 4 || index + size > navdata.size())
+                    break;
+
                 NavCallbackFuncs::iterator it = m_navCallbackFunc.find((NAVDATA_TAG)tag);
                 if (it != m_navCallbackFunc.end())
                     (it->second)(navdataBuffer+index);
 
                 index+=size;
             }
+
+            if (m_estimatePose)
+                m_poseEstimator.update(m_navdataDeltaTime.count(), m_poseMeasurements);
+            m_poseMeasurements.clear();
+
+            if (m_publisher || !m_aggregators.empty())
+            {
+                NavdataSnapshot snapshot;
+                fillSnapshot(snapshot);
+                if (m_publisher)
+                    m_publisher->publish(snapshot);
+                TelemetryAggregator::Summary finished;
+                for (std::size_t k=0; k<m_aggregators.size(); ++k)
+                {
+                    if (m_aggregators[k]->addSample(snapshot, finished))
+                        m_finishedSummaries.push_back(std::make_pair(m_aggregators[k], finished));
+                }
+            }
         }
+    }
+
 
+    void Navdata::unlockAndNotify()
+    {
+        // The callbacks may call the getters, which lock the mutex
+        std::vector<std::pair<std::shared_ptr<TelemetryAggregator>, TelemetryAggregator::Summary> > finished;
+        finished.swap(m_finishedSummaries);
         m_mutex.unlock();
-    }
 
+        for (std::size_t k=0; k<finished.size(); ++k)
+            finished[k].first->notify(finished[k].second);
+    }
 
     void Navdata::setComputeWorldData(bool activate)
     {
         if (getState() & STATE_MASK::FLY_MASK)
             return;
 
+        m_mutex.lock();
+        // The last samples are too old to be integrated with the next ones
+        if (activate && !m_computeWorldData)
+            m_positionIntegrator.reset(m_positionIntegrator.getPrecisePosition());
         m_computeWorldData = activate;
+        m_mutex.unlock();
     }
 
     void Navdata::resetWorldData()
@@ -171,11 +362,148 @@ namespace ucapa{
         m_mutex.lock();
         m_needToResetRotation = true;
         m_worldPosition = Vector3();
+        m_positionIntegrator.setPosition(m_worldPosition);
         m_startingRotation.x = m_rotation.x;
+        m_poseEstimator.resetOrigin();
+        m_mutex.unlock();
+    }
+
+    PositionIntegrator::METHOD Navdata::getPositionIntegration() const
+    {
+        m_mutex.lock();
+        PositionIntegrator::METHOD method = m_positionIntegrator.getMethod();
+        m_mutex.unlock();
+
+        return method;
+    }
+
+    void Navdata::setPositionIntegration(PositionIntegrator::METHOD method)
+    {
+        m_mutex.lock();
+        m_positionIntegrator.setMethod(method);
+        m_mutex.unlock();
+    }
+
+    bool Navdata::isPositionDoublePrecision() const
+    {
+        m_mutex.lock();
+        bool activated = m_positionIntegrator.isDoublePrecision();
+        m_mutex.unlock();
+
+        return activated;
+    }
+
+    void Navdata::setPositionDoublePrecision(bool activate)
+    {
+        m_mutex.lock();
+        m_positionIntegrator.setDoublePrecision(activate);
+        m_mutex.unlock();
+    }
+
+    void Navdata::setEstimatePose(bool activate)
+    {
+        m_mutex.lock();
+        if (activate && !m_estimatePose)
+            m_poseEstimator.reset();
+        m_estimatePose = activate;
         m_mutex.unlock();
     }
 
 
+    void Navdata::setPublisher(std::shared_ptr<NavdataShmPublisher> publisher)
+    {
+        m_mutex.lock();
+        m_publisher = publisher;
+        m_mutex.unlock();
+    }
+
+    void Navdata::setRecorder(std::shared_ptr<NavdataLogWriter> recorder)
+    {
+        m_mutex.lock();
+        m_recorder = recorder;
+        m_mutex.unlock();
+    }
+
+    void Navdata::addAggregator(std::shared_ptr<TelemetryAggregator> aggregator)
+    {
+        if (!aggregator)
+            return;
+
+        m_mutex.lock();
+        m_aggregators.push_back(aggregator);
+        m_mutex.unlock();
+    }
+
+    void Navdata::removeAggregator(std::shared_ptr<TelemetryAggregator> aggregator)
+    {
+        m_mutex.lock();
+        m_aggregators.erase(std::remove(m_aggregators.begin(), m_aggregators.end(), aggregator), m_aggregators.end());
+        m_mutex.unlock();
+    }
+
+    void Navdata::fillSnapshot(NavdataSnapshot& snapshot) const
+    {
+        snapshot.index = 0;
+        snapshot.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    m_sampleTime.time_since_epoch()).count();
+        snapshot.state = m_state;
+        snapshot.sequenceNumber = m_sequenceNumber;
+        snapshot.vision = m_vision;
+        snapshot.batteryLvl = m_batteryLvl;
+        snapshot.altitude = m_altitude;
+
+        const Vector3* vectors[4] = {&m_rotation, &m_localVelocity, &m_worldVelocity, &m_worldPosition};
+        float* dest[4] = {snapshot.rotation, snapshot.localVelocity, snapshot.worldVelocity, snapshot.worldPosition};
+        for (int i=0; i<4; ++i)
+        {
+            dest[i][0] = vectors[i]->x;
+            dest[i][1] = vectors[i]->y;
+            dest[i][2] = vectors[i]->z;
+        }
+        snapshot.rotation[0] -= m_startingRotation.x;
+    }
+
+    NavdataSnapshot Navdata::getSnapshot() const
+    {
+        NavdataSnapshot snapshot;
+        m_mutex.lock();
+        fillSnapshot(snapshot);
+        m_mutex.unlock();
+
+        return snapshot;
+    }
+
+
+    std::chrono::steady_clock::time_point Navdata::getTimestamp() const
+    {
+        m_mutex.lock();
+        std::chrono::steady_clock::time_point t = m_sampleTime;
+        m_mutex.unlock();
+
+        return t;
+    }
+
+    double Navdata::getDroneTime() const
+    {
+        m_mutex.lock();
+        double t = m_hasDroneTime ? m_droneTime : -1.0;
+        m_mutex.unlock();
+
+        return t;
+    }
+
+    std::chrono::steady_clock::time_point Navdata::droneTimeToHost(double droneTime) const
+    {
+        m_mutex.lock();
+        std::chrono::steady_clock::time_point t = m_clockSync.isSynchronized()
+                ? m_clockSync.toHostTime(droneTime)
+                : std::chrono::steady_clock::now();
+        m_mutex.unlock();
+
+        return t;
+    }
+
+
     Vector3 Navdata::getRotation() const
     {
         m_mutex.lock();
@@ -217,4 +545,60 @@ namespace ucapa{
 
         return pos;
     }
+
+    Vector3d Navdata::getPrecisePosition() const
+    {
+        m_mutex.lock();
+        Vector3d pos = m_positionIntegrator.getPrecisePosition();
+        m_mutex.unlock();
+
+        return pos;
+    }
+
+    Vector3 Navdata::getPosition(std::chrono::steady_clock::time_point time) const
+    {
+        m_mutex.lock();
+        Vector3 pos = m_computeWorldData
+                ? m_positionIntegrator.getPosition(std::chrono::duration<double>(time.time_since_epoch()).count())
+                : m_worldPosition;
+        m_mutex.unlock();
+
+        return pos;
+    }
+
+    Vector3 Navdata::getEstimatedPosition() const
+    {
+        m_mutex.lock();
+        Vector3 pos = m_poseEstimator.getPosition();
+        m_mutex.unlock();
+
+        return pos;
+    }
+
+    Vector3 Navdata::getEstimatedVelocity() const
+    {
+        m_mutex.lock();
+        Vector3 vel = m_poseEstimator.getVelocity();
+        m_mutex.unlock();
+
+        return vel;
+    }
+
+    Vector3 Navdata::getEstimatedRotation() const
+    {
+        m_mutex.lock();
+        Vector3 rot = m_poseEstimator.getRotation();
+        m_mutex.unlock();
+
+        return rot;
+    }
+
+    PoseEstimator::Covariance Navdata::getEstimatedPoseCovariance() const
+    {
+        m_mutex.lock();
+        PoseEstimator::Covariance covariance = m_poseEstimator.getCovariance();
+        m_mutex.unlock();
+
+        return covariance;
+    }
 }
@@ -0,0 +1,639 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <navdatalog.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace ucapa{
+    namespace {
+        const char LOG_MAGIC[4] = {'U', 'C', 'N', 'L'};
+        const unsigned char LOG_VERSION = 2;
+
+        enum RECORD_TYPE {
+            KEYFRAME_RECORD = 0,
+            DELTA_RECORD = 1
+        };
+
+        enum OPTION_MODE {
+            OPTION_UNCHANGED = 0, ///< Same bytes as the option of the previous packet
+            OPTION_DELTA = 1,     ///< Words stored as differences with the option of the previous packet
+            OPTION_RAW = 2,       ///< Bytes stored as-is
+            OPTION_SHIFTED_DELTA = 3 ///< Like OPTION_DELTA, with words starting after the first 16 bits (since version 2)
+        };
+
+        const std::size_t SHIFTED_OFFSET = 2;
+
+        const int NB_OPTION_SLOTS = 33; // Tags 0 to 31, and the checksum tag
+
+        // Position of an option in a packet
+        struct OptionRef
+        {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        int optionSlot(unsigned int tag)
+        {
+            if (tag < 32)
+                return tag;
+            if (tag == 0xFFFF)
+                return 32;
+            return -1;
+        }
+
+        uint32_t readWord(const char* p)
+        {
+            uint32_t w;
+            std::memcpy(&w, p, 4);
+            return w;
+        }
+
+        uint16_t readShort(const char* p)
+        {
+            uint16_t s;
+            std::memcpy(&s, p, 2);
+            return s;
+        }
+
+        uint64_t zigzag(int64_t v)
+        {
+            return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+        }
+
+        int64_t unzigzag(uint64_t v)
+        {
+            return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+        }
+
+        void putVarint(std::string& out, uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                out.push_back((char)(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back((char)v);
+        }
+
+        bool getVarint(const char*& p, const char* end, uint64_t& v)
+        {
+            v = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7)
+            {
+                unsigned char byte = (unsigned char)*p++;
+                v |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        // Find the options of a packet, return false if the packet is not a well formed navdata packet
+        bool indexOptions(const std::string& packet, OptionRef refs[NB_OPTION_SLOTS])
+        {
+            for (int i=0; i<NB_OPTION_SLOTS; ++i)
+                refs[i].size = 0;
+
+            if (packet.size() < 16 || readWord(packet.data()) != 0x55667788)
+                return false;
+
+            std::size_t index = 16;
+            while (index < packet.size())
+            {
+                if (index + 4 > packet.size())
+                    return false;
+                unsigned int tag = readShort(packet.data() + index);
+                unsigned int size = readShort(packet.data() + index + 2);
+                if (size < 4 || index + size > packet.size())
+                    return false;
+
+                int slot = optionSlot(tag);
+                if (slot >= 0 && refs[slot].size == 0)
+                {
+                    refs[slot].offset = index;
+                    refs[slot].size = size;
+                }
+                index += size;
+            }
+            return true;
+        }
+
+        const int MAX_OPTIONS = 64;
+
+        // Option of the packet being encoded or decoded
+        struct OptionDesc
+        {
+            std::size_t offset;
+            unsigned int tag;
+            unsigned int size;
+            unsigned int mode;
+        };
+
+        // List the options of a packet, return false if the packet is not a well formed navdata packet
+        bool listOptions(const std::string& packet, OptionDesc options[MAX_OPTIONS], int& nbOptions)
+        {
+            nbOptions = 0;
+            if (packet.size() < 16 || readWord(packet.data()) != 0x55667788)
+                return false;
+
+            std::size_t index = 16;
+            while (index < packet.size())
+            {
+                if (index + 4 > packet.size() || nbOptions == MAX_OPTIONS)
+                    return false;
+                unsigned int size = readShort(packet.data() + index + 2);
+                if (size < 4 || index + size > packet.size())
+                    return false;
+
+                options[nbOptions].offset = index;
+                options[nbOptions].tag = readShort(packet.data() + index);
+                options[nbOptions].size = size;
+                nbOptions++;
+                index += size;
+            }
+            return true;
+        }
+
+        // Check if two well formed packets have the same options, at the same places
+        bool sameLayout(const std::string& a, const std::string& b)
+        {
+            if (a.size() != b.size())
+                return false;
+
+            std::size_t index = 16;
+            while (index + 4 <= a.size())
+            {
+                if (std::memcmp(a.data() + index, b.data() + index, 4) != 0)
+                    return false;
+                unsigned int size = readShort(a.data() + index + 2);
+                if (size < 4)
+                    return false;
+                index += size;
+            }
+            return index == a.size();
+        }
+
+        // Number of trailing zero bits of a non-zero word
+        int trailingZeros(uint32_t w)
+        {
+#if defined(__GNUC__)
+            return __builtin_ctz(w);
+#else
+            int n = 0;
+            for (; !(w & 1); w >>= 1)
+                n++;
+            return n;
+#endif
+        }
+
+        // Range of bytes of the word i of a field. With an offset of 2, the first 2 bytes form a word alone, so that the
+        // fields following a 16 bits field are read whole. The last word can be shorter than 4 bytes.
+        void wordRange(std::size_t i, std::size_t size, std::size_t offset, std::size_t& begin, std::size_t& length)
+        {
+            if (offset && i == 0)
+            {
+                begin = 0;
+                length = offset;
+                return;
+            }
+            begin = offset + 4*(offset ? i-1 : i);
+            length = std::min<std::size_t>(4, size - begin);
+        }
+
+        std::size_t countWords(std::size_t size, std::size_t offset)
+        {
+            return (offset ? 1 : 0) + (size - offset + 3) / 4;
+        }
+
+        uint32_t loadWord(const char* p, std::size_t length)
+        {
+            if (length == 4)
+                return readWord(p);
+            uint32_t w = 0;
+            std::memcpy(&w, p, length);
+            return w;
+        }
+
+        // Store the changes of the words of a field, with one varint token each:
+        // - low bit 0: run of unchanged words;
+        // - low bits 01: zig-zag difference, small for integer counters and measures;
+        // - low bits 11: XOR without its trailing zeros (count on 5 bits), small for floats, whose
+        //   close values share the sign, the exponent and the high mantissa bits, and whose
+        //   quantized values end with zeros.
+        // Version 1 logs only have runs and differences, marked by a low bit 1, and whole words.
+        void putWordDeltas(std::string& out, const char* current, const char* previous, std::size_t size, std::size_t offset = 0)
+        {
+            uint64_t run = 0;
+            const std::size_t nbWords = countWords(size, offset);
+            for (std::size_t i=0; i<nbWords; ++i)
+            {
+                std::size_t begin, length;
+                wordRange(i, size, offset, begin, length);
+                uint32_t word = loadWord(current + begin, length);
+                uint32_t reference = loadWord(previous + begin, length);
+                if (word == reference)
+                {
+                    run++;
+                    continue;
+                }
+                if (run)
+                {
+                    putVarint(out, run << 1);
+                    run = 0;
+                }
+
+                uint64_t delta = zigzag((int32_t)(word - reference));
+                uint32_t x = word ^ reference;
+                int shift = trailingZeros(x);
+                uint64_t packed = ((uint64_t)(x >> shift) << 5) | shift;
+                putVarint(out, packed < delta ? (packed << 2) | 3 : (delta << 2) | 1);
+            }
+            if (run)
+                putVarint(out, run << 1);
+        }
+
+        bool getWordDeltas(const char*& p, const char* end, char* current, const char* previous, std::size_t size,
+                           std::size_t offset, unsigned int version)
+        {
+            const std::size_t nbWords = countWords(size, offset);
+            std::size_t i = 0;
+            while (i < nbWords)
+            {
+                uint64_t token;
+                if (!getVarint(p, end, token))
+                    return false;
+
+                std::size_t begin, length;
+                wordRange(i, size, offset, begin, length);
+                if (token & 1)
+                {
+                    uint32_t reference = loadWord(previous + begin, length);
+                    uint32_t word;
+                    if (version < 2)
+                        word = reference + (uint32_t)unzigzag(token >> 1);
+                    else if (token & 2)
+                    {
+                        uint64_t packed = token >> 2;
+                        unsigned int shift = packed & 31;
+                        if ((packed >> 5) > (0xFFFFFFFFu >> shift))
+                            return false;
+                        word = reference ^ ((uint32_t)(packed >> 5) << shift);
+                    }
+                    else
+                        word = reference + (uint32_t)unzigzag(token >> 2);
+                    std::memcpy(current + begin, &word, length);
+                    i++;
+                }
+                else
+                {
+                    uint64_t run = token >> 1;
+                    if (run == 0 || run > nbWords - i)
+                        return false;
+                    std::size_t last, lastLength;
+                    wordRange(i + run - 1, size, offset, last, lastLength);
+                    std::memcpy(current + begin, previous + begin, last + lastLength - begin);
+                    i += run;
+                }
+            }
+            return true;
+        }
+    }
+
+
+
+    NavdataLogWriter::NavdataLogWriter(std::ostream& stream, unsigned int keyframeInterval)
+        : m_stream(stream)
+        , m_keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1)
+        , m_nbRecords(0)
+        , m_previousTimestamp(0)
+        , m_previousDelta(0)
+    {
+        std::string header(LOG_MAGIC, 4);
+        header.push_back((char)LOG_VERSION);
+        putVarint(header, m_keyframeInterval);
+        m_stream.write(header.data(), header.size());
+    }
+
+    void NavdataLogWriter::write(int64_t timestamp, const std::string& packet)
+    {
+        OptionRef previousRefs[NB_OPTION_SLOTS];
+        OptionDesc options[MAX_OPTIONS];
+        int nbOptions = 0;
+
+        bool keyframe = (m_nbRecords % m_keyframeInterval == 0)
+                || !indexOptions(m_previousPacket, previousRefs)
+                || !listOptions(packet, options, nbOptions);
+
+        int64_t delta = timestamp - m_previousTimestamp;
+        m_buffer.clear();
+
+        if (!keyframe)
+        {
+            m_buffer.push_back((char)DELTA_RECORD);
+            putVarint(m_buffer, zigzag(delta - m_previousDelta));
+            putVarint(m_buffer, packet.size());
+            putWordDeltas(m_buffer, packet.data(), m_previousPacket.data(), 16);
+
+            // Most of the time, the drone sends the same options, so their headers are not repeated
+            bool layout = sameLayout(packet, m_previousPacket);
+            m_buffer.push_back(layout ? 1 : 0);
+            if (!layout)
+            {
+                putVarint(m_buffer, nbOptions);
+                for (int i=0; i<nbOptions; ++i)
+                {
+                    putVarint(m_buffer, options[i].tag);
+                    putVarint(m_buffer, options[i].size);
+                }
+            }
+
+            // Choose the mode of each option, and store them on 2 bits before the option data
+            m_payload.clear();
+            for (int i=0; i<nbOptions; ++i)
+            {
+                OptionDesc& option = options[i];
+                const char* data = packet.data() + option.offset + 4;
+                const std::size_t dataSize = option.size - 4;
+                int slot = optionSlot(option.tag);
+                option.mode = OPTION_RAW;
+                if (slot >= 0 && previousRefs[slot].size == option.size)
+                {
+                    const char* reference = m_previousPacket.data() + previousRefs[slot].offset + 4;
+                    if (std::memcmp(data, reference, dataSize) == 0)
+                    {
+                        option.mode = OPTION_UNCHANGED;
+                        continue;
+                    }
+
+                    // The options are packed structures, so their fields are not always aligned on 4 bytes
+                    option.mode = OPTION_DELTA;
+                    std::size_t start = m_payload.size();
+                    putWordDeltas(m_payload, data, reference, dataSize);
+                    if (dataSize > SHIFTED_OFFSET)
+                    {
+                        m_shifted.clear();
+                        putWordDeltas(m_shifted, data, reference, dataSize, SHIFTED_OFFSET);
+                        if (m_shifted.size() < m_payload.size() - start)
+                        {
+                            option.mode = OPTION_SHIFTED_DELTA;
+                            m_payload.resize(start);
+                            m_payload.append(m_shifted);
+                        }
+                    }
+                }
+                else
+                    m_payload.append(data, dataSize);
+            }
+            for (int i=0; i<nbOptions; i+=4)
+            {
+                unsigned char modes = 0;
+                for (int j=0; j<4 && i+j<nbOptions; ++j)
+                    modes |= options[i+j].mode << (2*j);
+                m_buffer.push_back((char)modes);
+            }
+            m_buffer.append(m_payload);
+        }
+        else
+        {
+            m_buffer.push_back((char)KEYFRAME_RECORD);
+            putVarint(m_buffer, zigzag(timestamp));
+            m_buffer.append(packet);
+            delta = 0;
+        }
+
+        std::string length;
+        putVarint(length, m_buffer.size());
+        m_stream.write(length.data(), length.size());
+        m_stream.write(m_buffer.data(), m_buffer.size());
+
+        m_previousTimestamp = timestamp;
+        m_previousDelta = delta;
+        m_previousPacket = packet;
+        m_nbRecords++;
+    }
+
+
+
+    NavdataLogReader::NavdataLogReader()
+        : m_version(0)
+        , m_nextRecord(0)
+        , m_currentDelta(0)
+    {
+        m_current.timestamp = 0;
+    }
+
+    bool NavdataLogReader::open(const std::string& data)
+    {
+        m_data = data;
+        m_offsets.clear();
+        m_sizes.clear();
+        m_keyframes.clear();
+        m_nextRecord = 0;
+        m_current.timestamp = 0;
+        m_current.packet.clear();
+        m_currentDelta = 0;
+
+        if (m_data.size() < 5 || std::memcmp(m_data.data(), LOG_MAGIC, 4) != 0 || (unsigned char)m_data[4] == 0 || (unsigned char)m_data[4] > LOG_VERSION)
+            return false;
+        m_version = (unsigned char)m_data[4];
+
+        const char* p = m_data.data() + 5;
+        const char* end = m_data.data() + m_data.size();
+        uint64_t value;
+        if (!getVarint(p, end, value))
+            return false;
+
+        while (p < end)
+        {
+            if (!getVarint(p, end, value) || value == 0 || value > (uint64_t)(end - p))
+                break; // Truncated record
+
+            if (*p == KEYFRAME_RECORD)
+                m_keyframes.push_back(m_offsets.size());
+            m_offsets.push_back(p - m_data.data());
+            m_sizes.push_back((uint32_t)value);
+            p += value;
+        }
+        return true;
+    }
+
+    bool NavdataLogReader::seek(std::size_t index)
+    {
+        if (index > m_offsets.size())
+            return false;
+
+        std::vector<uint32_t>::const_iterator it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), (uint32_t)index);
+        if (it == m_keyframes.begin())
+        {
+            m_nextRecord = index;
+            return index == 0;
+        }
+
+        std::size_t keyframe = *(--it);
+        for (std::size_t i=keyframe; i<index; ++i)
+        {
+            if (!decodeRecord(i))
+                return false;
+        }
+        m_nextRecord = index;
+        return true;
+    }
+
+    bool NavdataLogReader::next(NavdataLogRecord& record)
+    {
+        if (m_nextRecord >= m_offsets.size() || !decodeRecord(m_nextRecord))
+            return false;
+
+        m_nextRecord++;
+        record.timestamp = m_current.timestamp;
+        record.packet.assign(m_current.packet);
+        return true;
+    }
+
+    bool NavdataLogReader::decodeRecord(std::size_t index)
+    {
+        const char* p = m_data.data() + m_offsets[index];
+        const char* end = p + m_sizes[index];
+        char type = *p++;
+        uint64_t value;
+
+        if (type == KEYFRAME_RECORD)
+        {
+            if (!getVarint(p, end, value))
+                return false;
+            m_current.timestamp = unzigzag(value);
+            m_current.packet.assign(p, end);
+            m_currentDelta = 0;
+            return true;
+        }
+
+        if (type != DELTA_RECORD)
+            return false;
+
+        OptionRef previousRefs[NB_OPTION_SLOTS];
+        if (!indexOptions(m_current.packet, previousRefs))
+            return false;
+
+        uint64_t deltaOfDelta, packetSize;
+        if (!getVarint(p, end, deltaOfDelta) || !getVarint(p, end, packetSize) || packetSize < 16)
+            return false;
+
+        // Decode in a separate buffer, the previous packet is the reference
+        m_buffer.resize((std::size_t)packetSize);
+        char* out = &m_buffer[0];
+        if (!getWordDeltas(p, end, out, m_current.packet.data(), 16, 0, m_version) || p >= end)
+            return false;
+
+        // Retrieve the options headers
+        OptionDesc options[MAX_OPTIONS];
+        int nbOptions = 0;
+        bool layout = (*p++ != 0);
+        if (layout)
+        {
+            if (m_current.packet.size() != packetSize || !listOptions(m_current.packet, options, nbOptions))
+                return false;
+        }
+        else
+        {
+            uint64_t n, tag, size;
+            if (!getVarint(p, end, n) || n > (uint64_t)MAX_OPTIONS)
+                return false;
+            nbOptions = (int)n;
+            std::size_t offset = 16;
+            for (int i=0; i<nbOptions; ++i)
+            {
+                if (!getVarint(p, end, tag) || !getVarint(p, end, size) || tag > 0xFFFF || size < 4 || offset + size > packetSize)
+                    return false;
+                options[i].tag = (unsigned int)tag;
+                options[i].size = (unsigned int)size;
+                options[i].offset = offset;
+                offset += size;
+            }
+            if (offset != packetSize)
+                return false;
+        }
+
+        if ((end - p) < (nbOptions + 3) / 4)
+            return false;
+        for (int i=0; i<nbOptions; ++i)
+            options[i].mode = ((unsigned char)p[i/4] >> (2*(i%4))) & 3;
+        p += (nbOptions + 3) / 4;
+
+        for (int i=0; i<nbOptions; ++i)
+        {
+            const OptionDesc& option = options[i];
+            uint16_t tag16 = (uint16_t)option.tag, size16 = (uint16_t)option.size;
+            std::memcpy(out + option.offset, &tag16, 2);
+            std::memcpy(out + option.offset + 2, &size16, 2);
+
+            char* data = out + option.offset + 4;
+            std::size_t dataSize = option.size - 4;
+
+            if (option.mode == OPTION_RAW)
+            {
+                if ((std::size_t)(end - p) < dataSize)
+                    return false;
+                std::memcpy(data, p, dataSize);
+                p += dataSize;
+                continue;
+            }
+
+            int slot = optionSlot(option.tag);
+            if (slot < 0 || previousRefs[slot].size != option.size)
+                return false;
+            const char* reference = m_current.packet.data() + previousRefs[slot].offset + 4;
+
+            if (option.mode == OPTION_UNCHANGED)
+                std::memcpy(data, reference, dataSize);
+            else if (option.mode == OPTION_DELTA && m_version < 2)
+            {
+                std::size_t nbWords = dataSize / 4;
+                std::size_t tail = dataSize % 4;
+                if (!getWordDeltas(p, end, data, reference, 4*nbWords, 0, m_version) || (std::size_t)(end - p) < tail)
+                    return false;
+                std::memcpy(data + 4*nbWords, p, tail);
+                p += tail;
+            }
+            else if (option.mode == OPTION_DELTA)
+            {
+                if (!getWordDeltas(p, end, data, reference, dataSize, 0, m_version))
+                    return false;
+            }
+            else if (option.mode == OPTION_SHIFTED_DELTA && m_version >= 2 && dataSize > SHIFTED_OFFSET)
+            {
+                if (!getWordDeltas(p, end, data, reference, dataSize, SHIFTED_OFFSET, m_version))
+                    return false;
+            }
+            else
+                return false;
+        }
+
+        m_currentDelta += unzigzag(deltaOfDelta);
+        m_current.timestamp += m_currentDelta;
+        m_current.packet.swap(m_buffer);
+        return true;
+    }
+}
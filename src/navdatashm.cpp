@@ -0,0 +1,319 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <navdatashm.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#if !defined(_WIN32) && !defined(WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define UCAPA_HAS_POSIX_SHM
+#endif
+
+namespace ucapa{
+    namespace {
+        const uint32_t SHM_MAGIC = 0x55434e44; // "UCND"
+        const uint32_t SHM_VERSION = 1;
+        const int MAX_READ_ATTEMPTS = 64;
+
+        static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                      "Shared memory ring needs lock-free atomics.");
+
+        // Layout of the beginning of the segment
+        struct ShmHeader
+        {
+            std::atomic<uint32_t> magic; // Written last by the publisher
+            uint32_t version;
+            uint32_t nbSlots;
+            uint32_t slotSize;
+            std::atomic<uint64_t> lastIndex; // Index of the last complete snapshot
+        };
+
+        // One element of the ring, the sequence is odd while the slot is written
+        struct ShmSlot
+        {
+            std::atomic<uint32_t> sequence;
+            NavdataSnapshot snapshot;
+        };
+
+        std::size_t segmentSize(uint32_t nbSlots)
+        {
+            return sizeof(ShmHeader) + nbSlots * sizeof(ShmSlot);
+        }
+
+        ShmSlot* slotAt(void* mapping, uint64_t index)
+        {
+            ShmHeader* header = static_cast<ShmHeader*>(mapping);
+            ShmSlot* slots = reinterpret_cast<ShmSlot*>(header + 1);
+            return &slots[(index - 1) % header->nbSlots];
+        }
+    }
+
+
+
+    NavdataShmPublisher::NavdataShmPublisher()
+        : m_fd(-1)
+        , m_size(0)
+        , m_pMapping(nullptr)
+    {
+    }
+
+    NavdataShmPublisher::~NavdataShmPublisher()
+    {
+        close();
+    }
+
+    bool NavdataShmPublisher::open(const std::string& name, unsigned int nbSlots)
+    {
+        close();
+
+#ifdef UCAPA_HAS_POSIX_SHM
+        if (nbSlots == 0)
+            nbSlots = 1;
+
+        // A previous segment is never resized under its readers, they keep it mapped until they reopen
+        shm_unlink(name.c_str());
+        m_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (m_fd < 0)
+        {
+            std::cerr << "Navdata publisher: could not create " << name << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        m_size = segmentSize(nbSlots);
+        if (ftruncate(m_fd, m_size) != 0)
+        {
+            std::cerr << "Navdata publisher: could not resize " << name << ": " << std::strerror(errno) << std::endl;
+            ::close(m_fd);
+            m_fd = -1;
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "Navdata publisher: could not map " << name << ": " << std::strerror(errno) << std::endl;
+            ::close(m_fd);
+            m_fd = -1;
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // The new segment is filled with zeros, so every slot starts with an even sequence
+        ShmHeader* header = new (mapping) ShmHeader;
+        header->version = SHM_VERSION;
+        header->nbSlots = nbSlots;
+        header->slotSize = sizeof(ShmSlot);
+        header->lastIndex.store(0, std::memory_order_relaxed);
+        header->magic.store(SHM_MAGIC, std::memory_order_release);
+
+        m_name = name;
+        m_pMapping = mapping;
+        return true;
+#else
+        (void)name;
+        (void)nbSlots;
+        std::cerr << "Navdata publisher: shared memory is not supported on this platform" << std::endl;
+        return false;
+#endif
+    }
+
+    void NavdataShmPublisher::close()
+    {
+#ifdef UCAPA_HAS_POSIX_SHM
+        if (m_pMapping)
+        {
+            munmap(m_pMapping, m_size);
+            shm_unlink(m_name.c_str());
+        }
+        if (m_fd >= 0)
+            ::close(m_fd);
+#endif
+        m_pMapping = nullptr;
+        m_fd = -1;
+        m_size = 0;
+        m_name.clear();
+    }
+
+    void NavdataShmPublisher::publish(const NavdataSnapshot& snapshot)
+    {
+        if (!m_pMapping)
+            return;
+
+        ShmHeader* header = static_cast<ShmHeader*>(m_pMapping);
+        uint64_t index = header->lastIndex.load(std::memory_order_relaxed) + 1;
+        ShmSlot* slot = slotAt(m_pMapping, index);
+
+        // Make the slot odd while it is being written
+        uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(&slot->snapshot, &snapshot, sizeof(NavdataSnapshot));
+        slot->snapshot.index = index;
+
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+        header->lastIndex.store(index, std::memory_order_release);
+    }
+
+
+
+    NavdataShmReader::NavdataShmReader()
+        : m_fd(-1)
+        , m_size(0)
+        , m_pMapping(nullptr)
+    {
+    }
+
+    NavdataShmReader::~NavdataShmReader()
+    {
+        close();
+    }
+
+    bool NavdataShmReader::open(const std::string& name)
+    {
+        close();
+
+#ifdef UCAPA_HAS_POSIX_SHM
+        m_fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (m_fd < 0)
+        {
+            std::cerr << "Navdata reader: could not open " << name << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || (std::size_t)st.st_size < sizeof(ShmHeader))
+        {
+            std::cerr << "Navdata reader: " << name << " is not a navdata segment" << std::endl;
+            close();
+            return false;
+        }
+
+        m_size = st.st_size;
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "Navdata reader: could not map " << name << ": " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+
+        const ShmHeader* header = static_cast<const ShmHeader*>(mapping);
+        if (header->magic.load(std::memory_order_acquire) != SHM_MAGIC
+                || header->version != SHM_VERSION
+                || header->slotSize != sizeof(ShmSlot)
+                || header->nbSlots == 0
+                || segmentSize(header->nbSlots) > m_size)
+        {
+            std::cerr << "Navdata reader: " << name << " has an incompatible layout" << std::endl;
+            munmap(mapping, m_size);
+            close();
+            return false;
+        }
+
+        m_pMapping = mapping;
+        return true;
+#else
+        (void)name;
+        std::cerr << "Navdata reader: shared memory is not supported on this platform" << std::endl;
+        return false;
+#endif
+    }
+
+    void NavdataShmReader::close()
+    {
+#ifdef UCAPA_HAS_POSIX_SHM
+        if (m_pMapping)
+            munmap(const_cast<void*>(m_pMapping), m_size);
+        if (m_fd >= 0)
+            ::close(m_fd);
+#endif
+        m_pMapping = nullptr;
+        m_fd = -1;
+        m_size = 0;
+    }
+
+    uint64_t NavdataShmReader::getLastIndex() const
+    {
+        if (!m_pMapping)
+            return 0;
+        return static_cast<const ShmHeader*>(m_pMapping)->lastIndex.load(std::memory_order_acquire);
+    }
+
+    unsigned int NavdataShmReader::getNbSlots() const
+    {
+        if (!m_pMapping)
+            return 0;
+        return static_cast<const ShmHeader*>(m_pMapping)->nbSlots;
+    }
+
+    bool NavdataShmReader::readSlot(uint64_t index, NavdataSnapshot& snapshot) const
+    {
+        const ShmSlot* slot = slotAt(const_cast<void*>(m_pMapping), index);
+
+        for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+        {
+            uint32_t before = slot->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue; // The writer is in this slot
+
+            std::memcpy(&snapshot, &slot->snapshot, sizeof(NavdataSnapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot->sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+        return false;
+    }
+
+    bool NavdataShmReader::readLatest(NavdataSnapshot& snapshot) const
+    {
+        // The slot may be overwritten between the two loads, so retry with the new last index
+        for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+        {
+            uint64_t index = getLastIndex();
+            if (index == 0)
+                return false;
+            if (readSlot(index, snapshot) && snapshot.index >= index)
+                return true;
+        }
+        return false;
+    }
+
+    bool NavdataShmReader::read(uint64_t index, NavdataSnapshot& snapshot) const
+    {
+        if (index == 0 || index > getLastIndex())
+            return false;
+
+        return readSlot(index, snapshot) && snapshot.index == index;
+    }
+}
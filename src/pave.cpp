@@ -0,0 +1,78 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <pave.h>
+
+#include <cstring>
+
+namespace{
+    const char signature[4] = {'P', 'a', 'V', 'E'};
+
+    // The drone and the supported hosts are little endian, like the navdata
+    template<typename T>
+    T readField(const uint8_t* data, std::size_t offset)
+    {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+}
+
+namespace ucapa{
+    const std::size_t PaVEHeader::MIN_SIZE;
+    const std::size_t PaVEHeader::MAX_SIZE;
+    const uint32_t PaVEHeader::MAX_PAYLOAD_SIZE;
+
+    bool PaVEHeader::parse(const uint8_t* data)
+    {
+        if (std::memcmp(data, signature, sizeof(signature)) != 0)
+            return false;
+
+        version = data[4];
+        codec = data[5];
+        headerSize = readField<uint16_t>(data, 6);
+        payloadSize = readField<uint32_t>(data, 8);
+        encodedWidth = readField<uint16_t>(data, 12);
+        encodedHeight = readField<uint16_t>(data, 14);
+        displayWidth = readField<uint16_t>(data, 16);
+        displayHeight = readField<uint16_t>(data, 18);
+        frameNumber = readField<uint32_t>(data, 20);
+        timestamp = readField<uint32_t>(data, 24);
+        frameType = data[30];
+
+        return headerSize >= MIN_SIZE && headerSize <= MAX_SIZE && payloadSize <= MAX_PAYLOAD_SIZE;
+    }
+
+    std::size_t PaVEHeader::findSignature(const uint8_t* data, std::size_t size)
+    {
+        for (std::size_t i=0; i<size; ++i)
+        {
+            // A signature cut by the end of the data is completed by the next bytes
+            std::size_t n = size - i < sizeof(signature) ? size - i : sizeof(signature);
+            if (std::memcmp(data + i, signature, n) == 0)
+                return i;
+        }
+        return size;
+    }
+}
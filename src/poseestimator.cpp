@@ -0,0 +1,393 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <poseestimator.h>
+
+#include <cmath>
+
+#include <matrixdecomposition.h>
+#include <utils.h>
+
+namespace ucapa{
+    namespace{
+        const double GRAVITY = 9.80665;
+
+        double wrapAngle(double angle)
+        {
+            while (angle > PI)
+                angle -= 2*PI;
+            while (angle <= -PI)
+                angle += 2*PI;
+            return angle;
+        }
+    }
+
+    PoseEstimator::PoseEstimator(const Parameters& parameters)
+        : m_parameters(parameters)
+    {
+        reset();
+    }
+
+    void PoseEstimator::reset()
+    {
+        m_initialized = false;
+        m_headingOrigin = 0;
+        m_hasPressureReference = false;
+        m_pressureReference = 0;
+        m_pressureOffset = 0;
+        m_state.Zero();
+        m_covariance.Zero();
+    }
+
+    void PoseEstimator::resetOrigin()
+    {
+        if (!m_initialized)
+            return;
+
+        for (int k=POSITION_NORTH; k<=POSITION_EAST; ++k)
+        {
+            m_state(k) = 0;
+            for (int i=0; i<STATE_SIZE; ++i)
+                m_covariance(k, i) = m_covariance(i, k) = 0;
+        }
+        m_headingOrigin = m_state(HEADING);
+    }
+
+    bool PoseEstimator::initialize(const PoseMeasurements& measurements)
+    {
+        if (!measurements.hasAttitude)
+            return false;
+
+        reset();
+        m_state(ROLL) = measurements.roll * (PI/180.0);
+        m_state(PITCH) = measurements.pitch * (PI/180.0);
+        m_state(HEADING) = measurements.hasHeading ? wrapAngle(measurements.heading * (PI/180.0)) : 0;
+        if (measurements.hasAltitude)
+            m_state(POSITION_DOWN) = -measurements.altitude;
+        m_headingOrigin = m_state(HEADING);
+
+        const double deviations[STATE_SIZE] = {0.01, 0.01, 0.1, 0.1, 0.1, 0.1, 0.05, 0.05, 0.2};
+        for (int i=0; i<STATE_SIZE; ++i)
+            m_covariance(i, i) = deviations[i]*deviations[i];
+
+        m_initialized = true;
+        return true;
+    }
+
+    void PoseEstimator::computeRotation()
+    {
+        const double cr = cos(m_state(ROLL)), sr = sin(m_state(ROLL));
+        const double cp = cos(m_state(PITCH)), sp = sin(m_state(PITCH));
+        const double ch = cos(m_state(HEADING)), sh = sin(m_state(HEADING));
+
+        // R = Rz(heading) * Ry(pitch) * Rx(roll)
+        Matrix3d& R = m_rotation;
+        R(0, 0) = cp*ch; R(0, 1) = sr*sp*ch - cr*sh; R(0, 2) = cr*sp*ch + sr*sh;
+        R(1, 0) = cp*sh; R(1, 1) = sr*sp*sh + cr*ch; R(1, 2) = cr*sp*sh - sr*ch;
+        R(2, 0) = -sp;   R(2, 1) = sr*cp;            R(2, 2) = cr*cp;
+
+        Matrix3d& dR = m_rotationDerivatives[0]; // By roll
+        dR(0, 0) = 0; dR(0, 1) = cr*sp*ch + sr*sh; dR(0, 2) = -sr*sp*ch + cr*sh;
+        dR(1, 0) = 0; dR(1, 1) = cr*sp*sh - sr*ch; dR(1, 2) = -sr*sp*sh - cr*ch;
+        dR(2, 0) = 0; dR(2, 1) = cr*cp;            dR(2, 2) = -sr*cp;
+
+        Matrix3d& dP = m_rotationDerivatives[1]; // By pitch
+        dP(0, 0) = -sp*ch; dP(0, 1) = sr*cp*ch; dP(0, 2) = cr*cp*ch;
+        dP(1, 0) = -sp*sh; dP(1, 1) = sr*cp*sh; dP(1, 2) = cr*cp*sh;
+        dP(2, 0) = -cp;    dP(2, 1) = -sr*sp;   dP(2, 2) = -cr*sp;
+
+        Matrix3d& dH = m_rotationDerivatives[2]; // By heading
+        dH(0, 0) = -cp*sh; dH(0, 1) = -sr*sp*sh - cr*ch; dH(0, 2) = -cr*sp*sh + sr*ch;
+        dH(1, 0) = cp*ch;  dH(1, 1) = sr*sp*ch - cr*sh;  dH(1, 2) = cr*sp*ch + sr*sh;
+        dH(2, 0) = 0;      dH(2, 1) = 0;                 dH(2, 2) = 0;
+    }
+
+    void PoseEstimator::predict(double dt, const PoseMeasurements& measurements)
+    {
+        if (dt <= 0)
+            return;
+
+        computeRotation();
+
+        // Jacobian of the transition, starting from the identity
+        Covariance F = Covariance::identity();
+        for (int k=0; k<3; ++k)
+            F(POSITION_NORTH+k, VELOCITY_NORTH+k) = dt;
+
+        Matrix<double, 3, 1> acceleration;
+        double angleRates[3] = {0, 0, 0};
+        double accelerationNoise = m_parameters.accelerationNoise;
+        double angleNoise = m_parameters.angularRateNoise * dt;
+
+        if (measurements.hasImu)
+        {
+            Matrix<double, 3, 1> force;
+            double rates[3];
+            for (int k=0; k<3; ++k)
+            {
+                force(k) = measurements.accelerometers[k] * (GRAVITY/1000.0);
+                rates[k] = measurements.gyroscopes[k] * (PI/180.0);
+            }
+
+            // World acceleration and its derivatives by the angles
+            acceleration = m_rotation * force;
+            acceleration(2) += GRAVITY;
+            for (int a=0; a<3; ++a)
+            {
+                const Matrix<double, 3, 1> d = m_rotationDerivatives[a] * force;
+                for (int i=0; i<3; ++i)
+                {
+                    F(POSITION_NORTH+i, ROLL+a) = 0.5*dt*dt*d(i);
+                    F(VELOCITY_NORTH+i, ROLL+a) = dt*d(i);
+                }
+            }
+
+            // Euler angles derivatives from the body rates
+            const double cr = cos(m_state(ROLL)), sr = sin(m_state(ROLL));
+            const double cp = cos(m_state(PITCH)), tp = tan(m_state(PITCH));
+            const double a = rates[1]*sr + rates[2]*cr;
+            const double b = rates[1]*cr - rates[2]*sr;
+            angleRates[0] = rates[0] + a*tp;
+            angleRates[1] = b;
+            angleRates[2] = a/cp;
+
+            F(ROLL, ROLL) += dt * b*tp;
+            F(ROLL, PITCH) += dt * a/(cp*cp);
+            F(PITCH, ROLL) += dt * -a;
+            F(HEADING, ROLL) += dt * b/cp;
+            F(HEADING, PITCH) += dt * a*tp/cp;
+
+            accelerationNoise = m_parameters.accelerometerNoise;
+            angleNoise = m_parameters.gyroscopeNoise * dt;
+        }
+
+        // State propagation
+        for (int k=0; k<3; ++k)
+        {
+            m_state(POSITION_NORTH+k) += (m_state(VELOCITY_NORTH+k) + 0.5*acceleration(k)*dt) * dt;
+            m_state(VELOCITY_NORTH+k) += acceleration(k) * dt;
+            m_state(ROLL+k) += angleRates[k] * dt;
+        }
+        m_state(ROLL) = wrapAngle(m_state(ROLL));
+        m_state(HEADING) = wrapAngle(m_state(HEADING));
+
+        // P = F * P * F^T + Q
+        m_covariance = F * m_covariance * F.transponate();
+
+        // White acceleration noise on position and velocity, white rate noise on the angles
+        const double qa = accelerationNoise * accelerationNoise;
+        for (int k=0; k<3; ++k)
+        {
+            const int p = POSITION_NORTH+k, v = VELOCITY_NORTH+k;
+            m_covariance(p, p) += qa * dt*dt*dt*dt / 4;
+            m_covariance(p, v) += qa * dt*dt*dt / 2;
+            m_covariance(v, p) += qa * dt*dt*dt / 2;
+            m_covariance(v, v) += qa * dt*dt;
+            m_covariance(ROLL+k, ROLL+k) += angleNoise * angleNoise;
+        }
+    }
+
+    bool PoseEstimator::correct(double innovation, const StateVector& h, double variance)
+    {
+        const StateVector Ph = m_covariance * h;
+        const double S = (h.transponate() * Ph)(0) + variance;
+
+        if (innovation*innovation > m_parameters.gate*m_parameters.gate*S)
+            return false;
+
+        const StateVector K = Ph * (1.0/S);
+        m_state += K * innovation;
+        m_state(ROLL) = wrapAngle(m_state(ROLL));
+        m_state(HEADING) = wrapAngle(m_state(HEADING));
+
+        // P = P - K * (P * h)^T, kept symmetric
+        for (int i=0; i<STATE_SIZE; ++i)
+            for (int j=i; j<STATE_SIZE; ++j)
+                m_covariance(i, j) = m_covariance(j, i) = m_covariance(i, j) - 0.5*(K(i)*Ph(j) + K(j)*Ph(i));
+
+        return true;
+    }
+
+    template<int M>
+    bool PoseEstimator::correct(const Matrix<double, M, 1>& innovation, const Matrix<double, M, STATE_SIZE>& H, double variance)
+    {
+        // H * P, then S = H * P * H^T + R
+        Matrix<double, M, STATE_SIZE> HP;
+        const double* P = m_covariance.data();
+        for (int m=0; m<M; ++m)
+            for (int j=0; j<STATE_SIZE; ++j)
+            {
+                const double h = H(m, j);
+                if (h != 0)
+                    for (int k=0; k<STATE_SIZE; ++k)
+                        HP.data()[m*STATE_SIZE + k] += h * P[j*STATE_SIZE + k];
+            }
+
+        Matrix<double, M, M> S;
+        for (int i=0; i<M; ++i)
+        {
+            for (int j=0; j<M; ++j)
+                for (int k=0; k<STATE_SIZE; ++k)
+                    S(i, j) += HP(i, k) * H(j, k);
+            S(i, i) += variance;
+        }
+
+        // With S = L * L^T, the update only needs L^-1 * y and G = L^-1 * H * P:
+        // x += G^T * (L^-1 * y), P -= G^T * G, and the squared Mahalanobis distance is |L^-1 * y|^2
+        const CholeskyDecomposition<double, M> cholesky(S);
+        if (!cholesky.isPositiveDefinite())
+            return false;
+
+        const Matrix<double, M, 1> e = solveLowerTriangular(cholesky.getL(), innovation);
+        double distance = 0;
+        for (int i=0; i<M; ++i)
+            distance += e(i) * e(i);
+        if (distance > m_parameters.gate*m_parameters.gate)
+            return false;
+
+        const Matrix<double, M, STATE_SIZE> G = solveLowerTriangular(cholesky.getL(), HP);
+        for (int k=0; k<STATE_SIZE; ++k)
+            for (int m=0; m<M; ++m)
+                m_state(k) += G(m, k) * e(m);
+        m_state(ROLL) = wrapAngle(m_state(ROLL));
+        m_state(HEADING) = wrapAngle(m_state(HEADING));
+
+        for (int i=0; i<STATE_SIZE; ++i)
+            for (int j=i; j<STATE_SIZE; ++j)
+            {
+                double d = 0;
+                for (int m=0; m<M; ++m)
+                    d += G(m, i) * G(m, j);
+                m_covariance(i, j) = m_covariance(j, i) = m_covariance(i, j) - d;
+            }
+
+        return true;
+    }
+
+    bool PoseEstimator::correct(STATE_INDEX index, double measurement, double variance, bool isAngle)
+    {
+        StateVector h;
+        h(index) = 1;
+
+        double innovation = measurement - m_state(index);
+        if (isAngle)
+            innovation = wrapAngle(innovation);
+
+        return correct(innovation, h, variance);
+    }
+
+    void PoseEstimator::update(double dt, const PoseMeasurements& measurements)
+    {
+        if (!m_initialized)
+        {
+            initialize(measurements);
+            return;
+        }
+
+        predict(dt, measurements);
+
+        if (measurements.hasVelocity)
+        {
+            // The drone measures its velocity in its own frame: v = R^T * v_world
+            computeRotation();
+
+            Matrix<double, 2, 1> innovation;
+            Matrix<double, 2, STATE_SIZE> H;
+            for (int axis=0; axis<2; ++axis)
+            {
+                double predicted = 0;
+                for (int j=0; j<3; ++j)
+                {
+                    const double v = m_state(VELOCITY_NORTH+j);
+                    predicted += m_rotation(j, axis) * v;
+                    H(axis, VELOCITY_NORTH+j) = m_rotation(j, axis);
+                    for (int a=0; a<3; ++a)
+                        H(axis, ROLL+a) += m_rotationDerivatives[a](j, axis) * v;
+                }
+                innovation(axis) = measurements.velocity[axis] - predicted;
+            }
+            correct(innovation, H, m_parameters.velocityNoise * m_parameters.velocityNoise);
+        }
+
+        if (measurements.hasAttitude)
+        {
+            const double variance = m_parameters.attitudeNoise * m_parameters.attitudeNoise;
+            correct(ROLL, measurements.roll * (PI/180.0), variance, true);
+            correct(PITCH, measurements.pitch * (PI/180.0), variance);
+        }
+
+        if (measurements.hasHeading)
+            correct(HEADING, measurements.heading * (PI/180.0),
+                    m_parameters.headingNoise * m_parameters.headingNoise, true);
+
+        if (measurements.hasAltitude)
+            correct(POSITION_DOWN, -measurements.altitude, m_parameters.altitudeNoise * m_parameters.altitudeNoise);
+
+        if (measurements.hasPressure && measurements.pressure > 0)
+        {
+            if (!m_hasPressureReference)
+            {
+                m_hasPressureReference = true;
+                m_pressureReference = measurements.pressure;
+                m_pressureOffset = -m_state(POSITION_DOWN);
+            }
+            else
+            {
+                // International barometric formula
+                double altitude = m_pressureOffset + 44330.0 * (1.0 - pow(measurements.pressure / m_pressureReference, 0.190263));
+                correct(POSITION_DOWN, -altitude, m_parameters.pressureAltitudeNoise * m_parameters.pressureAltitudeNoise);
+            }
+        }
+    }
+
+    Vector3 PoseEstimator::toOriginFrame(double north, double east, double down) const
+    {
+        const double c = cos(m_headingOrigin), s = sin(m_headingOrigin);
+        const double forward = c*north + s*east;
+        const double right = -s*north + c*east;
+        return Vector3((float)right, (float)-down, (float)forward);
+    }
+
+    Vector3 PoseEstimator::getPosition() const
+    {
+        return toOriginFrame(m_state(POSITION_NORTH), m_state(POSITION_EAST), m_state(POSITION_DOWN));
+    }
+
+    Vector3 PoseEstimator::getVelocity() const
+    {
+        return toOriginFrame(m_state(VELOCITY_NORTH), m_state(VELOCITY_EAST), m_state(VELOCITY_DOWN));
+    }
+
+    Vector3 PoseEstimator::getRotation() const
+    {
+        return Vector3((float)(-wrapAngle(m_state(HEADING) - m_headingOrigin) * (180.0/PI)),
+                       (float)(m_state(PITCH) * (180.0/PI)),
+                       (float)(m_state(ROLL) * (180.0/PI)));
+    }
+
+    PoseEstimator::Covariance PoseEstimator::getCovariance() const
+    {
+        return m_covariance;
+    }
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <positionintegrator.h>
+
+namespace ucapa{
+    PositionIntegrator::PositionIntegrator(METHOD method, double maxExtrapolation)
+        : m_method(method)
+        , m_maxExtrapolation(maxExtrapolation)
+        , m_doublePrecision(false)
+        , m_nbSamples(0)
+    {
+    }
+
+    void PositionIntegrator::setDoublePrecision(bool activate)
+    {
+        if (activate == m_doublePrecision)
+            return;
+
+        if (activate)
+            m_precisePosition = Vector3d(m_position);
+        else
+            m_position = Vector3(m_precisePosition);
+        m_doublePrecision = activate;
+    }
+
+    void PositionIntegrator::reset(const Vector3& position)
+    {
+        setPosition(position);
+        m_nbSamples = 0;
+    }
+
+    void PositionIntegrator::reset(const Vector3d& position)
+    {
+        setPosition(position);
+        m_nbSamples = 0;
+    }
+
+    void PositionIntegrator::setPosition(const Vector3& position)
+    {
+        m_position = position;
+        m_precisePosition = Vector3d(position);
+    }
+
+    void PositionIntegrator::setPosition(const Vector3d& position)
+    {
+        m_position = Vector3(position);
+        m_precisePosition = position;
+    }
+
+    Vector3 PositionIntegrator::getPosition() const
+    {
+        return m_doublePrecision ? Vector3(m_precisePosition) : m_position;
+    }
+
+    Vector3d PositionIntegrator::getPrecisePosition() const
+    {
+        return m_doublePrecision ? m_precisePosition : Vector3d(m_position);
+    }
+
+    void PositionIntegrator::addSample(double time, const Vector3& velocity)
+    {
+        if (m_nbSamples > 0 && time <= m_times[2])
+        {
+            m_velocities[2] = velocity;
+            return;
+        }
+
+        // Shift the history, the newest sample is always at index 2
+        m_times[0] = m_times[1]; m_velocities[0] = m_velocities[1];
+        m_times[1] = m_times[2]; m_velocities[1] = m_velocities[2];
+        m_times[2] = time; m_velocities[2] = velocity;
+        if (m_nbSamples < 3)
+            m_nbSamples++;
+
+        if (m_nbSamples < 2)
+            return;
+
+        METHOD method = m_method;
+        // A parabola is only reliable when the three samples are close
+        if (method == RK2 && (m_nbSamples < 3 || m_times[2] - m_times[1] > m_maxExtrapolation || m_times[1] - m_times[0] > m_maxExtrapolation))
+            method = TRAPEZOIDAL;
+
+        if (m_doublePrecision)
+            m_precisePosition += getDisplacement<double>(method);
+        else
+            m_position += getDisplacement<float>(method);
+    }
+
+    template<typename T>
+    BasicVector3<T> PositionIntegrator::getDisplacement(METHOD method) const
+    {
+        const double t1 = m_times[1], t2 = m_times[2];
+        const double dt = t2 - t1;
+        const BasicVector3<T> v1(m_velocities[1]);
+        const BasicVector3<T> v2(m_velocities[2]);
+
+        switch (method)
+        {
+        case EULER:
+            return v2 * (T)dt;
+        case TRAPEZOIDAL:
+            return (v1 + v2) * (T)(0.5 * dt);
+        case RK2:
+        {
+            // Lagrange interpolation at the middle of the step
+            const double t0 = m_times[0];
+            const double tm = 0.5 * (t1 + t2);
+            const double l0 = (tm - t1) * (tm - t2) / ((t0 - t1) * (t0 - t2));
+            const double l1 = (tm - t0) * (tm - t2) / ((t1 - t0) * (t1 - t2));
+            const double l2 = (tm - t0) * (tm - t1) / ((t2 - t0) * (t2 - t1));
+            const BasicVector3<T> midVelocity = BasicVector3<T>(m_velocities[0]) * (T)l0 + v1 * (T)l1 + v2 * (T)l2;
+            return midVelocity * (T)dt;
+        }
+        }
+        return BasicVector3<T>();
+    }
+
+    Vector3 PositionIntegrator::getPosition(double time) const
+    {
+        if (m_nbSamples == 0)
+            return getPosition();
+
+        double dt = time - m_times[2];
+        if (dt <= 0)
+            return getPosition();
+        if (dt > m_maxExtrapolation)
+            dt = m_maxExtrapolation;
+
+        if (m_doublePrecision)
+            return Vector3(m_precisePosition + Vector3d(m_velocities[2]) * dt);
+        return m_position + m_velocities[2] * (float)dt;
+    }
+}
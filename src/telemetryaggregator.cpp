@@ -0,0 +1,133 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <telemetryaggregator.h>
+
+namespace ucapa{
+    TelemetryAggregator::TelemetryAggregator(std::chrono::duration<double> window, uint32_t fieldMask, Callback callback)
+        : m_window(std::chrono::duration_cast<std::chrono::nanoseconds>(window).count() > 0
+                   ? std::chrono::duration_cast<std::chrono::nanoseconds>(window).count() : 1)
+        , m_fieldMask(fieldMask & allFields())
+        , m_callback(callback)
+        , m_started(false)
+        , m_hasLast(false)
+    {
+        m_current.nbSamples = 0;
+        m_current.fieldMask = m_fieldMask;
+    }
+
+    void TelemetryAggregator::addSample(const NavdataSnapshot& snapshot)
+    {
+        Summary finished;
+        if (addSample(snapshot, finished))
+            notify(finished);
+    }
+
+    bool TelemetryAggregator::addSample(const NavdataSnapshot& snapshot, Summary& finished)
+    {
+        bool hasFinished = false;
+        if (!m_started)
+        {
+            m_current.windowStart = snapshot.timestamp;
+            m_current.windowEnd = snapshot.timestamp + m_window;
+            m_started = true;
+        }
+        else if (snapshot.timestamp >= m_current.windowEnd)
+        {
+            finishWindow(snapshot.timestamp, finished);
+            hasFinished = true;
+        }
+
+        const float values[NB_FIELDS] = {
+            snapshot.altitude,
+            (float)snapshot.batteryLvl,
+            snapshot.rotation[0], snapshot.rotation[1], snapshot.rotation[2],
+            snapshot.localVelocity[0], snapshot.localVelocity[1], snapshot.localVelocity[2],
+            snapshot.worldVelocity[0], snapshot.worldVelocity[1], snapshot.worldVelocity[2],
+            snapshot.worldPosition[0], snapshot.worldPosition[1], snapshot.worldPosition[2]
+        };
+
+        const bool first = (m_current.nbSamples == 0);
+        for (int i=0; i<NB_FIELDS; ++i)
+        {
+            if (!(m_fieldMask & (1U << i)))
+                continue;
+
+            FieldSummary& field = m_current.fields[i];
+            const float v = values[i];
+            if (first)
+            {
+                field.min = field.max = v;
+                m_sums[i] = 0;
+            }
+            else
+            {
+                if (v < field.min) field.min = v;
+                if (v > field.max) field.max = v;
+            }
+            field.last = v;
+            m_sums[i] += v;
+        }
+        m_current.nbSamples++;
+        return hasFinished;
+    }
+
+    void TelemetryAggregator::finishWindow(int64_t timestamp, Summary& finished)
+    {
+        for (int i=0; i<NB_FIELDS; ++i)
+        {
+            if (m_fieldMask & (1U << i))
+                m_current.fields[i].mean = (float)(m_sums[i] / m_current.nbSamples);
+        }
+
+        m_mutex.lock();
+        m_last = m_current;
+        m_hasLast = true;
+        m_mutex.unlock();
+        finished = m_current;
+
+        // Skip the windows without any sample, so that windows stay aligned
+        int64_t nbSkipped = (timestamp - m_current.windowEnd) / m_window;
+        m_current.windowStart = m_current.windowEnd + nbSkipped * m_window;
+        m_current.windowEnd = m_current.windowStart + m_window;
+        m_current.nbSamples = 0;
+    }
+
+    void TelemetryAggregator::notify(const Summary& summary) const
+    {
+        if (m_callback)
+            m_callback(summary);
+    }
+
+    bool TelemetryAggregator::getLastSummary(Summary& summary) const
+    {
+        m_mutex.lock();
+        bool hasLast = m_hasLast;
+        if (hasLast)
+            summary = m_last;
+        m_mutex.unlock();
+
+        return hasLast;
+    }
+}
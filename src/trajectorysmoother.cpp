@@ -0,0 +1,265 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <trajectorysmoother.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <navdata.h>
+#include <navdatalog.h>
+
+namespace ucapa{
+    namespace{
+        float Vector3::* const components[3] = {&Vector3::x, &Vector3::y, &Vector3::z};
+    }
+
+    TrajectorySmoother::TrajectorySmoother(const Parameters& parameters)
+        : m_parameters(parameters)
+    {
+    }
+
+    int TrajectorySmoother::decode(const std::string& log, std::vector<TrajectorySample>& trajectory)
+    {
+        NavdataLogReader reader;
+        if (!reader.open(log))
+            return -1;
+
+        const std::size_t nbRecords = reader.getNbRecords();
+        trajectory.resize(nbRecords);
+        m_steps.resize(nbRecords);
+        m_altitudes.resize(nbRecords);
+        for (int a=0; a<3; ++a)
+            m_axes[a].resize(nbRecords);
+
+        // Decode like during the flight, to get the world velocity and the drone timestamps
+        Navdata navdata;
+        navdata.setComputeWorldData(true);
+
+        NavdataLogRecord record;
+        std::size_t nbSamples = 0;
+        std::chrono::steady_clock::time_point previousTime;
+        while (nbSamples < nbRecords && reader.next(record))
+        {
+            std::chrono::steady_clock::time_point receptionTime(
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.timestamp)));
+            navdata.update(record.packet, receptionTime);
+
+            const std::chrono::steady_clock::time_point time = navdata.getTimestamp();
+            TrajectorySample& sample = trajectory[nbSamples];
+            sample.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+            sample.velocity = navdata.getVelocity();
+            sample.rotation = navdata.getRotation();
+            // Before the first demo option, the altitude of Navdata is only its default value
+            m_altitudes[nbSamples] = Navdata::findOption(record.packet, Navdata::NAVDATA_DEMO_TAG) ? navdata.getAltitude() : -1;
+            m_steps[nbSamples] = (nbSamples == 0) ? 0 : std::chrono::duration<double>(time - previousTime).count();
+
+            previousTime = time;
+            nbSamples++;
+        }
+
+        trajectory.resize(nbSamples);
+        return (int)nbSamples;
+    }
+
+    void TrajectorySmoother::smoothAxis(int axis, std::vector<TrajectorySample>& trajectory)
+    {
+        const std::size_t nbSamples = trajectory.size();
+        if (nbSamples == 0)
+            return;
+
+        float Vector3::* const component = components[axis];
+        const double qa = m_parameters.accelerationNoise * m_parameters.accelerationNoise;
+        const double rv = m_parameters.velocityNoise * m_parameters.velocityNoise;
+        const double ra = m_parameters.altitudeNoise * m_parameters.altitudeNoise;
+        const bool useAltitude = (component == &Vector3::y);
+        std::vector<AxisState>& states = m_axes[axis];
+
+        // Forward Kalman filter
+        for (std::size_t k=0; k<nbSamples; ++k)
+        {
+            AxisState& s = states[k];
+            if (k == 0)
+            {
+                // The take off position is the origin, only the altitude is unknown, and is left free until it is measured
+                const bool hasAltitude = (m_altitudes[0] >= 0);
+                s.predicted[0] = (useAltitude && hasAltitude) ? m_altitudes[0] : 0;
+                s.predicted[1] = 0;
+                s.predictedCovariance[0] = useAltitude ? (hasAltitude ? ra : 1e4) : 1e-6;
+                s.predictedCovariance[1] = 0;
+                s.predictedCovariance[2] = 1.0;
+            }
+            else
+            {
+                const AxisState& previous = states[k-1];
+                const double dt = m_steps[k];
+                const double pp = previous.covariance[0], pv = previous.covariance[1], vv = previous.covariance[2];
+
+                s.predicted[0] = previous.state[0] + previous.state[1]*dt;
+                s.predicted[1] = previous.state[1];
+                s.predictedCovariance[0] = pp + 2*dt*pv + dt*dt*vv + qa*dt*dt*dt*dt/4;
+                s.predictedCovariance[1] = pv + dt*vv + qa*dt*dt*dt/2;
+                s.predictedCovariance[2] = vv + qa*dt*dt;
+            }
+
+            double x[2] = {s.predicted[0], s.predicted[1]};
+            double pp = s.predictedCovariance[0], pv = s.predictedCovariance[1], vv = s.predictedCovariance[2];
+
+            // Velocity measurement
+            {
+                const double S = vv + rv;
+                const double y = trajectory[k].velocity.*component - x[1];
+                x[0] += pv/S * y;
+                x[1] += vv/S * y;
+                const double npp = pp - pv*pv/S, npv = pv - pv*vv/S, nvv = vv - vv*vv/S;
+                pp = npp; pv = npv; vv = nvv;
+            }
+
+            // Altitude measurement
+            if (useAltitude && m_altitudes[k] >= 0)
+            {
+                const double S = pp + ra;
+                const double y = m_altitudes[k] - x[0];
+                x[0] += pp/S * y;
+                x[1] += pv/S * y;
+                const double npp = pp - pp*pp/S, npv = pv - pp*pv/S, nvv = vv - pv*pv/S;
+                pp = npp; pv = npv; vv = nvv;
+            }
+
+            s.state[0] = x[0];
+            s.state[1] = x[1];
+            s.covariance[0] = pp;
+            s.covariance[1] = pv;
+            s.covariance[2] = vv;
+        }
+
+        // Backward pass
+        double x[2] = {states[nbSamples-1].state[0], states[nbSamples-1].state[1]};
+        double P[3] = {states[nbSamples-1].covariance[0], states[nbSamples-1].covariance[1], states[nbSamples-1].covariance[2]};
+        for (std::size_t k=nbSamples; k-- > 0;)
+        {
+            if (k+1 < nbSamples)
+            {
+                const AxisState& s = states[k];
+                const AxisState& next = states[k+1];
+                const double dt = m_steps[k+1];
+                const double pp = s.covariance[0], pv = s.covariance[1], vv = s.covariance[2];
+                const double* Pp = next.predictedCovariance;
+
+                // C = P(k) * F^T * Pp(k+1)^-1
+                const double a00 = pp + dt*pv, a01 = pv;
+                const double a10 = pv + dt*vv, a11 = vv;
+                const double det = Pp[0]*Pp[2] - Pp[1]*Pp[1];
+                const double i00 = Pp[2]/det, i01 = -Pp[1]/det, i11 = Pp[0]/det;
+                const double c00 = a00*i00 + a01*i01, c01 = a00*i01 + a01*i11;
+                const double c10 = a10*i00 + a11*i01, c11 = a10*i01 + a11*i11;
+
+                const double d0 = x[0] - next.predicted[0];
+                const double d1 = x[1] - next.predicted[1];
+                x[0] = s.state[0] + c00*d0 + c01*d1;
+                x[1] = s.state[1] + c10*d0 + c11*d1;
+
+                // P(k) = Pf(k) + C * (P(k+1) - Pp(k+1)) * C^T
+                const double e00 = P[0] - Pp[0], e01 = P[1] - Pp[1], e11 = P[2] - Pp[2];
+                const double f00 = c00*e00 + c01*e01, f01 = c00*e01 + c01*e11;
+                const double f10 = c10*e00 + c11*e01, f11 = c10*e01 + c11*e11;
+                P[0] = pp + f00*c00 + f01*c01;
+                P[1] = pv + f00*c10 + f01*c11;
+                P[2] = vv + f10*c10 + f11*c11;
+            }
+
+            TrajectorySample& sample = trajectory[k];
+            sample.position.*component = (float)x[0];
+            sample.velocity.*component = (float)x[1];
+            sample.positionDeviation.*component = (float)std::sqrt(P[0] > 0 ? P[0] : 0);
+        }
+    }
+
+    bool TrajectorySmoother::smooth(const std::string& log, std::vector<TrajectorySample>& trajectory)
+    {
+        if (decode(log, trajectory) < 0)
+        {
+            trajectory.clear();
+            return false;
+        }
+
+        for (int axis=0; axis<3; ++axis)
+            smoothAxis(axis, trajectory);
+
+        return true;
+    }
+
+    int TrajectorySmoother::smoothFiles(const std::vector<std::string>& paths,
+                                        std::vector<std::vector<TrajectorySample> >& trajectories,
+                                        unsigned int nbThreads,
+                                        const Parameters& parameters)
+    {
+        trajectories.resize(paths.size());
+
+        if (nbThreads == 0)
+            nbThreads = std::max(1U, std::thread::hardware_concurrency());
+        if (nbThreads > paths.size())
+            nbThreads = (unsigned int)paths.size();
+
+        // Each worker takes the next flight, so long flights do not block the others
+        std::atomic<std::size_t> nextFlight(0);
+        std::atomic<int> nbSmoothed(0);
+        auto worker = [&]() {
+            TrajectorySmoother smoother(parameters);
+            std::string log;
+            for (std::size_t i = nextFlight++; i < paths.size(); i = nextFlight++)
+            {
+                std::ifstream file(paths[i].c_str(), std::ios::binary);
+                if (!file)
+                {
+                    std::cerr << "Unable to open navdata log " << paths[i] << std::endl;
+                    trajectories[i].clear();
+                    continue;
+                }
+                std::ostringstream oss;
+                oss << file.rdbuf();
+                log = oss.str();
+
+                if (smoother.smooth(log, trajectories[i]))
+                    nbSmoothed++;
+                else
+                    std::cerr << "Invalid navdata log " << paths[i] << std::endl;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int t=1; t<nbThreads; ++t)
+            threads.push_back(std::thread(worker));
+        worker();
+        for (std::size_t t=0; t<threads.size(); ++t)
+            threads[t].join();
+
+        return nbSmoothed;
+    }
+}
@@ -0,0 +1,326 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <vector3array.h>
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+
+#include <simdpack.h>
+
+namespace ucapa{
+    namespace{
+        template<typename P>
+        std::size_t addKernel(float* x, float* y, float* z, const float* vx, const float* vy, const float* vz,
+                              std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                P::store(x+i, P::add(P::load(x+i), P::load(vx+i)));
+                P::store(y+i, P::add(P::load(y+i), P::load(vy+i)));
+                P::store(z+i, P::add(P::load(z+i), P::load(vz+i)));
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t addConstantKernel(float* x, float* y, float* z, const Vector3& v, std::size_t begin, std::size_t end)
+        {
+            const typename P::Type vx = P::set(v.x), vy = P::set(v.y), vz = P::set(v.z);
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                P::store(x+i, P::add(P::load(x+i), vx));
+                P::store(y+i, P::add(P::load(y+i), vy));
+                P::store(z+i, P::add(P::load(z+i), vz));
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t scaleKernel(float* x, float* y, float* z, float s, std::size_t begin, std::size_t end)
+        {
+            const typename P::Type vs = P::set(s);
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                P::store(x+i, P::mul(P::load(x+i), vs));
+                P::store(y+i, P::mul(P::load(y+i), vs));
+                P::store(z+i, P::mul(P::load(z+i), vs));
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t normalizeKernel(float* x, float* y, float* z, std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                const typename P::Type px = P::load(x+i), py = P::load(y+i), pz = P::load(z+i);
+                const typename P::Type m = P::sqrt(P::add(P::add(P::mul(px, px), P::mul(py, py)), P::mul(pz, pz)));
+                P::store(x+i, P::div(px, m));
+                P::store(y+i, P::div(py, m));
+                P::store(z+i, P::div(pz, m));
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t rotateKernel(float* x, float* y, float* z, const Matrix3f& r, std::size_t begin, std::size_t end)
+        {
+            typename P::Type m[9];
+            for (int k=0; k<9; ++k)
+                m[k] = P::set(r(k/3, k%3));
+
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                const typename P::Type px = P::load(x+i), py = P::load(y+i), pz = P::load(z+i);
+                P::store(x+i, P::add(P::add(P::mul(m[0], px), P::mul(m[1], py)), P::mul(m[2], pz)));
+                P::store(y+i, P::add(P::add(P::mul(m[3], px), P::mul(m[4], py)), P::mul(m[5], pz)));
+                P::store(z+i, P::add(P::add(P::mul(m[6], px), P::mul(m[7], py)), P::mul(m[8], pz)));
+            }
+            return i;
+        }
+
+        template<typename P>
+        std::size_t dotKernel(const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz,
+                              float* result, std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+                P::store(result+i, P::add(P::add(P::mul(P::load(x+i), P::load(vx+i)),
+                                                 P::mul(P::load(y+i), P::load(vy+i))),
+                                          P::mul(P::load(z+i), P::load(vz+i))));
+            return i;
+        }
+
+        template<typename P>
+        std::size_t crossKernel(const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz,
+                                float* rx, float* ry, float* rz, std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + P::WIDTH <= end; i += P::WIDTH)
+            {
+                // Load everything first, the result can be one of the operands
+                const typename P::Type ax = P::load(x+i), ay = P::load(y+i), az = P::load(z+i);
+                const typename P::Type bx = P::load(vx+i), by = P::load(vy+i), bz = P::load(vz+i);
+                P::store(rx+i, P::sub(P::mul(ay, bz), P::mul(az, by)));
+                P::store(ry+i, P::sub(P::mul(az, bx), P::mul(ax, bz)));
+                P::store(rz+i, P::sub(P::mul(ax, by), P::mul(ay, bx)));
+            }
+            return i;
+        }
+    }
+
+    Vector3Array::Vector3Array(std::size_t size)
+        : m_size(0)
+        , m_capacity(0)
+        , m_buffer(NULL)
+        , m_x(NULL)
+        , m_y(NULL)
+        , m_z(NULL)
+    {
+        resize(size);
+    }
+
+    Vector3Array::Vector3Array(const Vector3Array& v)
+        : m_size(0)
+        , m_capacity(0)
+        , m_buffer(NULL)
+        , m_x(NULL)
+        , m_y(NULL)
+        , m_z(NULL)
+    {
+        *this = v;
+    }
+
+    Vector3Array::Vector3Array(Vector3Array&& v)
+        : m_size(v.m_size)
+        , m_capacity(v.m_capacity)
+        , m_buffer(v.m_buffer)
+        , m_x(v.m_x)
+        , m_y(v.m_y)
+        , m_z(v.m_z)
+    {
+        v.m_size = v.m_capacity = 0;
+        v.m_buffer = v.m_x = v.m_y = v.m_z = NULL;
+    }
+
+    Vector3Array::~Vector3Array()
+    {
+        delete[] m_buffer;
+    }
+
+    Vector3Array& Vector3Array::operator=(const Vector3Array& v)
+    {
+        if (this != &v)
+        {
+            reserve(v.m_size);
+            m_size = v.m_size;
+            if (m_size > 0)
+            {
+                std::memcpy(m_x, v.m_x, m_size*sizeof(float));
+                std::memcpy(m_y, v.m_y, m_size*sizeof(float));
+                std::memcpy(m_z, v.m_z, m_size*sizeof(float));
+            }
+        }
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::operator=(Vector3Array&& v)
+    {
+        if (this != &v)
+        {
+            delete[] m_buffer;
+            m_size = v.m_size;
+            m_capacity = v.m_capacity;
+            m_buffer = v.m_buffer;
+            m_x = v.m_x;
+            m_y = v.m_y;
+            m_z = v.m_z;
+            v.m_size = v.m_capacity = 0;
+            v.m_buffer = v.m_x = v.m_y = v.m_z = NULL;
+        }
+        return *this;
+    }
+
+    void Vector3Array::reserve(std::size_t capacity)
+    {
+        if (capacity <= m_capacity)
+            return;
+
+        // A multiple of 8 floats keeps the three arrays aligned on 32 bytes
+        capacity = (capacity + 7) & ~(std::size_t)7;
+        float* buffer = new float[3*capacity + 8];
+        float* x = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(buffer) + 31) & ~(uintptr_t)31);
+        float* y = x + capacity;
+        float* z = y + capacity;
+
+        if (m_size > 0)
+        {
+            std::memcpy(x, m_x, m_size*sizeof(float));
+            std::memcpy(y, m_y, m_size*sizeof(float));
+            std::memcpy(z, m_z, m_size*sizeof(float));
+        }
+        delete[] m_buffer;
+
+        m_buffer = buffer;
+        m_capacity = capacity;
+        m_x = x;
+        m_y = y;
+        m_z = z;
+    }
+
+    void Vector3Array::resize(std::size_t size)
+    {
+        if (size > m_capacity)
+            reserve(size > 2*m_capacity ? size : 2*m_capacity);
+
+        for (std::size_t i=m_size; i<size; ++i)
+            m_x[i] = m_y[i] = m_z[i] = 0;
+        m_size = size;
+    }
+
+    void Vector3Array::push_back(const Vector3& v)
+    {
+        if (m_size == m_capacity)
+            reserve(m_capacity > 0 ? 2*m_capacity : 8);
+
+        set(m_size++, v);
+    }
+
+    void Vector3Array::checkSize(const Vector3Array& v, const char* operation) const
+    {
+        if (v.m_size != m_size)
+            throw std::length_error(std::string("Vector3Array ") + operation + " error. (The two operands haven't the same size.)");
+    }
+
+
+    Vector3Array& Vector3Array::add(const Vector3Array& v)
+    {
+        checkSize(v, "addition");
+        UCAPA_RUN_KERNEL(addKernel, m_size, m_x, m_y, m_z, v.m_x, v.m_y, v.m_z);
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::add(const Vector3& v)
+    {
+        UCAPA_RUN_KERNEL(addConstantKernel, m_size, m_x, m_y, m_z, v);
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::scale(float s)
+    {
+        UCAPA_RUN_KERNEL(scaleKernel, m_size, m_x, m_y, m_z, s);
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::normalize()
+    {
+        UCAPA_RUN_KERNEL(normalizeKernel, m_size, m_x, m_y, m_z);
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::rotate(const Matrix3f& m)
+    {
+        UCAPA_RUN_KERNEL(rotateKernel, m_size, m_x, m_y, m_z, m);
+        return *this;
+    }
+
+    Vector3Array& Vector3Array::rotate(const Quaternion& q)
+    {
+        // Building the matrix once is cheaper than rotating each vector with the quaternion
+        return rotate(q.getRotationMatrix());
+    }
+
+    void Vector3Array::dot(const Vector3Array& v, float* result) const
+    {
+        checkSize(v, "dot product");
+        UCAPA_RUN_KERNEL(dotKernel, m_size, m_x, m_y, m_z, v.m_x, v.m_y, v.m_z, result);
+    }
+
+    void Vector3Array::cross(const Vector3Array& v, Vector3Array& result) const
+    {
+        checkSize(v, "cross product");
+        if (&result != this && &result != &v)
+            result.resize(m_size);
+        UCAPA_RUN_KERNEL(crossKernel, m_size, m_x, m_y, m_z, v.m_x, v.m_y, v.m_z, result.m_x, result.m_y, result.m_z);
+    }
+
+    const char* Vector3Array::getInstructionSet()
+    {
+#if defined(UCAPA_HAS_AVX)
+        return "avx";
+#elif defined(UCAPA_HAS_SSE2)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -24,19 +24,29 @@
 
 #include <video.h>
 
-namespace ucapa{
+#include <algorithm>
+#include <cstring>
 
+namespace ucapa{
     Video::Video(const std::string& droneIP, unsigned short VideoPort)
         : m_droneIP(droneIP)
         , m_videoPort(VideoPort)
         // Init Video stream receiving
-        , m_pFormatCtx(nullptr)
+        , m_socket(m_ioService)
+        , m_headerLength(0)
         , m_pCodecCtx(nullptr)
         , m_pFrame(nullptr)
-        , m_pFrameRGB(nullptr)
+        , m_poolFormat(AV_PIX_FMT_NONE)
+        , m_yuvConverter(std::make_shared<YuvConverter>())
+        , m_nextOutputId(0)
         , m_pFrameBufferReturned(nullptr)
-        , m_bufferRGB(nullptr)
-        , m_pConvertCtx(nullptr)
+        , m_waitKeyFrame(false)
+        , m_latestFrameOnly(true)
+        , m_decoderThreading(SLICE_THREADING)
+        , m_decoderThreadCount(0)
+        , m_decoderLowDelay(true)
+        , m_nbStaleFrames(0)
+        , m_frameLatency(0)
         , m_isActive(false)
         , m_possiblyDeconnected(false)
         , m_firstConnection(true)
@@ -45,9 +55,11 @@ namespace ucapa{
         try
         {
             // Prepare all codecs that light be used
-            av_register_all();
             avcodec_register_all();
-            avformat_network_init();
+
+            av_init_packet(&m_pendingPacket.packet);
+            m_pendingPacket.packet.data = nullptr;
+            m_pendingPacket.packet.size = 0;
         }
         catch (std::exception& e)
         {
@@ -69,12 +81,36 @@ namespace ucapa{
         m_callbackInitFunc = callbackInitFunc;
     }
 
+    void Video::setDroneClock(std::function<std::chrono::steady_clock::time_point(double)> droneTimeToHost)
+    {
+        m_packetMutex.lock();
+        m_droneTimeToHost = droneTimeToHost;
+        m_packetMutex.unlock();
+    }
+
+
+    void Video::configureDecoder(AVCodecContext* codecCtx, DECODER_THREADING threading, int nbThreads, bool lowDelay)
+    {
+        codecCtx->thread_count = nbThreads;
+        codecCtx->thread_type = 0;
+        if (threading & FRAME_THREADING)
+            codecCtx->thread_type |= FF_THREAD_FRAME;
+        if (threading & SLICE_THREADING)
+            codecCtx->thread_type |= FF_THREAD_SLICE;
+        if (threading == NO_THREADING)
+            codecCtx->thread_count = 1;
+
+        // The decoder delays the frames to reorder them, even when the stream has no B-frames
+        if (lowDelay)
+            codecCtx->flags |= CODEC_FLAG_LOW_DELAY;
+        else
+            codecCtx->flags &= ~CODEC_FLAG_LOW_DELAY;
+    }
+
 
     int Video::init()
     {
-        m_isActive = false;
-        if (m_videoThread.joinable())
-            m_videoThread.join();
+        stopVideoThread();
 
         try {
             if (m_firstConnection)
@@ -84,26 +120,18 @@ namespace ucapa{
                     m_callbackInitFunc();
             }
 
-            // Prepare Name of the stream to open
-            std::ostringstream oss;
-            oss << "tcp://" << m_droneIP << ":" << 5555;
-
-            // Try to open video stream
-            if (avformat_open_input(&m_pFormatCtx, oss.str().c_str(), nullptr, nullptr) != 0)
+            // Connect to the video port, the drone starts to send the stream at once
+            std::error_code error;
+            m_socket.connect(asio::ip::tcp::endpoint(asio::ip::address::from_string(m_droneIP), m_videoPort), error);
+            if (error)
             {
-                std::cerr << "Could not open the video file" << std::endl;
+                std::cerr << "Could not connect to the video stream: " << error.message() << std::endl;
+                m_socket.close(error);
                 return -1;
             }
 
-            // Recover stream information
-            avformat_find_stream_info(m_pFormatCtx, nullptr);
-
-            // Dump information to standard output
-            av_dump_format(m_pFormatCtx, 0, oss.str().c_str(), 0);
-
-            // Find the decoder for the video stream
-            m_pCodecCtx = m_pFormatCtx->streams[0]->codec;
-            AVCodec *m_pCodec = avcodec_find_decoder(m_pCodecCtx->codec_id);
+            // The stream of the AR.Drone 2.0 is always H.264, its parameters are in the payload of the key frames
+            AVCodec *m_pCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
             if (m_pCodec == nullptr)
             {
                 std::cerr << "Finding Codec failed" << std::endl;
@@ -111,39 +139,50 @@ namespace ucapa{
             }
 
             // Open codec
+            m_pCodecCtx = avcodec_alloc_context3(m_pCodec);
+            configureDecoder(m_pCodecCtx, getDecoderThreading(), m_decoderThreadCount, m_decoderLowDelay);
+            // The published frames keep a reference on the planes of the decoder, instead of a copy
+            m_pCodecCtx->refcounted_frames = 1;
             if (avcodec_open2(m_pCodecCtx, m_pCodec, nullptr) < 0)
             {
                 std::cerr << "Opening Codec failed"  << std::endl;
                 return -3;
             }
 
-            // Allocate video frames and a buffer
+            // Allocate video frame
             m_pFrame = av_frame_alloc();
-            m_pFrameRGB = av_frame_alloc();
-            m_bufferRGB = (uint8_t*)av_mallocz(avpicture_get_size(PIX_FMT_RGB24, m_pCodecCtx->width, m_pCodecCtx->height) * sizeof(uint8_t));
-
-            // Fill the frame with the previous buffer
-            avpicture_fill((AVPicture*)m_pFrameRGB, m_bufferRGB, PIX_FMT_RGB24, m_pCodecCtx->width, m_pCodecCtx->height);
 
-            // Convert frame to RGB
-            m_pConvertCtx = sws_getContext(m_pCodecCtx->width, m_pCodecCtx->height, m_pCodecCtx->pix_fmt, m_pCodecCtx->width, m_pCodecCtx->height, PIX_FMT_RGB24, SWS_SPLINE, nullptr, nullptr, nullptr);
-
-            // Init return buffer size with the stream dim
-            m_pFrameBufferReturned = new uint8_t[m_pCodecCtx->width * m_pCodecCtx->height * 3];
+            // Nothing can be decoded before the first key frame
+            m_packetMutex.lock();
+            m_waitKeyFrame = true;
+            m_packetMutex.unlock();
+            m_headerLength = 0;
 
             m_possiblyDeconnected = false;
+            m_isActive = true;
+            m_ioService.reset();
+            readHeader();
+            m_readThread = std::thread([this] () {
+                                                    try {
+                                                        m_ioService.run();
+                                                    }
+                                                    catch (...)
+                                                    {
+                                                        std::cerr << "Video Read Thread : Error in the Thread" << std::endl;
+                                                        std::lock_guard<std::mutex> lock(m_packetMutex);
+                                                        m_isActive = false;
+                                                    }
+                                                    m_packetAvailable.notify_all();
+                                                });
             m_videoThread = std::thread([this] () {
                                                     try {
-                                                        m_isActive = true;
-                                                        m_possiblyDeconnected = false;
-
-                                                        if (m_isActive)
-                                                            decode();
+                                                        // No sleep, each frame is published as soon as its packet is decoded
                                                         while (m_isActive && !m_terminate)
-                                                        {
-                                                            std::this_thread::sleep_for(std::chrono::milliseconds(16));
                                                             decode();
-                                                        }
+
+                                                        m_ioService.stop();
+                                                        if (m_readThread.joinable())
+                                                            m_readThread.join();
 
                                                         stopReconnectionThread();
 
@@ -157,6 +196,9 @@ namespace ucapa{
                                                     catch (...)
                                                     {
                                                         std::cerr << "Video Thread : Error in the Thread" << std::endl;
+                                                        m_ioService.stop();
+                                                        if (m_readThread.joinable())
+                                                            m_readThread.join();
                                                         if (!m_terminate)
                                                         {
                                                             reconnect();
@@ -192,32 +234,142 @@ namespace ucapa{
                                                            });
     }
 
-    void Video::decode()
+    void Video::readHeader()
     {
-        m_videoMutex.lock();
-        AVPacket packet;
-        try
+        asio::async_read(m_socket, asio::buffer(m_headerBuffer + m_headerLength, PaVEHeader::MIN_SIZE - m_headerLength),
+                         [this](std::error_code error, std::size_t) {this->handleHeader(error);});
+    }
+
+    void Video::handleHeader(const std::error_code& error)
+    {
+        if (error)
         {
-            // get video frames
-            av_init_packet(&packet);
+            handleReadError(error);
+            return;
+        }
 
-            // Allocate the frame
-            avpicture_fill((AVPicture*)m_pFrameRGB, m_bufferRGB, PIX_FMT_RGB24, m_pCodecCtx->width, m_pCodecCtx->height);
+        if (!m_pendingPacket.header.parse(m_headerBuffer))
+        {
+            // Lost the synchronization, keep the bytes from the next signature
+            std::size_t position = PaVEHeader::findSignature(m_headerBuffer + 1, PaVEHeader::MIN_SIZE - 1) + 1;
+            m_headerLength = PaVEHeader::MIN_SIZE - position;
+            std::memmove(m_headerBuffer, m_headerBuffer + position, m_headerLength);
+            readHeader();
+            return;
+        }
+        m_headerLength = 0;
 
-            int frameDecoded;
-            // Decoding of a frame
-            // read frame
-            if(av_read_frame(m_pFormatCtx, &packet) < 0)
+        // The end of the header is skipped, and the payload is read directly in the packet given to the decoder
+        const PaVEHeader& header = m_pendingPacket.header;
+        if (av_new_packet(&m_pendingPacket.packet, (int)header.payloadSize) < 0)
+        {
+            // The payload is dropped, the next header is found again by the resynchronization
+            std::cerr << "Video : Cannot allocate a packet of " << header.payloadSize << " bytes" << std::endl;
+            readHeader();
+            return;
+        }
+        if (header.isKeyFrame())
+            m_pendingPacket.packet.flags |= AV_PKT_FLAG_KEY;
+
+        std::vector<asio::mutable_buffer> buffers;
+        buffers.push_back(asio::buffer(m_headerBuffer, header.headerSize - PaVEHeader::MIN_SIZE));
+        buffers.push_back(asio::buffer(m_pendingPacket.packet.data, header.payloadSize));
+        asio::async_read(m_socket, buffers, [this](std::error_code error, std::size_t) {this->handlePayload(error);});
+    }
+
+    void Video::handlePayload(const std::error_code& error)
+    {
+        if (error)
+        {
+            av_free_packet(&m_pendingPacket.packet);
+            handleReadError(error);
+            return;
+        }
+        m_possiblyDeconnected = false;
+
+        // The data now belongs to the queued packet
+        VideoPacket item = m_pendingPacket;
+        av_init_packet(&m_pendingPacket.packet);
+        m_pendingPacket.packet.data = nullptr;
+        m_pendingPacket.packet.size = 0;
+        item.receptionTime = std::chrono::steady_clock::now();
+        item.timestamp = item.receptionTime;
+        readHeader();
+
+        std::lock_guard<std::mutex> lock(m_packetMutex);
+        if (m_droneTimeToHost)
+        {
+            // The capture is before the reception, else the drone clock is not synchronized yet
+            std::chrono::steady_clock::time_point captureTime = m_droneTimeToHost(item.header.timestamp / 1000.0);
+            if (captureTime <= item.receptionTime && item.receptionTime - captureTime < std::chrono::seconds(1))
+                item.timestamp = captureTime;
+        }
+
+        if (item.header.codec != PaVEHeader::CODEC_MPEG4_AVC)
+        {
+            av_free_packet(&item.packet);
+            return;
+        }
+
+        // The decoding can't keep up, the frames in the backlog are too old to be shown
+        if (m_packets.size() >= m_maxQueuedPackets)
+        {
+            m_nbStaleFrames += m_packets.size();
+            clearPackets();
+            m_waitKeyFrame = true;
+        }
+
+        // Without the previous frames, only a key frame can be decoded
+        if (m_waitKeyFrame)
+        {
+            if (!(item.packet.flags & AV_PKT_FLAG_KEY))
             {
-                std::cerr << "Could not read frame !" << std::endl;
-                av_free_packet(&packet);
-                if (m_possiblyDeconnected)
-                    m_isActive = false;
-                else
-                    m_possiblyDeconnected = true;
+                m_nbStaleFrames++;
+                av_free_packet(&item.packet);
+                return;
             }
+            m_waitKeyFrame = false;
+        }
+
+        m_packets.push_back(item);
+        m_packetAvailable.notify_one();
+    }
+
+    void Video::handleReadError(const std::error_code& error)
+    {
+        // Also called when the service is stopped
+        if (error == asio::error::operation_aborted || m_terminate)
+            return;
+
+        // The TCP stream can't be resumed after an error
+        std::cerr << "Could not read frame ! " << error.message() << std::endl;
+        m_possiblyDeconnected = true;
+        // Under the mutex, else the decoding thread could miss the notification between its test and its wait
+        m_packetMutex.lock();
+        m_isActive = false;
+        m_packetMutex.unlock();
+        m_packetAvailable.notify_all();
+    }
+
+    void Video::decode()
+    {
+        VideoPacket item;
+        {
+            std::unique_lock<std::mutex> lock(m_packetMutex);
+            m_packetAvailable.wait(lock, [this] () { return !m_packets.empty() || !m_isActive || m_terminate; });
+            if (m_packets.empty())
+                return;
+
+            item = m_packets.front();
+            m_packets.pop_front();
+        }
+
+        m_videoMutex.lock();
+        try
+        {
+            int frameDecoded;
             // decode the frame, if frameDecoded = 1 frame is decoded
-            else if(avcodec_decode_video2(m_pCodecCtx, m_pFrame, &frameDecoded, &packet) < 0)
+            if(avcodec_decode_video2(m_pCodecCtx, m_pFrame, &frameDecoded, &item.packet) < 0)
             {
                 std::cerr << "Could not decode frame !"  << std::endl;
                 if (m_possiblyDeconnected)
@@ -228,23 +380,180 @@ namespace ucapa{
             // Frame decoded
             else if (frameDecoded)
             {
-                // convert frame to RGB
-                sws_scale(m_pConvertCtx, m_pFrame->data, m_pFrame->linesize, 0,
-                          m_pCodecCtx->height, m_pFrameRGB->data, m_pFrameRGB->linesize);
+                // Skip the frame if a newer frame is coming, but keep the image moving if the decoding is always late
+                bool stale = false;
+                if (!prepareFramePool(m_pFrame->width, m_pFrame->height, (AVPixelFormat)m_pFrame->format))
+                    m_nbStaleFrames++;
+                else if (m_latestFrameOnly && std::chrono::steady_clock::now() - m_lastPublication < m_maxSkipDuration)
+                {
+                    std::lock_guard<std::mutex> lock(m_packetMutex);
+                    stale = !m_packets.empty();
+                }
+
+                if (stale)
+                    m_nbStaleFrames++;
+                else
+                {
+                    // Give the planes to a buffer no reader is using, if all are read the frame is dropped
+                    FrameHandle::Buffer* buffer = m_framePool->acquire();
+                    if (buffer)
+                    {
+                        AVFrame* frame = av_frame_alloc();
+                        av_frame_move_ref(frame, m_pFrame);
+                        buffer->owner = std::shared_ptr<AVFrame>(frame, [](AVFrame* f) {av_frame_free(&f);});
+                        for (int plane=0; plane<3; ++plane)
+                        {
+                            buffer->planes[plane] = frame->data[plane];
+                            buffer->strides[plane] = frame->linesize[plane];
+                        }
+                        produceOutputs(buffer);
+                        m_framePool->publish(buffer, item.timestamp);
+                        m_lastPublication = std::chrono::steady_clock::now();
+
+                        long long delay = std::chrono::duration_cast<std::chrono::nanoseconds>(m_lastPublication - item.timestamp).count();
+                        // The average starts from the first frame of the pool, else it would rise slowly from 0
+                        if (m_framePool->getNbPublished() == 1)
+                            m_frameLatency = delay;
+                        else
+                            m_frameLatency = (m_frameLatency * 15 + delay) / 16;
+                    }
+                }
+                av_frame_unref(m_pFrame);
             }
-            av_free_packet(&packet);
         }
         catch (...)
         {
             std::cerr << "Decode : Error in Video Decoding Function" << std::endl;
             m_isActive = false;
             m_possiblyDeconnected = true;
-            av_free_packet(&packet);
         }
+        av_free_packet(&item.packet);
 
         m_videoMutex.unlock();
     }
 
+    void Video::clearPackets()
+    {
+        for (std::size_t i=0; i<m_packets.size(); ++i)
+            av_free_packet(&m_packets[i].packet);
+        m_packets.clear();
+    }
+
+    bool Video::prepareFramePool(int width, int height, AVPixelFormat format)
+    {
+        // The H.264 decoder gives YUV 4:2:0, full range (YUVJ) with some encoders
+        if (format != AV_PIX_FMT_YUV420P && format != AV_PIX_FMT_YUVJ420P)
+        {
+            if (format != m_poolFormat)
+                std::cerr << "Unsupported pixel format of the video: " << format << std::endl;
+            m_poolFormat = format;
+            return false;
+        }
+
+        m_frameMutex.lock();
+        const bool samePool = m_framePool && m_framePool->getWidth() == width && m_framePool->getHeight() == height && format == m_poolFormat;
+        m_frameMutex.unlock();
+        if (samePool)
+            return true;
+
+        // The handles on the previous pool keep it alive, with the converter
+        std::shared_ptr<YuvConverter> converter = m_yuvConverter;
+        const bool fullRange = format == AV_PIX_FMT_YUVJ420P;
+        m_frameMutex.lock();
+        m_framePool = std::make_shared<FramePool>(width, height,
+                                                  [converter, width, height, fullRange](const FrameHandle::Buffer& buffer, FrameHandle::FORMAT destFormat, uint8_t* dest, int destStride) {
+                                                      return converter->convert(buffer.planes, buffer.strides, width, height, fullRange, destFormat, dest, destStride);
+                                                  });
+        delete[] m_pFrameBufferReturned;
+        m_pFrameBufferReturned = new uint8_t[width * height * 3];
+        m_frameMutex.unlock();
+        m_poolFormat = format;
+
+        return true;
+    }
+
+    void Video::produceOutputs(FrameHandle::Buffer* buffer)
+    {
+        m_outputMutex.lock();
+        std::vector<std::pair<int, VideoOutputSpec> > outputs(m_outputs.begin(), m_outputs.end());
+        m_outputMutex.unlock();
+
+        // Free the scalers of the unregistered outputs
+        for (std::map<int, SwsContext*>::iterator it = m_outputScalers.begin(); it != m_outputScalers.end();)
+        {
+            bool registered = false;
+            for (std::size_t i=0; i<outputs.size() && !registered; ++i)
+                registered = outputs[i].first == it->first;
+            if (registered)
+                ++it;
+            else
+            {
+                sws_freeContext(it->second);
+                m_outputScalers.erase(it++);
+            }
+        }
+
+        if (buffer->outputs.size() < outputs.size())
+            buffer->outputs.resize(outputs.size());
+
+        const int frameWidth = m_framePool->getWidth();
+        const int frameHeight = m_framePool->getHeight();
+        for (std::size_t i=0; i<outputs.size(); ++i)
+        {
+            const VideoOutputSpec& spec = outputs[i].second;
+
+            // The region starts on even pixels, so it starts on a chroma sample too
+            const int x = spec.x & ~1;
+            const int y = spec.y & ~1;
+            if (x >= frameWidth || y >= frameHeight)
+                continue;
+            const int width = spec.width > 0 ? std::min(spec.width, frameWidth - x) : frameWidth - x;
+            const int height = spec.height > 0 ? std::min(spec.height, frameHeight - y) : frameHeight - y;
+
+            FrameHandle::Image& image = buffer->outputs[i];
+            image.format = spec.format;
+            image.width = std::max(1, (int)(width * spec.scale + 0.5f));
+            image.height = std::max(1, (int)(height * spec.scale + 0.5f));
+            image.stride = (image.width * FrameHandle::getBytesPerPixel(spec.format) + 31) & ~31;
+            image.memory.resize((std::size_t)image.stride * image.height + 32);
+            image.data = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(image.memory.data()) + 31) & ~(uintptr_t)31);
+
+            const uint8_t* planes[4] = {buffer->planes[0] + y * buffer->strides[0] + x,
+                                        buffer->planes[1] + (y / 2) * buffer->strides[1] + x / 2,
+                                        buffer->planes[2] + (y / 2) * buffer->strides[2] + x / 2,
+                                        nullptr};
+            int strides[4] = {buffer->strides[0], buffer->strides[1], buffer->strides[2], 0};
+
+            bool produced = true;
+            if (image.width == width && image.height == height && spec.format == FrameHandle::FORMAT_GRAY8)
+            {
+                for (int row=0; row<height; ++row)
+                    memcpy(image.data + row * image.stride, planes[0] + row * strides[0], width);
+            }
+            else if (image.width == width && image.height == height)
+                produced = m_yuvConverter->convert(planes, strides, width, height, m_poolFormat == AV_PIX_FMT_YUVJ420P, spec.format, image.data, image.stride);
+            else
+            {
+                AVPixelFormat destFormat = spec.format == FrameHandle::FORMAT_BGRA ? AV_PIX_FMT_BGRA
+                                         : spec.format == FrameHandle::FORMAT_RGBA ? AV_PIX_FMT_RGBA
+                                         : spec.format == FrameHandle::FORMAT_GRAY8 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+                // The scaler is kept while the size of the region doesn't change
+                SwsContext*& scaler = m_outputScalers[outputs[i].first];
+                scaler = sws_getCachedContext(scaler, width, height, m_poolFormat, image.width, image.height, destFormat, SWS_AREA, nullptr, nullptr, nullptr);
+                if (scaler)
+                {
+                    uint8_t* data[4] = {image.data, nullptr, nullptr, nullptr};
+                    int linesize[4] = {image.stride, 0, 0, 0};
+                    sws_scale(scaler, planes, strides, 0, height, data, linesize);
+                }
+                produced = scaler != nullptr;
+            }
+
+            if (produced)
+                image.id = outputs[i].first;
+        }
+    }
+
     void Video::tryToConnect()
     {
         try {
@@ -282,58 +591,54 @@ namespace ucapa{
     {
         m_videoMutex.lock();
 
-        // Deallocate the frame
+        // Deallocate the frame, the published ones are freed with their last handle
         if (m_pFrame)
-        {
-            av_free(m_pFrame);
-            m_pFrame = nullptr;
-        }
+            av_frame_free(&m_pFrame);
 
-        // Deallocate the frame
-        if (m_pFrameRGB)
-        {
-            av_free(m_pFrameRGB);
-            m_pFrameRGB = nullptr;
-        }
-
-        // Deallocate the buffer
-        if (m_bufferRGB)
-        {
-            av_free(m_bufferRGB);
-            m_bufferRGB = nullptr;
-        }
-
-        // Deallocate the convert context
-        if (m_pConvertCtx)
-        {
-            sws_freeContext(m_pConvertCtx);
-            m_pConvertCtx = nullptr;
-        }
+        // Deallocate the scalers of the outputs
+        for (std::map<int, SwsContext*>::iterator it = m_outputScalers.begin(); it != m_outputScalers.end(); ++it)
+            sws_freeContext(it->second);
+        m_outputScalers.clear();
 
         // Deallocate the codec
         if (m_pCodecCtx)
         {
-            avcodec_close(m_pCodecCtx);
+            avcodec_free_context(&m_pCodecCtx);
             m_pCodecCtx = nullptr;
         }
 
-        // Deallocate the format context
-        if (m_pFormatCtx)
+        // Deallocate the packets not decoded
+        m_packetMutex.lock();
+        clearPackets();
+        m_waitKeyFrame = false;
+        m_packetMutex.unlock();
+
+        // Close the video socket
+        if (m_socket.is_open())
         {
-            avformat_close_input(&m_pFormatCtx);
-            m_pFormatCtx = nullptr;
+            std::error_code error;
+            m_socket.close(error);
         }
 
+        // Run the aborted reads, so that they don't meet the next connection
+        m_ioService.reset();
+        m_ioService.poll();
+        av_free_packet(&m_pendingPacket.packet);
+        m_headerLength = 0;
+
         std::this_thread::sleep_for(std::chrono::milliseconds(80));
 
-        // Deallocate the frame buffer
+        m_videoMutex.unlock();
+
+        // The frames still read are freed with their last handle
+        m_frameMutex.lock();
+        m_framePool.reset();
         if (m_pFrameBufferReturned)
         {
             delete[] m_pFrameBufferReturned;
             m_pFrameBufferReturned = nullptr;
         }
-
-        m_videoMutex.unlock();
+        m_frameMutex.unlock();
     }
 
 
@@ -347,9 +652,15 @@ namespace ucapa{
 
     void Video::stopVideoThread()
     {
+        m_packetMutex.lock();
         m_isActive = false;
+        m_packetMutex.unlock();
+        m_ioService.stop();
+        m_packetAvailable.notify_all();
         if (m_videoThread.joinable())
             m_videoThread.join();
+        if (m_readThread.joinable())
+            m_readThread.join();
     }
 
 
@@ -371,50 +682,104 @@ namespace ucapa{
     }
 
 
+    FrameHandle Video::getLatestFrame() const
+    {
+        m_frameMutex.lock();
+        FrameHandle frame = m_framePool ? m_framePool->getLatest() : FrameHandle();
+        m_frameMutex.unlock();
+
+        return frame;
+    }
+
     uint8_t* Video::getFrame() const
     {
-        m_videoMutex.lock();
+        m_frameMutex.lock();
 
-        if (m_pFrameRGB == nullptr || m_pFrameRGB->data == nullptr)
+        FrameHandle frame = m_framePool ? m_framePool->getLatest() : FrameHandle();
+        const uint8_t* data = frame.getData(FrameHandle::FORMAT_RGB24);
+        if (!data)
         {
-            m_videoMutex.unlock();
+            m_frameMutex.unlock();
             return nullptr;
         }
 
-        memcpy(m_pFrameBufferReturned, *(m_pFrameRGB->data), m_pCodecCtx->width * m_pCodecCtx->height * 3);
+        // The returned buffer is packed, the rows of the converted frames are padded
+        const int rowSize = frame.getWidth() * 3;
+        for (int row=0; row<frame.getHeight(); ++row)
+            memcpy(m_pFrameBufferReturned + row * rowSize, data + row * frame.getStride(FrameHandle::FORMAT_RGB24), rowSize);
 
-        m_videoMutex.unlock();
+        m_frameMutex.unlock();
         return m_pFrameBufferReturned;
     }
 
+    uint64_t Video::getNbDroppedFrames() const
+    {
+        m_frameMutex.lock();
+        uint64_t nbDropped = m_framePool ? m_framePool->getNbDropped() : 0;
+        m_frameMutex.unlock();
+
+        return nbDropped;
+    }
+
+    int Video::registerOutput(const VideoOutputSpec& spec)
+    {
+        if (spec.format == FrameHandle::FORMAT_YUV420P || spec.format >= FrameHandle::NB_FORMATS ||
+            !(spec.scale > 0.0f && spec.scale <= 1.0f) || spec.x < 0 || spec.y < 0 || spec.width < 0 || spec.height < 0)
+        {
+            std::cerr << "Invalid video output" << std::endl;
+            return -1;
+        }
+
+        m_outputMutex.lock();
+        const int id = m_nextOutputId++;
+        m_outputs[id] = spec;
+        m_outputMutex.unlock();
+
+        return id;
+    }
+
+    bool Video::unregisterOutput(int id)
+    {
+        m_outputMutex.lock();
+        const bool registered = m_outputs.erase(id) > 0;
+        m_outputMutex.unlock();
+
+        return registered;
+    }
+
+    std::chrono::duration<double> Video::getFrameLatency() const
+    {
+        return std::chrono::nanoseconds(m_frameLatency.load());
+    }
+
     int Video::getWidth() const
     {
-        m_videoMutex.lock();
+        m_frameMutex.lock();
 
-        if (m_pCodecCtx == NULL)
+        if (!m_framePool)
         {
-            m_videoMutex.unlock();
+            m_frameMutex.unlock();
             return -1;
         }
 
-        int width = m_pCodecCtx->width;
-        m_videoMutex.unlock();
+        int width = m_framePool->getWidth();
+        m_frameMutex.unlock();
 
         return width;
     }
 
     int Video::getHeight() const
     {
-        m_videoMutex.lock();
+        m_frameMutex.lock();
 
-        if (m_pCodecCtx == NULL)
+        if (!m_framePool)
         {
-            m_videoMutex.unlock();
+            m_frameMutex.unlock();
             return -1;
         }
 
-        int height = m_pCodecCtx->height;
-        m_videoMutex.unlock();
+        int height = m_framePool->getHeight();
+        m_frameMutex.unlock();
 
         return height;
     }
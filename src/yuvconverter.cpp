@@ -0,0 +1,446 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 UCAPA Team and other contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#include <yuvconverter.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(UCAPA_HAS_AVX2_DISPATCH)
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define UCAPA_TARGET_AVX2
+    #else
+        #define UCAPA_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(UCAPA_HAS_SSE2)
+    #include <emmintrin.h>
+#endif
+
+namespace ucapa{
+    namespace {
+        /**
+         * @brief Coefficients of the conversion, multiplied by 64.
+         *
+         * The kernels compute in 16 bits with saturation, as the SIMD instructions do,
+         * so the scalar code gives the same result as the vectorized one.
+         */
+        struct Coefficients
+        {
+            int16_t yOffset;
+            int16_t y;
+            int16_t rv;
+            int16_t gu;
+            int16_t gv;
+            int16_t bu;
+        };
+
+        // BT.601: R = Y' + 1.596 V, G = Y' - 0.392 U - 0.813 V, B = Y' + 2.017 U with Y' = 1.164 (Y - 16)
+        const Coefficients LIMITED_RANGE = {16, 74, 102, 25, 52, 129};
+        // BT.601 with full range Y: R = Y + 1.402 V, G = Y - 0.344 U - 0.714 V, B = Y + 1.772 U
+        const Coefficients FULL_RANGE = {0, 64, 90, 22, 46, 113};
+
+        inline int saturate16(int value)
+        {
+            return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+        }
+
+        inline uint8_t toByte(int value)
+        {
+            value = saturate16(value) >> 6;
+            return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+
+        void convertRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dest,
+                              FrameHandle::FORMAT format, const Coefficients& c, int begin, int end)
+        {
+            const int bytesPerPixel = FrameHandle::getBytesPerPixel(format);
+            const int red = format == FrameHandle::FORMAT_BGRA ? 2 : 0;
+            const int blue = 2 - red;
+
+            for (int x=begin; x<end; ++x)
+            {
+                const int luma = (int16_t)((y[x] - c.yOffset) * c.y) + 32;
+                const int cb = u[x / 2] - 128;
+                const int cr = v[x / 2] - 128;
+                uint8_t* pixel = dest + x * bytesPerPixel;
+                pixel[red] = toByte(luma + cr * c.rv);
+                pixel[1] = toByte(luma - (cb * c.gu + cr * c.gv));
+                pixel[blue] = toByte(luma + cb * c.bu);
+                if (bytesPerPixel == 4)
+                    pixel[3] = 255;
+            }
+        }
+
+#if defined(UCAPA_HAS_SSE2)
+        // 16 pixels per iteration. SSE2 has no byte shuffle, so RGB24 is interleaved from memory.
+        int convertRowSse2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dest,
+                           FrameHandle::FORMAT format, const Coefficients& c, int width)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i alpha = _mm_set1_epi8((char)0xFF);
+            const __m128i chromaOffset = _mm_set1_epi16(128);
+            const __m128i rounding = _mm_set1_epi16(32);
+            const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+            const __m128i yCoef = _mm_set1_epi16(c.y);
+            const __m128i rvCoef = _mm_set1_epi16(c.rv);
+            const __m128i guCoef = _mm_set1_epi16(c.gu);
+            const __m128i gvCoef = _mm_set1_epi16(c.gv);
+            const __m128i buCoef = _mm_set1_epi16(c.bu);
+
+            int x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u + x / 2)), zero), chromaOffset);
+                const __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(v + x / 2)), zero), chromaOffset);
+                const __m128i rv = _mm_mullo_epi16(cr, rvCoef);
+                const __m128i guv = _mm_add_epi16(_mm_mullo_epi16(cb, guCoef), _mm_mullo_epi16(cr, gvCoef));
+                const __m128i bu = _mm_mullo_epi16(cb, buCoef);
+
+                // Each chroma sample is shared by two pixels of the row
+                const __m128i lumas = _mm_loadu_si128((const __m128i*)(y + x));
+                __m128i luma[2] = {_mm_unpacklo_epi8(lumas, zero), _mm_unpackhi_epi8(lumas, zero)};
+                __m128i rvs[2] = {_mm_unpacklo_epi16(rv, rv), _mm_unpackhi_epi16(rv, rv)};
+                __m128i guvs[2] = {_mm_unpacklo_epi16(guv, guv), _mm_unpackhi_epi16(guv, guv)};
+                __m128i bus[2] = {_mm_unpacklo_epi16(bu, bu), _mm_unpackhi_epi16(bu, bu)};
+                __m128i channels[3][2];
+                for (int half=0; half<2; ++half)
+                {
+                    luma[half] = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(luma[half], yOffset), yCoef), rounding);
+                    channels[0][half] = _mm_srai_epi16(_mm_adds_epi16(luma[half], rvs[half]), 6);
+                    channels[1][half] = _mm_srai_epi16(_mm_subs_epi16(luma[half], guvs[half]), 6);
+                    channels[2][half] = _mm_srai_epi16(_mm_adds_epi16(luma[half], bus[half]), 6);
+                }
+                const __m128i r = _mm_packus_epi16(channels[0][0], channels[0][1]);
+                const __m128i g = _mm_packus_epi16(channels[1][0], channels[1][1]);
+                const __m128i b = _mm_packus_epi16(channels[2][0], channels[2][1]);
+
+                if (format == FrameHandle::FORMAT_RGB24)
+                {
+                    uint8_t planes[3][16];
+                    _mm_storeu_si128((__m128i*)planes[0], r);
+                    _mm_storeu_si128((__m128i*)planes[1], g);
+                    _mm_storeu_si128((__m128i*)planes[2], b);
+                    uint8_t* pixel = dest + x * 3;
+                    for (int i=0; i<16; ++i, pixel += 3)
+                    {
+                        pixel[0] = planes[0][i];
+                        pixel[1] = planes[1][i];
+                        pixel[2] = planes[2][i];
+                    }
+                }
+                else
+                {
+                    const __m128i first = format == FrameHandle::FORMAT_BGRA ? b : r;
+                    const __m128i third = format == FrameHandle::FORMAT_BGRA ? r : b;
+                    const __m128i firstGreenLow = _mm_unpacklo_epi8(first, g);
+                    const __m128i firstGreenHigh = _mm_unpackhi_epi8(first, g);
+                    const __m128i thirdAlphaLow = _mm_unpacklo_epi8(third, alpha);
+                    const __m128i thirdAlphaHigh = _mm_unpackhi_epi8(third, alpha);
+                    __m128i* pixel = (__m128i*)(dest + x * 4);
+                    _mm_storeu_si128(pixel, _mm_unpacklo_epi16(firstGreenLow, thirdAlphaLow));
+                    _mm_storeu_si128(pixel + 1, _mm_unpackhi_epi16(firstGreenLow, thirdAlphaLow));
+                    _mm_storeu_si128(pixel + 2, _mm_unpacklo_epi16(firstGreenHigh, thirdAlphaHigh));
+                    _mm_storeu_si128(pixel + 3, _mm_unpackhi_epi16(firstGreenHigh, thirdAlphaHigh));
+                }
+            }
+            return x;
+        }
+#endif
+
+#if defined(UCAPA_HAS_AVX2_DISPATCH)
+        // 32 pixels per iteration. The AVX2 instructions work in two 128 bits lanes,
+        // the permutations keep the pixels in order.
+        UCAPA_TARGET_AVX2
+        int convertRowAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dest,
+                           FrameHandle::FORMAT format, const Coefficients& c, int width)
+        {
+            const __m256i alpha = _mm256_set1_epi8((char)0xFF);
+            const __m256i chromaOffset = _mm256_set1_epi16(128);
+            const __m256i rounding = _mm256_set1_epi16(32);
+            const __m256i yOffset = _mm256_set1_epi16(c.yOffset);
+            const __m256i yCoef = _mm256_set1_epi16(c.y);
+            const __m256i rvCoef = _mm256_set1_epi16(c.rv);
+            const __m256i guCoef = _mm256_set1_epi16(c.gu);
+            const __m256i gvCoef = _mm256_set1_epi16(c.gv);
+            const __m256i buCoef = _mm256_set1_epi16(c.bu);
+            // Drop the alpha of 4 RGBA pixels, the last 4 bytes are unused
+            const __m256i packRgb = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                     0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+            int x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                const __m256i cb = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(u + x / 2))), chromaOffset);
+                const __m256i cr = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(v + x / 2))), chromaOffset);
+                // Chroma samples 0-3 and 8-11 in the first lane, so unpacking them with themselves gives the pixels 0-15
+                const __m256i rv = _mm256_permute4x64_epi64(_mm256_mullo_epi16(cr, rvCoef), _MM_SHUFFLE(3, 1, 2, 0));
+                const __m256i guv = _mm256_permute4x64_epi64(_mm256_add_epi16(_mm256_mullo_epi16(cb, guCoef), _mm256_mullo_epi16(cr, gvCoef)), _MM_SHUFFLE(3, 1, 2, 0));
+                const __m256i bu = _mm256_permute4x64_epi64(_mm256_mullo_epi16(cb, buCoef), _MM_SHUFFLE(3, 1, 2, 0));
+
+                __m256i luma[2] = {_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x))),
+                                   _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x + 16)))};
+                __m256i rvs[2] = {_mm256_unpacklo_epi16(rv, rv), _mm256_unpackhi_epi16(rv, rv)};
+                __m256i guvs[2] = {_mm256_unpacklo_epi16(guv, guv), _mm256_unpackhi_epi16(guv, guv)};
+                __m256i bus[2] = {_mm256_unpacklo_epi16(bu, bu), _mm256_unpackhi_epi16(bu, bu)};
+                __m256i channels[3][2];
+                for (int half=0; half<2; ++half)
+                {
+                    luma[half] = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(luma[half], yOffset), yCoef), rounding);
+                    channels[0][half] = _mm256_srai_epi16(_mm256_adds_epi16(luma[half], rvs[half]), 6);
+                    channels[1][half] = _mm256_srai_epi16(_mm256_subs_epi16(luma[half], guvs[half]), 6);
+                    channels[2][half] = _mm256_srai_epi16(_mm256_adds_epi16(luma[half], bus[half]), 6);
+                }
+                // Pixels 0-7 and 16-23 in the first lane, 8-15 and 24-31 in the second one
+                const __m256i r = _mm256_packus_epi16(channels[0][0], channels[0][1]);
+                const __m256i g = _mm256_packus_epi16(channels[1][0], channels[1][1]);
+                const __m256i b = _mm256_packus_epi16(channels[2][0], channels[2][1]);
+
+                const __m256i first = format == FrameHandle::FORMAT_BGRA ? b : r;
+                const __m256i third = format == FrameHandle::FORMAT_BGRA ? r : b;
+                const __m256i firstGreenLow = _mm256_unpacklo_epi8(first, g);
+                const __m256i firstGreenHigh = _mm256_unpackhi_epi8(first, g);
+                const __m256i thirdAlphaLow = _mm256_unpacklo_epi8(third, alpha);
+                const __m256i thirdAlphaHigh = _mm256_unpackhi_epi8(third, alpha);
+                const __m256i pixels0 = _mm256_unpacklo_epi16(firstGreenLow, thirdAlphaLow);   // 0-3, 8-11
+                const __m256i pixels1 = _mm256_unpackhi_epi16(firstGreenLow, thirdAlphaLow);   // 4-7, 12-15
+                const __m256i pixels2 = _mm256_unpacklo_epi16(firstGreenHigh, thirdAlphaHigh); // 16-19, 24-27
+                const __m256i pixels3 = _mm256_unpackhi_epi16(firstGreenHigh, thirdAlphaHigh); // 20-23, 28-31
+                __m256i ordered[4] = {_mm256_permute2x128_si256(pixels0, pixels1, 0x20),
+                                      _mm256_permute2x128_si256(pixels0, pixels1, 0x31),
+                                      _mm256_permute2x128_si256(pixels2, pixels3, 0x20),
+                                      _mm256_permute2x128_si256(pixels2, pixels3, 0x31)};
+
+                if (format == FrameHandle::FORMAT_RGB24)
+                {
+                    // 12 bytes per group of 4 pixels, the 4 unused bytes are overwritten by the next group
+                    uint8_t* pixel = dest + x * 3;
+                    for (int i=0; i<4; ++i)
+                    {
+                        const __m256i rgb = _mm256_shuffle_epi8(ordered[i], packRgb);
+                        _mm_storeu_si128((__m128i*)(pixel + 24 * i), _mm256_castsi256_si128(rgb));
+                        if (i < 3)
+                            _mm_storeu_si128((__m128i*)(pixel + 24 * i + 12), _mm256_extracti128_si256(rgb, 1));
+                        else
+                        {
+                            const __m128i last = _mm256_extracti128_si256(rgb, 1);
+                            _mm_storel_epi64((__m128i*)(pixel + 24 * i + 12), last);
+                            const int lastBytes = _mm_cvtsi128_si32(_mm_srli_si128(last, 8));
+                            std::memcpy(pixel + 24 * i + 20, &lastBytes, 4);
+                        }
+                    }
+                }
+                else
+                {
+                    __m256i* pixel = (__m256i*)(dest + x * 4);
+                    for (int i=0; i<4; ++i)
+                        _mm256_storeu_si256(pixel + i, ordered[i]);
+                }
+            }
+            return x;
+        }
+#endif
+
+        void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dest, FrameHandle::FORMAT format,
+                        const Coefficients& c, int width, YuvConverter::INSTRUCTION_SET instructionSet)
+        {
+            int x = 0;
+#if defined(UCAPA_HAS_AVX2_DISPATCH)
+            if (instructionSet == YuvConverter::AVX2)
+                x = convertRowAvx2(y, u, v, dest, format, c, width);
+#endif
+#if defined(UCAPA_HAS_SSE2)
+            if (instructionSet != YuvConverter::SCALAR)
+                x += convertRowSse2(y + x, u + x / 2, v + x / 2, dest + x * FrameHandle::getBytesPerPixel(format), format, c, width - x);
+#endif
+            (void)instructionSet;
+            convertRowScalar(y, u, v, dest, format, c, x, width);
+        }
+    }
+
+    YuvConverter::YuvConverter(int nbThreads)
+        : m_instructionSet(detectInstructionSet())
+        , m_nextStripe(0)
+        , m_nbPendingStripes(0)
+        , m_stop(false)
+    {
+        m_job.nbStripes = 0;
+
+        if (nbThreads <= 0)
+            nbThreads = std::max(1, std::min(4, (int)std::thread::hardware_concurrency()));
+
+        // The caller converts a stripe too
+        for (int i=1; i<nbThreads; ++i)
+            m_workers.push_back(std::thread([this] () {this->work();}));
+    }
+
+    YuvConverter::~YuvConverter()
+    {
+        m_mutex.lock();
+        m_stop = true;
+        m_mutex.unlock();
+        m_stripeAvailable.notify_all();
+
+        for (std::size_t i=0; i<m_workers.size(); ++i)
+            m_workers[i].join();
+    }
+
+    bool YuvConverter::convert(const uint8_t* const planes[3], const int strides[3], int width, int height, bool fullRange,
+                               FrameHandle::FORMAT format, uint8_t* dest, int destStride)
+    {
+        if (format != FrameHandle::FORMAT_RGB24 && format != FrameHandle::FORMAT_BGRA && format != FrameHandle::FORMAT_RGBA)
+            return false;
+
+        Job job;
+        for (int i=0; i<3; ++i)
+        {
+            job.planes[i] = planes[i];
+            job.strides[i] = strides[i];
+        }
+        job.width = width;
+        job.height = height;
+        job.fullRange = fullRange;
+        job.format = format;
+        job.dest = dest;
+        job.destStride = destStride;
+        job.instructionSet = m_instructionSet;
+        job.nbStripes = std::max(1, std::min(getNbThreads(), height / MIN_STRIPE_HEIGHT));
+
+        // If another frame is being converted, the workers are busy
+        std::unique_lock<std::mutex> jobLock(m_jobMutex, std::try_to_lock);
+        if (job.nbStripes == 1 || !jobLock.owns_lock())
+        {
+            job.nbStripes = 1;
+            convertStripe(job, 0);
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_nextStripe = 0;
+        m_nbPendingStripes = job.nbStripes;
+        m_stripeAvailable.notify_all();
+        finishJob(lock);
+        return true;
+    }
+
+    void YuvConverter::finishJob(std::unique_lock<std::mutex>& lock)
+    {
+        while (m_nextStripe < m_job.nbStripes)
+        {
+            const int stripe = m_nextStripe++;
+            lock.unlock();
+            convertStripe(m_job, stripe);
+            lock.lock();
+            m_nbPendingStripes--;
+        }
+
+        m_jobDone.wait(lock, [this] () {return m_nbPendingStripes == 0;});
+    }
+
+    void YuvConverter::work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_stripeAvailable.wait(lock, [this] () {return m_stop || m_nextStripe < m_job.nbStripes;});
+            if (m_stop)
+                return;
+
+            // The job can't change before all its stripes are converted
+            const int stripe = m_nextStripe++;
+            lock.unlock();
+            convertStripe(m_job, stripe);
+            lock.lock();
+            if (--m_nbPendingStripes == 0)
+                m_jobDone.notify_all();
+        }
+    }
+
+    void YuvConverter::convertStripe(const Job& job, int stripe)
+    {
+        const Coefficients& coefficients = job.fullRange ? FULL_RANGE : LIMITED_RANGE;
+        const int rowsPerStripe = (job.height + job.nbStripes - 1) / job.nbStripes;
+        const int firstRow = stripe * rowsPerStripe;
+        const int lastRow = std::min(job.height, firstRow + rowsPerStripe);
+
+        for (int row=firstRow; row<lastRow; ++row)
+        {
+            convertRow(job.planes[0] + row * job.strides[0],
+                       job.planes[1] + (row / 2) * job.strides[1],
+                       job.planes[2] + (row / 2) * job.strides[2],
+                       job.dest + row * job.destStride,
+                       job.format, coefficients, job.width, job.instructionSet);
+        }
+    }
+
+    bool YuvConverter::setInstructionSet(INSTRUCTION_SET instructionSet)
+    {
+        if (instructionSet > detectInstructionSet())
+            return false;
+
+        m_instructionSet = instructionSet;
+        return true;
+    }
+
+    YuvConverter::INSTRUCTION_SET YuvConverter::detectInstructionSet()
+    {
+#if defined(UCAPA_HAS_AVX2_DISPATCH) && defined(_MSC_VER)
+        // AVX2 needs the support of the CPU, and the OS must save the AVX registers
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            const bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            if (osSavesAvx && (info[1] & (1 << 5)))
+                return AVX2;
+        }
+#elif defined(UCAPA_HAS_AVX2_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return AVX2;
+#endif
+#if defined(UCAPA_HAS_SSE2)
+        return SSE2;
+#else
+        return SCALAR;
+#endif
+    }
+
+    const char* YuvConverter::getInstructionSetName(INSTRUCTION_SET instructionSet)
+    {
+        switch (instructionSet)
+        {
+        case AVX2:
+            return "avx2";
+        case SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+}
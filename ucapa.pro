@@ -29,7 +29,7 @@ win32 {
     LIBS += -L"$$_PRO_FILE_PWD_/external/ffmpeg/lib/" -lavformat -lavcodec -lswscale -lavutil
 }
 unix {
-    LIBS += -L/usr/local/lib -lavformat -lavcodec -lva -lz -lswscale -lavutil
+    LIBS += -L/usr/local/lib -lavformat -lavcodec -lva -lz -lswscale -lavutil -lrt
 #    LIBS += -I/usr/local/include  -pthread -L/usr/local/lib -lavformat -lavcodec -ldl -lvdpau -lva -lX11 -lasound -lSDL -lz -lswscale -lavutil -lm
 }
 
@@ -37,17 +37,43 @@ unix {
 SOURCES += \
     src/ardrone.cpp \
     src/ardroneconnections.cpp \
+    src/clocksync.cpp \
+    src/fastmath.cpp \
+    src/framepool.cpp \
     src/vector3.cpp \
+    src/vector3array.cpp \
     src/navdata.cpp \
+    src/navdatalog.cpp \
+    src/navdatashm.cpp \
+    src/pave.cpp \
     src/quaternion.cpp \
-    src/video.cpp
+    src/poseestimator.cpp \
+    src/positionintegrator.cpp \
+    src/telemetryaggregator.cpp \
+    src/trajectorysmoother.cpp \
+    src/video.cpp \
+    src/yuvconverter.cpp
 
 HEADERS  += \
     include/vector3.h \
+    include/vector3array.h \
     include/ardroneconnections.h \
+    include/clocksync.h \
+    include/fastmath.h \
+    include/framepool.h \
     include/ardrone.h \
     include/navdata.h \
+    include/navdatalog.h \
+    include/navdatashm.h \
+    include/pave.h \
     include/utils.h \
     include/matrix.h \
+    include/matrixdecomposition.h \
     include/quaternion.h \
-    include/video.h
+    include/simdpack.h \
+    include/poseestimator.h \
+    include/positionintegrator.h \
+    include/telemetryaggregator.h \
+    include/trajectorysmoother.h \
+    include/video.h \
+    include/yuvconverter.h